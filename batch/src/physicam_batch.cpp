@@ -0,0 +1,744 @@
+/*
+PhysiCam - Physically based camera
+Copyright (C) 2015 Frank Khnke
+
+This file is part of PhysiCam.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either
+version 3 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+*	@file physicam_batch.cpp
+*
+*	Offline batch tool: applies the camera to a sequence of pre-rendered HDR color and depth frames
+*	(PFM, numbered with a printf pattern) and writes the tonemapped frames as PPM or PFM. Runs on
+*	CPUPostProcessor, so it needs neither a window nor a gpu.
+*
+*	The camera and effect settings come from the command line or a JSON sidecar, which may keyframe
+*	them: numbers are interpolated linearly between keyframes, switches and the tonemapping method
+*	hold the value of the last keyframe. Reading, processing and writing run on their own threads
+*	connected by bounded queues, so only a few frames are in memory at any time. Inputs are memory
+*	mapped where the platform supports it.
+*/
+
+#include <physicam/CPUPostProcessor.h>
+
+#include <rapidjson/document.h>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct BatchOptions
+{
+	//printf patterns with the frame number, e.g. shot/color.%04d.pfm
+	std::string ColorPattern;
+	std::string DepthPattern;
+	//.pfm writes float RGB, everything else 8 bit PPM
+	std::string OutputPattern;
+	std::string SettingsFile;
+	int FirstFrame;
+	//-1 = until the first missing color frame
+	int LastFrame;
+	unsigned int Threads;
+	int QueueSize;
+};
+
+
+/*** settings ***/
+
+enum class SettingType : int
+{
+	Number,
+	Switch,
+	Method
+};
+
+//a camera or effect parameter that can be set and keyframed in the sidecar
+struct BatchSetting
+{
+	const char* Name;
+	SettingType Type;
+	void(*Apply)(PhysiCam::CPUPostProcessor& pp, PhysiCam::CPUCameraSettings& camera, float value);
+};
+
+const static BatchSetting s_Settings[] =
+{
+	{ "iso", SettingType::Number, [](PhysiCam::CPUPostProcessor&, PhysiCam::CPUCameraSettings& c, float v) { c.Iso = v; } },
+	{ "max_iso", SettingType::Number, [](PhysiCam::CPUPostProcessor&, PhysiCam::CPUCameraSettings& c, float v) { c.MaxIso = v; } },
+	{ "aperture", SettingType::Number, [](PhysiCam::CPUPostProcessor&, PhysiCam::CPUCameraSettings& c, float v) { c.Aperture = v; } },
+	{ "shutter_speed", SettingType::Number, [](PhysiCam::CPUPostProcessor&, PhysiCam::CPUCameraSettings& c, float v) { c.ShutterSpeed = v; } },
+	{ "focal_length", SettingType::Number, [](PhysiCam::CPUPostProcessor&, PhysiCam::CPUCameraSettings& c, float v) { c.FocalLength = v; } },
+	{ "coc", SettingType::Number, [](PhysiCam::CPUPostProcessor&, PhysiCam::CPUCameraSettings& c, float v) { c.CoC = v; } },
+	{ "clip_near", SettingType::Number, [](PhysiCam::CPUPostProcessor&, PhysiCam::CPUCameraSettings& c, float v) { c.ClipNear = v; } },
+	{ "clip_far", SettingType::Number, [](PhysiCam::CPUPostProcessor&, PhysiCam::CPUCameraSettings& c, float v) { c.ClipFar = v; } },
+	{ "bloom", SettingType::Switch, [](PhysiCam::CPUPostProcessor& pp, PhysiCam::CPUCameraSettings&, float v) { pp.SetBloomEnabled(v != 0.0f); } },
+	{ "bloom_threshold", SettingType::Number, [](PhysiCam::CPUPostProcessor& pp, PhysiCam::CPUCameraSettings&, float v) { pp.SetBloomThreshold(v); } },
+	{ "bloom_intensity", SettingType::Number, [](PhysiCam::CPUPostProcessor& pp, PhysiCam::CPUCameraSettings&, float v) { pp.SetBloomIntensity(v); } },
+	{ "tonemapping", SettingType::Switch, [](PhysiCam::CPUPostProcessor& pp, PhysiCam::CPUCameraSettings&, float v) { pp.SetTonemappingEnabled(v != 0.0f); } },
+	{ "tonemapping_method", SettingType::Method,
+		[](PhysiCam::CPUPostProcessor& pp, PhysiCam::CPUCameraSettings&, float v) { pp.SetTonemappingMethod((PhysiCam::TonemappingMethod)(int)v); } },
+	{ "dof", SettingType::Switch, [](PhysiCam::CPUPostProcessor& pp, PhysiCam::CPUCameraSettings&, float v) { pp.SetDoFEnabled(v != 0.0f); } },
+	{ "dof_aberation", SettingType::Number, [](PhysiCam::CPUPostProcessor& pp, PhysiCam::CPUCameraSettings&, float v) { pp.SetDoFAberation(v); } },
+	{ "dof_focal_distance", SettingType::Number, [](PhysiCam::CPUPostProcessor& pp, PhysiCam::CPUCameraSettings&, float v) { pp.SetDoFFocalDistance(v); } },
+	{ "dof_autofocus", SettingType::Switch, [](PhysiCam::CPUPostProcessor& pp, PhysiCam::CPUCameraSettings&, float v) { pp.SetDoFAutofocus(v != 0.0f); } },
+	{ "dof_vignetting", SettingType::Switch, [](PhysiCam::CPUPostProcessor& pp, PhysiCam::CPUCameraSettings&, float v) { pp.SetDoFVignetting(v != 0.0f); } },
+	{ "dof_max_blur", SettingType::Number, [](PhysiCam::CPUPostProcessor& pp, PhysiCam::CPUCameraSettings&, float v) { pp.SetDoFMaxBlur(v); } },
+	{ "lens_distortion", SettingType::Number, [](PhysiCam::CPUPostProcessor& pp, PhysiCam::CPUCameraSettings&, float v) { pp.SetLensDistortionAmount(v); } },
+	{ "min_noise", SettingType::Number, [](PhysiCam::CPUPostProcessor& pp, PhysiCam::CPUCameraSettings&, float v) { pp.SetMinNoise(v); } },
+	{ "max_noise", SettingType::Number, [](PhysiCam::CPUPostProcessor& pp, PhysiCam::CPUCameraSettings&, float v) { pp.SetMaxNoise(v); } }
+};
+
+const static int s_SettingCount = sizeof(s_Settings) / sizeof(s_Settings[0]);
+
+//order of PhysiCam::TonemappingMethod
+const static char* s_TonemappingMethods[] = { "reinhard", "filmic", "uncharted2" };
+
+struct Keyframe
+{
+	int Frame;
+	//per entry of s_Settings, only the ones the keyframe sets
+	float Values[s_SettingCount];
+	bool Defined[s_SettingCount];
+};
+
+struct BatchSettings
+{
+	//the values of frames before the first keyframe of a setting, or of all frames without keyframes
+	Keyframe Base;
+	//sorted by frame
+	std::vector<Keyframe> Keyframes;
+};
+
+void InitKeyframe(Keyframe& keyframe, int frame)
+{
+	keyframe.Frame = frame;
+	for (int i = 0; i < s_SettingCount; i++)
+	{
+		keyframe.Values[i] = 0.0f;
+		keyframe.Defined[i] = false;
+	}
+}
+
+bool ReadSettings(const rapidjson::Value& object, Keyframe& keyframe)
+{
+	for (auto it = object.MemberBegin(); it != object.MemberEnd(); ++it)
+	{
+		std::string name = it->name.GetString();
+		if (name == "frame")
+			continue;
+
+		int id = 0;
+		while (id < s_SettingCount && name != s_Settings[id].Name)
+			id++;
+		if (id == s_SettingCount)
+		{
+			std::cerr << "unknown setting " << name << "\n";
+			return false;
+		}
+
+		const rapidjson::Value &value = it->value;
+		switch (s_Settings[id].Type)
+		{
+		case SettingType::Number:
+			if (!value.IsNumber())
+			{
+				std::cerr << name << " has to be a number\n";
+				return false;
+			}
+			keyframe.Values[id] = (float)value.GetDouble();
+			break;
+		case SettingType::Switch:
+			if (!value.IsBool())
+			{
+				std::cerr << name << " has to be true or false\n";
+				return false;
+			}
+			keyframe.Values[id] = value.GetBool() ? 1.0f : 0.0f;
+			break;
+		case SettingType::Method:
+		{
+			int method = 0;
+			while (value.IsString() && method < 3 && strcmp(value.GetString(), s_TonemappingMethods[method]) != 0)
+				method++;
+			if (!value.IsString() || method == 3)
+			{
+				std::cerr << name << " has to be reinhard, filmic or uncharted2\n";
+				return false;
+			}
+			keyframe.Values[id] = (float)method;
+			break;
+		}
+		}
+		keyframe.Defined[id] = true;
+	}
+	return true;
+}
+
+//{ "settings": { "iso": 200, ... }, "keyframes": [ { "frame": 1, "aperture": 2.8 }, { "frame": 48, "aperture": 8 } ] }
+bool LoadSettings(const std::string& path, BatchSettings& settings)
+{
+	InitKeyframe(settings.Base, 0);
+	settings.Keyframes.clear();
+	if (path.empty())
+		return true;
+
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::cerr << "failed to open " << path << "\n";
+		return false;
+	}
+	std::stringstream ss;
+	ss << file.rdbuf();
+	std::string json = ss.str();
+
+	rapidjson::Document doc;
+	doc.Parse<0>(json.c_str());
+	if (doc.HasParseError() || !doc.IsObject())
+	{
+		std::cerr << path << ": " << (doc.HasParseError() ? doc.GetParseError() : "not an object") << " at " << doc.GetErrorOffset() << "\n";
+		return false;
+	}
+
+	if (doc.HasMember("settings") && (!doc["settings"].IsObject() || !ReadSettings(doc["settings"], settings.Base)))
+		return false;
+
+	if (doc.HasMember("keyframes"))
+	{
+		const rapidjson::Value &keyframes = doc["keyframes"];
+		if (!keyframes.IsArray())
+		{
+			std::cerr << "keyframes has to be an array\n";
+			return false;
+		}
+
+		for (rapidjson::SizeType i = 0; i < keyframes.Size(); i++)
+		{
+			const rapidjson::Value &k = keyframes[i];
+			if (!k.IsObject() || !k.HasMember("frame") || !k["frame"].IsInt())
+			{
+				std::cerr << "every keyframe needs a frame number\n";
+				return false;
+			}
+
+			Keyframe keyframe;
+			InitKeyframe(keyframe, k["frame"].GetInt());
+			if (!ReadSettings(k, keyframe))
+				return false;
+			settings.Keyframes.push_back(keyframe);
+		}
+
+		std::stable_sort(settings.Keyframes.begin(), settings.Keyframes.end(),
+			[](const Keyframe& a, const Keyframe& b) { return a.Frame < b.Frame; });
+	}
+	return true;
+}
+
+//settings neither the base nor a keyframe sets are left alone and keep the defaults of CPUPostProcessor
+void ApplySettings(const BatchSettings& settings, int frame, PhysiCam::CPUPostProcessor& pp)
+{
+	PhysiCam::CPUCameraSettings camera = pp.GetCameraSettings();
+
+	for (int id = 0; id < s_SettingCount; id++)
+	{
+		const Keyframe *before = settings.Base.Defined[id] ? &settings.Base : nullptr;
+		const Keyframe *after = nullptr;
+		for (auto &keyframe : settings.Keyframes)
+		{
+			if (!keyframe.Defined[id])
+				continue;
+			if (keyframe.Frame <= frame)
+				before = &keyframe;
+			else
+			{
+				after = &keyframe;
+				break;
+			}
+		}
+
+		float value;
+		if (before && after && before != &settings.Base && s_Settings[id].Type == SettingType::Number)
+		{
+			float t = (frame - before->Frame) / (float)(after->Frame - before->Frame);
+			value = before->Values[id] + (after->Values[id] - before->Values[id]) * t;
+		}
+		else if (before)
+			value = before->Values[id];
+		else if (after)
+			value = after->Values[id];
+		else
+			continue;
+
+		s_Settings[id].Apply(pp, camera, value);
+	}
+
+	pp.SetCameraSettings(camera);
+}
+
+
+/*** frame io ***/
+
+//read only view of a whole file, memory mapped where possible and read into memory otherwise
+class MappedFile
+{
+public:
+	MappedFile() : m_Data(nullptr), m_Size(0)
+	{
+#ifdef _WIN32
+		m_File = INVALID_HANDLE_VALUE;
+		m_Mapping = nullptr;
+#endif
+	}
+
+	~MappedFile()
+	{
+		Close();
+	}
+
+	bool Open(const std::string& path)
+	{
+		Close();
+#ifdef _WIN32
+		m_File = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (m_File == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER size;
+		if (GetFileSizeEx(m_File, &size) && size.QuadPart > 0)
+		{
+			m_Mapping = CreateFileMappingA(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (m_Mapping)
+				m_Data = (const char*)MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0);
+			if (m_Data)
+			{
+				m_Size = (size_t)size.QuadPart;
+				return true;
+			}
+		}
+#else
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+
+		struct stat st;
+		if (fstat(fd, &st) == 0 && st.st_size > 0)
+		{
+			void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (data != MAP_FAILED)
+			{
+				//frames are decoded front to back exactly once
+				madvise(data, st.st_size, MADV_SEQUENTIAL);
+				m_Data = (const char*)data;
+				m_Size = st.st_size;
+				close(fd);
+				return true;
+			}
+		}
+		close(fd);
+#endif
+
+		Close();
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+		m_Buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		m_Data = m_Buffer.data();
+		m_Size = m_Buffer.size();
+		return true;
+	}
+
+	void Close()
+	{
+		if (m_Data && m_Buffer.empty())
+		{
+#ifdef _WIN32
+			UnmapViewOfFile(m_Data);
+#else
+			munmap((void*)m_Data, m_Size);
+#endif
+		}
+#ifdef _WIN32
+		if (m_Mapping)
+			CloseHandle(m_Mapping);
+		if (m_File != INVALID_HANDLE_VALUE)
+			CloseHandle(m_File);
+		m_Mapping = nullptr;
+		m_File = INVALID_HANDLE_VALUE;
+#endif
+		m_Buffer.clear();
+		m_Data = nullptr;
+		m_Size = 0;
+	}
+
+	const char* Data() const { return m_Data; }
+	size_t Size() const { return m_Size; }
+
+private:
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+	const char* m_Data;
+	size_t m_Size;
+	std::vector<char> m_Buffer;
+#ifdef _WIN32
+	HANDLE m_File;
+	HANDLE m_Mapping;
+#endif
+};
+
+//portable float map, "PF" = RGB, "Pf" = grayscale. Rows are stored bottom to top like GL textures,
+//RGB is expanded to RGBA
+bool DecodePFM(const std::string& path, int channels, PhysiCam::CPUImage& image)
+{
+	MappedFile file;
+	if (!file.Open(path))
+	{
+		std::cerr << "failed to open " << path << "\n";
+		return false;
+	}
+
+	//the header is three whitespace separated lines of text
+	std::string header(file.Data(), std::min<size_t>(file.Size(), 128));
+	char type[3] = { 0 };
+	int width, height, headerSize;
+	float scale;
+	if (sscanf(header.c_str(), "%2s %d %d %f%n", type, &width, &height, &scale, &headerSize) != 4 || width <= 0 || height <= 0 ||
+		(channels == 4 && strcmp(type, "PF") != 0) || (channels == 1 && strcmp(type, "Pf") != 0))
+	{
+		std::cerr << path << " is not a " << (channels == 4 ? "RGB" : "grayscale") << " PFM\n";
+		return false;
+	}
+	headerSize++;
+
+	int fileChannels = channels == 4 ? 3 : 1;
+	size_t count = (size_t)width * height * fileChannels;
+	if (file.Size() < headerSize + count * sizeof(float))
+	{
+		std::cerr << "unexpected end of " << path << "\n";
+		return false;
+	}
+
+	image.Width = width;
+	image.Height = height;
+	image.Channels = channels;
+	image.Pixels.resize((size_t)width * height * channels);
+
+	//a positive scale marks big endian data
+	uint16_t endianTest = 1;
+	bool swap = (scale > 0.0f) == (*(uint8_t*)&endianTest == 1);
+	const char *src = file.Data() + headerSize;
+	for (size_t i = 0, o = 0; i < count; i++)
+	{
+		uint8_t b[4];
+		memcpy(b, src + i * 4, 4);
+		if (swap)
+		{
+			std::swap(b[0], b[3]);
+			std::swap(b[1], b[2]);
+		}
+		memcpy(&image.Pixels[o++], b, 4);
+		if (channels == 4 && i % 3 == 2)
+			image.Pixels[o++] = 1.0f;
+	}
+	return true;
+}
+
+bool EndsWith(const std::string& s, const std::string& suffix)
+{
+	return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+//PFM keeps the float values of the tonemapped frame, PPM quantizes them to 8 bit
+bool EncodeFrame(const std::string& path, const PhysiCam::CPUImage& image)
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::cerr << "failed to open " << path << "\n";
+		return false;
+	}
+
+	int width = image.Width, height = image.Height;
+	if (EndsWith(path, ".pfm"))
+	{
+		uint16_t endianTest = 1;
+		file << "PF\n" << width << " " << height << "\n" << (*(uint8_t*)&endianTest == 1 ? "-1.0" : "1.0") << "\n";
+		std::vector<float> row(width * 3);
+		for (int y = 0; y < height; y++)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				for (int c = 0; c < 3; c++)
+					row[x * 3 + c] = image.Pixels[(y * width + x) * 4 + c];
+			}
+			file.write((const char*)row.data(), row.size() * sizeof(float));
+		}
+	}
+	else
+	{
+		file << "P6\n" << width << " " << height << "\n255\n";
+		std::vector<unsigned char> row(width * 3);
+		for (int y = height - 1; y >= 0; y--)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				for (int c = 0; c < 3; c++)
+				{
+					float value = std::min(std::max(image.Pixels[(y * width + x) * 4 + c], 0.0f), 1.0f);
+					row[x * 3 + c] = (unsigned char)(value * 255.0f + 0.5f);
+				}
+			}
+			file.write((const char*)row.data(), row.size());
+		}
+	}
+
+	if (!file)
+	{
+		std::cerr << "failed to write " << path << "\n";
+		return false;
+	}
+	return true;
+}
+
+std::string FramePath(const std::string& pattern, int frame)
+{
+	std::vector<char> path(pattern.size() + 32);
+	snprintf(path.data(), path.size(), pattern.c_str(), frame);
+	return path.data();
+}
+
+bool FileExists(const std::string& path)
+{
+	std::ifstream file(path);
+	return file.good();
+}
+
+
+/*** pipeline ***/
+
+struct BatchFrame
+{
+	int Frame;
+	bool Valid;
+	PhysiCam::CPUImage Color;
+	PhysiCam::CPUImage Depth;
+	PhysiCam::CPUImage Output;
+};
+
+//frames between two stages. Push blocks while the queue is full, Pop returns false once it is closed and drained
+class FrameQueue
+{
+public:
+	FrameQueue(int capacity) : m_Capacity(std::max(1, capacity)), m_Closed(false) {}
+
+	void Push(BatchFrame* frame)
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_NotFull.wait(lock, [this] { return (int)m_Frames.size() < m_Capacity; });
+		m_Frames.push_back(frame);
+		m_NotEmpty.notify_one();
+	}
+
+	bool Pop(BatchFrame*& frame)
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_NotEmpty.wait(lock, [this] { return !m_Frames.empty() || m_Closed; });
+		if (m_Frames.empty())
+			return false;
+
+		frame = m_Frames.front();
+		m_Frames.erase(m_Frames.begin());
+		m_NotFull.notify_one();
+		return true;
+	}
+
+	void Close()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Closed = true;
+		m_NotEmpty.notify_all();
+	}
+
+private:
+	int m_Capacity;
+	bool m_Closed;
+	std::vector<BatchFrame*> m_Frames;
+	std::mutex m_Mutex;
+	std::condition_variable m_NotFull;
+	std::condition_variable m_NotEmpty;
+};
+
+//decode -> process -> encode. The frames circulate through a free list, so their buffers are reused
+//and at most QueueSize * 2 + 2 frames exist
+int RunBatch(const BatchOptions& options, const BatchSettings& settings)
+{
+	FrameQueue freeFrames(options.QueueSize * 2 + 2), decoded(options.QueueSize), processed(options.QueueSize);
+	std::vector<std::unique_ptr<BatchFrame>> frames(options.QueueSize * 2 + 2);
+	for (auto &frame : frames)
+	{
+		frame.reset(new BatchFrame);
+		freeFrames.Push(frame.get());
+	}
+
+	int failed = 0, written = 0;
+	std::mutex countMutex;
+	auto fail = [&] {
+		std::lock_guard<std::mutex> lock(countMutex);
+		failed++;
+	};
+
+	std::thread decoder([&] {
+		for (int f = options.FirstFrame; options.LastFrame < 0 || f <= options.LastFrame; f++)
+		{
+			std::string colorPath = FramePath(options.ColorPattern, f);
+			if (options.LastFrame < 0 && !FileExists(colorPath))
+				break;
+
+			BatchFrame *frame = nullptr;
+			if (!freeFrames.Pop(frame))
+				break;
+			frame->Frame = f;
+			frame->Valid = DecodePFM(colorPath, 4, frame->Color) && DecodePFM(FramePath(options.DepthPattern, f), 1, frame->Depth);
+			decoded.Push(frame);
+		}
+		decoded.Close();
+	});
+
+	std::thread encoder([&] {
+		BatchFrame *frame;
+		while (processed.Pop(frame))
+		{
+			if (frame->Valid && EncodeFrame(FramePath(options.OutputPattern, frame->Frame), frame->Output))
+				written++;
+			else
+				fail();
+			freeFrames.Push(frame);
+		}
+	});
+
+	//the postprocessing itself is spread over its own thread pool
+	PhysiCam::CPUPostProcessor pp(options.Threads);
+	BatchFrame *frame;
+	while (decoded.Pop(frame))
+	{
+		if (frame->Valid)
+		{
+			ApplySettings(settings, frame->Frame, pp);
+			//grain changes from frame to frame like in a running camera
+			pp.SetGrainSeed((float)frame->Frame);
+			frame->Valid = pp.Render(frame->Color, frame->Depth, frame->Output);
+			if (!frame->Valid)
+				std::cerr << "frame " << frame->Frame << " failed\n";
+		}
+		processed.Push(frame);
+	}
+	processed.Close();
+
+	decoder.join();
+	encoder.join();
+
+	std::cerr << written << " frames written";
+	if (failed > 0)
+		std::cerr << ", " << failed << " failed";
+	std::cerr << "\n";
+	return failed > 0 || written == 0 ? 1 : 0;
+}
+
+
+/*** main ***/
+
+void PrintUsage()
+{
+	std::cerr << "usage: physicam_batch --color color.%04d.pfm --depth depth.%04d.pfm --output out.%04d.ppm\n"
+		<< "                      [--first 0] [--last N] [--settings camera.json] [--threads N] [--queue 4]\n";
+}
+
+bool ParseOptions(int argc, char** argv, BatchOptions& options)
+{
+	options.FirstFrame = 0;
+	options.LastFrame = -1;
+	options.Threads = 0;
+	options.QueueSize = 4;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (i + 1 >= argc)
+			return false;
+
+		std::string value = argv[++i];
+		if (arg == "--color")
+			options.ColorPattern = value;
+		else if (arg == "--depth")
+			options.DepthPattern = value;
+		else if (arg == "--output")
+			options.OutputPattern = value;
+		else if (arg == "--settings")
+			options.SettingsFile = value;
+		else if (arg == "--first")
+			options.FirstFrame = atoi(value.c_str());
+		else if (arg == "--last")
+			options.LastFrame = atoi(value.c_str());
+		else if (arg == "--threads")
+			options.Threads = (unsigned int)std::max(0, atoi(value.c_str()));
+		else if (arg == "--queue")
+			options.QueueSize = std::max(1, atoi(value.c_str()));
+		else
+			return false;
+	}
+	return !options.ColorPattern.empty() && !options.DepthPattern.empty() && !options.OutputPattern.empty();
+}
+
+int main(int argc, char** argv)
+{
+	BatchOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	BatchSettings settings;
+	if (!LoadSettings(options.SettingsFile, settings))
+		return 1;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	int exitCode = RunBatch(options, settings);
+	std::chrono::duration<double> seconds = std::chrono::high_resolution_clock::now() - start;
+	std::cerr << "took " << seconds.count() << " s\n";
+	return exitCode;
+}
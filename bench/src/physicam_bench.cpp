@@ -0,0 +1,1140 @@
+/*
+PhysiCam - Physically based camera
+Copyright (C) 2015 Frank Khnke
+
+This file is part of PhysiCam.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either
+version 3 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+*	@file physicam_bench.cpp
+*
+*	Headless benchmark of the postprocessing chain. Renders synthetic HDR color and depth inputs
+*	through Camera::RenderPostProcessing for a matrix of resolutions and effect settings and writes
+*	the wall clock and gpu timer query timings as JSON. Needs no window, with a surfaceless EGL
+*	(or OSMesa, define PC_BENCH_OSMESA) context it runs on Mesa llvmpipe without a gpu.
+*
+*	With --compare the optimised paths (reduced precision, pass fusion, compute blur, tiled DoF) are
+*	rendered with frozen grain and compared against the reference path instead. Every path has an error
+*	budget (PSNR, SSIM, share of outlier pixels) per effect combination, the exit code is 1 if one is exceeded.
+*/
+
+#include <GL/glew.h>
+#include <physicam.h>
+#include <physicam/physicam_gl.h>
+#include <physicam/CPUPostProcessor.h>
+
+#ifdef PC_BENCH_OSMESA
+#include <GL/osmesa.h>
+#else
+#define EGL_NO_X11
+#define MESA_EGL_NO_X11_HEADERS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include <sys/stat.h>
+#include <cerrno>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct BenchSize
+{
+	int Width;
+	int Height;
+};
+
+struct BenchEffects
+{
+	const char* Name;
+	bool Bloom;
+	bool DoF;
+	bool Tonemapping;
+};
+
+struct BenchPrecision
+{
+	const char* Name;
+	PhysiCam::PrecisionProfile Profile;
+};
+
+struct BenchOptions
+{
+	std::vector<BenchSize> Sizes;
+	int Frames;
+	int Warmup;
+	std::string Output;
+	bool Compare;
+	//--compare also checks CPUPostProcessor against the gpu reference
+	bool CompareCPU;
+	//scene fixtures as PFM (RGB color, single channel depth), the synthetic scene is used without
+	std::string ColorFixture;
+	std::string DepthFixture;
+	//directory the reference and the failed images of --compare are written to as PPM
+	std::string DumpDirectory;
+};
+
+//the effect combinations and precision profiles every resolution is measured with
+const static BenchEffects s_Effects[] =
+{
+	{ "none", false, false, false },
+	{ "tonemap", false, false, true },
+	{ "bloom", true, false, true },
+	{ "dof", false, true, true },
+	{ "all", true, true, true }
+};
+
+const static BenchPrecision s_Precisions[] =
+{
+	{ "Full32", PhysiCam::PrecisionProfile::Full32 },
+	{ "Half16", PhysiCam::PrecisionProfile::Half16 },
+	{ "Packed11_11_10", PhysiCam::PrecisionProfile::Packed11_11_10 }
+};
+
+
+/*** context ***/
+
+#ifdef PC_BENCH_OSMESA
+
+static OSMesaContext s_Context = nullptr;
+static unsigned char s_ContextBuffer[4];
+
+bool CreateContext()
+{
+	const int attribs[] =
+	{
+		OSMESA_FORMAT, OSMESA_RGBA,
+		OSMESA_PROFILE, OSMESA_COMPAT_PROFILE,
+		OSMESA_CONTEXT_MAJOR_VERSION, 4,
+		OSMESA_CONTEXT_MINOR_VERSION, 3,
+		0
+	};
+
+	s_Context = OSMesaCreateContextAttribs(attribs, nullptr);
+	if (!s_Context)
+	{
+		std::cerr << "failed to create an OSMesa context\n";
+		return false;
+	}
+
+	//everything is rendered into framebuffer objects, the default framebuffer is never used
+	if (!OSMesaMakeCurrent(s_Context, s_ContextBuffer, GL_UNSIGNED_BYTE, 1, 1))
+	{
+		std::cerr << "failed to make the OSMesa context current\n";
+		return false;
+	}
+	return true;
+}
+
+void DeleteContext()
+{
+	if (s_Context)
+		OSMesaDestroyContext(s_Context);
+	s_Context = nullptr;
+}
+
+#else
+
+static EGLDisplay s_Display = EGL_NO_DISPLAY;
+static EGLContext s_Context = EGL_NO_CONTEXT;
+
+bool CreateContext()
+{
+	//the surfaceless platform needs neither a window system nor a gpu
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay)
+		s_Display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	if (s_Display == EGL_NO_DISPLAY)
+		s_Display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	EGLint major, minor;
+	if (s_Display == EGL_NO_DISPLAY || !eglInitialize(s_Display, &major, &minor))
+	{
+		std::cerr << "failed to initialize EGL\n";
+		return false;
+	}
+
+	const char* extensions = eglQueryString(s_Display, EGL_EXTENSIONS);
+	if (!extensions || !strstr(extensions, "EGL_KHR_surfaceless_context") || !strstr(extensions, "EGL_KHR_no_config_context"))
+	{
+		std::cerr << "EGL_KHR_surfaceless_context and EGL_KHR_no_config_context are required\n";
+		return false;
+	}
+
+	if (!eglBindAPI(EGL_OPENGL_API))
+	{
+		std::cerr << "EGL does not support desktop OpenGL\n";
+		return false;
+	}
+
+	const EGLint attribs[] =
+	{
+		EGL_CONTEXT_MAJOR_VERSION, 4,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+		EGL_NONE
+	};
+
+	s_Context = eglCreateContext(s_Display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attribs);
+	if (s_Context == EGL_NO_CONTEXT)
+	{
+		std::cerr << "failed to create an OpenGL 4.3 context\n";
+		return false;
+	}
+
+	//everything is rendered into framebuffer objects, the context needs no surface
+	if (!eglMakeCurrent(s_Display, EGL_NO_SURFACE, EGL_NO_SURFACE, s_Context))
+	{
+		std::cerr << "failed to make the EGL context current\n";
+		return false;
+	}
+	return true;
+}
+
+void DeleteContext()
+{
+	if (s_Display == EGL_NO_DISPLAY)
+		return;
+
+	eglMakeCurrent(s_Display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	if (s_Context != EGL_NO_CONTEXT)
+		eglDestroyContext(s_Display, s_Context);
+	eglTerminate(s_Display);
+	s_Context = EGL_NO_CONTEXT;
+	s_Display = EGL_NO_DISPLAY;
+}
+
+#endif
+
+
+/*** synthetic inputs ***/
+
+struct BenchInputs
+{
+	GLuint Framebuffer;
+	GLuint Color;
+	GLuint Depth;
+	GLuint OutputFramebuffer;
+	GLuint OutputColor;
+};
+
+//HDR color (RGBA) and depth of the input framebuffer, rows bottom to top
+struct BenchScene
+{
+	int Width;
+	int Height;
+	std::vector<float> Color;
+	std::vector<float> Depth;
+};
+
+//sky gradient, a lit ground plane and a few very bright spots, so bloom, metering and the lense flare have something to work on.
+//the values are luminances of a sunny day in cd/m^2, the range the exposure of the camera is made for
+void GenerateColor(int width, int height, std::vector<float>& color)
+{
+	const float luminance = 2000.0f;
+	color.resize(width * height * 4);
+	for (int y = 0; y < height; y++)
+	{
+		float v = (y + 0.5f) / height;
+		for (int x = 0; x < width; x++)
+		{
+			float u = (x + 0.5f) / width;
+			float *c = &color[(y * width + x) * 4];
+
+			if (v > 0.4f)
+			{
+				c[0] = (0.4f + 0.6f * v) * luminance;
+				c[1] = (0.6f + 0.6f * v) * luminance;
+				c[2] = (1.2f + 0.8f * v) * luminance;
+			}
+			else
+			{
+				bool checker = ((int)(u * 16.0f) + (int)(v * 16.0f)) % 2 == 0;
+				float light = (checker ? 0.9f : 0.15f) * luminance;
+				c[0] = light * 0.8f;
+				c[1] = light * 0.7f;
+				c[2] = light * 0.5f;
+			}
+			c[3] = 1.0f;
+		}
+	}
+
+	const float spots[][4] = { { 0.75f, 0.8f, 0.03f, 200.0f }, { 0.2f, 0.3f, 0.01f, 50.0f }, { 0.5f, 0.55f, 0.005f, 500.0f } };
+	for (auto &spot : spots)
+	{
+		int cx = (int)(spot[0] * width), cy = (int)(spot[1] * height);
+		int r = std::max(1, (int)(spot[2] * height));
+		for (int y = std::max(0, cy - r); y < std::min(height, cy + r); y++)
+		{
+			for (int x = std::max(0, cx - r); x < std::min(width, cx + r); x++)
+			{
+				if ((x - cx) * (x - cx) + (y - cy) * (y - cy) > r * r)
+					continue;
+
+				float *c = &color[(y * width + x) * 4];
+				c[0] = c[1] = c[2] = spot[3] * luminance;
+			}
+		}
+	}
+}
+
+//far background above the horizon, a ground plane closing in towards the bottom and a near object in the center
+void GenerateDepth(int width, int height, std::vector<float>& depth)
+{
+	depth.resize(width * height);
+	for (int y = 0; y < height; y++)
+	{
+		float v = (y + 0.5f) / height;
+		for (int x = 0; x < width; x++)
+		{
+			float u = (x + 0.5f) / width;
+			float d = v > 0.4f ? 0.9999f : 0.95f + 0.0499f * (v / 0.4f);
+			if (std::abs(u - 0.5f) < 0.1f && std::abs(v - 0.35f) < 0.15f)
+				d = 0.9f;
+			depth[y * width + x] = d;
+		}
+	}
+}
+
+void GenerateScene(int width, int height, BenchScene& scene)
+{
+	scene.Width = width;
+	scene.Height = height;
+	GenerateColor(width, height, scene.Color);
+	GenerateDepth(width, height, scene.Depth);
+}
+
+//portable float map, "PF" = RGB, "Pf" = grayscale. Rows are stored bottom to top like GL textures
+bool LoadPFM(const std::string& path, int& width, int& height, int& channels, std::vector<float>& data)
+{
+	std::ifstream file(path, std::ios::binary);
+	std::string type;
+	float scale;
+	if (!(file >> type >> width >> height >> scale) || (type != "PF" && type != "Pf") || width <= 0 || height <= 0)
+	{
+		std::cerr << "failed to read the PFM header of " << path << "\n";
+		return false;
+	}
+	file.get();
+
+	channels = type == "PF" ? 3 : 1;
+	data.resize(width * height * channels);
+	if (!file.read((char*)&data[0], data.size() * sizeof(float)))
+	{
+		std::cerr << "unexpected end of " << path << "\n";
+		return false;
+	}
+
+	//a positive scale marks big endian data
+	uint16_t endianTest = 1;
+	bool littleEndianHost = *(uint8_t*)&endianTest == 1;
+	if ((scale > 0.0f) == littleEndianHost)
+	{
+		for (float &f : data)
+		{
+			uint8_t *b = (uint8_t*)&f;
+			std::swap(b[0], b[3]);
+			std::swap(b[1], b[2]);
+		}
+	}
+	return true;
+}
+
+bool LoadScene(const std::string& colorPath, const std::string& depthPath, BenchScene& scene)
+{
+	int channels, depthWidth, depthHeight, depthChannels;
+	std::vector<float> color;
+	if (!LoadPFM(colorPath, scene.Width, scene.Height, channels, color) ||
+		!LoadPFM(depthPath, depthWidth, depthHeight, depthChannels, scene.Depth))
+		return false;
+
+	if (channels != 3 || depthChannels != 1 || depthWidth != scene.Width || depthHeight != scene.Height)
+	{
+		std::cerr << "the color fixture has to be RGB and the depth fixture grayscale of the same size\n";
+		return false;
+	}
+
+	scene.Color.resize(scene.Width * scene.Height * 4);
+	for (int i = 0; i < scene.Width * scene.Height; i++)
+	{
+		scene.Color[i * 4] = color[i * 3];
+		scene.Color[i * 4 + 1] = color[i * 3 + 1];
+		scene.Color[i * 4 + 2] = color[i * 3 + 2];
+		scene.Color[i * 4 + 3] = 1.0f;
+	}
+	return true;
+}
+
+bool CreateInputs(const BenchScene& scene, BenchInputs& inputs)
+{
+	int width = scene.Width, height = scene.Height;
+
+	glGenTextures(1, &inputs.Color);
+	glBindTexture(GL_TEXTURE_2D, inputs.Color);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, GL_RGBA, GL_FLOAT, &scene.Color[0]);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glGenTextures(1, &inputs.Depth);
+	glBindTexture(GL_TEXTURE_2D, inputs.Depth);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, &scene.Depth[0]);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glGenFramebuffers(1, &inputs.Framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, inputs.Framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, inputs.Color, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, inputs.Depth, 0);
+	bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+	glGenTextures(1, &inputs.OutputColor);
+	glBindTexture(GL_TEXTURE_2D, inputs.OutputColor);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+	glGenFramebuffers(1, &inputs.OutputFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, inputs.OutputFramebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, inputs.OutputColor, 0);
+	complete = complete && glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	if (!complete)
+		std::cerr << "failed to create the " << width << "x" << height << " input framebuffers\n";
+	return complete;
+}
+
+void DeleteInputs(BenchInputs& inputs)
+{
+	glDeleteFramebuffers(1, &inputs.Framebuffer);
+	glDeleteFramebuffers(1, &inputs.OutputFramebuffer);
+	glDeleteTextures(1, &inputs.Color);
+	glDeleteTextures(1, &inputs.Depth);
+	glDeleteTextures(1, &inputs.OutputColor);
+}
+
+
+/*** measuring ***/
+
+struct BenchResult
+{
+	BenchSize Size;
+	const BenchEffects* Effects;
+	const BenchPrecision* Precision;
+	std::vector<float> WallTimes;
+	PhysiCam::PassTimings GPUTimings;
+	size_t RenderTargetMemory;
+};
+
+void Measure(PhysiCam::Camera& camera, const BenchInputs& inputs, const BenchOptions& options, BenchResult& result)
+{
+	PhysiCam::PostProcessor *pp = camera.GetPostProcessor();
+	pp->SetBloomEnabled(result.Effects->Bloom);
+	pp->SetDoFEnabled(result.Effects->DoF);
+	pp->SetTonemappingEnabled(result.Effects->Tonemapping);
+	pp->SetPrecisionProfile(result.Precision->Profile);
+
+	PhysiCam::PhysiCamFBOInputDesc desc;
+	desc.FramebufferId = inputs.Framebuffer;
+	desc.ColorTextureId = inputs.Color;
+	desc.depthBufferId = inputs.Depth;
+
+	//fixed time step, so eye adaption and the focus pull behave the same on every machine
+	const double deltaTime = 1.0 / 60.0;
+
+	//warm up lets the render target pool, the auto exposure and the autofocus settle
+	for (int i = 0; i < options.Warmup; i++)
+	{
+		camera.Update(deltaTime);
+		camera.RenderPostProcessing(desc, inputs.OutputFramebuffer);
+	}
+	glFinish();
+	pp->ResetPassTimings();
+
+	//every frame is finished before the next starts, the wall time covers cpu and gpu work of one frame
+	result.WallTimes.clear();
+	for (int i = 0; i < options.Frames; i++)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		camera.Update(deltaTime);
+		camera.RenderPostProcessing(desc, inputs.OutputFramebuffer);
+		glFinish();
+		auto end = std::chrono::high_resolution_clock::now();
+		result.WallTimes.push_back(std::chrono::duration<float, std::milli>(end - start).count());
+	}
+
+	result.GPUTimings = pp->GetPassTimings();
+	result.RenderTargetMemory = pp->GetRenderTargetMemory();
+}
+
+
+/*** report ***/
+
+std::string JsonString(const std::string& s)
+{
+	std::string out = "\"";
+	for (char c : s)
+	{
+		if (c == '"' || c == '\\')
+			out += '\\';
+		if ((unsigned char)c < 0x20)
+			c = ' ';
+		out += c;
+	}
+	return out + "\"";
+}
+
+float Percentile(std::vector<float> values, float p)
+{
+	if (values.empty())
+		return 0.0f;
+
+	std::sort(values.begin(), values.end());
+	return values[std::min(values.size() - 1, (size_t)(values.size() * p))];
+}
+
+void WriteReport(std::ostream& out, const BenchOptions& options, const std::vector<BenchResult>& results)
+{
+	out << "{\n";
+	out << "\t\"version\": " << JsonString(PHYSICAM_VERSION_STR) << ",\n";
+	out << "\t\"renderer\": " << JsonString((const char*)glGetString(GL_RENDERER)) << ",\n";
+	out << "\t\"gl_version\": " << JsonString((const char*)glGetString(GL_VERSION)) << ",\n";
+	out << "\t\"timer_query\": " << (PhysiCam::GL::HasTimerQuery ? "true" : "false") << ",\n";
+	out << "\t\"frames\": " << options.Frames << ",\n";
+	out << "\t\"warmup\": " << options.Warmup << ",\n";
+	out << "\t\"results\": [\n";
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchResult &r = results[i];
+		float mean = 0.0f;
+		for (float t : r.WallTimes)
+			mean += t;
+		mean /= std::max<size_t>(1, r.WallTimes.size());
+
+		out << "\t\t{\n";
+		out << "\t\t\t\"width\": " << r.Size.Width << ",\n";
+		out << "\t\t\t\"height\": " << r.Size.Height << ",\n";
+		out << "\t\t\t\"effects\": " << JsonString(r.Effects->Name) << ",\n";
+		out << "\t\t\t\"precision\": " << JsonString(r.Precision->Name) << ",\n";
+		out << "\t\t\t\"render_target_bytes\": " << r.RenderTargetMemory << ",\n";
+		out << "\t\t\t\"wall_ms\": { \"mean\": " << mean << ", \"median\": " << Percentile(r.WallTimes, 0.5f)
+			<< ", \"p95\": " << Percentile(r.WallTimes, 0.95f) << ", \"min\": " << Percentile(r.WallTimes, 0.0f)
+			<< ", \"max\": " << Percentile(r.WallTimes, 1.0f) << " },\n";
+		out << "\t\t\t\"gpu_ms\": " << r.GPUTimings.FrameTime << ",\n";
+		out << "\t\t\t\"passes\": [";
+
+		for (size_t j = 0; j < r.GPUTimings.Passes.size(); j++)
+		{
+			const PhysiCam::PassTiming &p = r.GPUTimings.Passes[j];
+			out << (j == 0 ? "\n" : ",\n");
+			out << "\t\t\t\t{ \"name\": " << JsonString(p.Name) << ", \"average\": " << p.Average << ", \"median\": " << p.Median
+				<< ", \"p95\": " << p.Percentile95 << ", \"max\": " << p.Max << ", \"samples\": " << p.Samples << " }";
+		}
+		out << (r.GPUTimings.Passes.empty() ? "]\n" : "\n\t\t\t]\n");
+		out << "\t\t}" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+
+	out << "\t]\n";
+	out << "}\n";
+}
+
+
+/*** quality comparison ***/
+
+//largest error an optimised path may introduce, measured on the 8 bit output.
+//a pixel is an outlier if one of its channels differs by more than OutlierError
+struct QualityBudget
+{
+	float MinPSNR;
+	float MinSSIM;
+	int OutlierError;
+	float MaxOutlierPercent;
+};
+
+//an optimisation switched on over the reference path, with a budget per entry of s_CompareEffects
+struct BenchVariant
+{
+	const char* Name;
+	void(*Apply)(PhysiCam::PostProcessor* pp);
+	bool(*Supported)(PhysiCam::PostProcessor* pp);
+	QualityBudget Budgets[4];
+};
+
+struct QualityResult
+{
+	float PSNR;
+	float SSIM;
+	int MaxError;
+	float OutlierPercent;
+};
+
+struct CompareResult
+{
+	BenchSize Size;
+	const BenchEffects* Effects;
+	const BenchVariant* Variant;
+	QualityBudget Budget;
+	QualityResult Quality;
+	bool Supported;
+	bool Passed;
+};
+
+//shorter side of the smallest compared image. below it the reference bloom blurs textures of a few texels and loses
+//light over their clamped edges, the dual Kawase bloom and the DoF paths move away from it by more than the budgets
+const static int s_MinCompareSize = 180;
+
+//without any effect all paths only differ in the final exposure pass, so that combination is not compared
+const static BenchEffects s_CompareEffects[] =
+{
+	{ "tonemap", false, false, true },
+	{ "bloom", true, false, true },
+	{ "dof", false, true, true },
+	{ "all", true, true, true }
+};
+
+static bool AlwaysSupported(PhysiCam::PostProcessor*) { return true; }
+
+//budgets, { PSNR, SSIM, outlier error, outlier % }:      tonemap                    bloom                      dof                        all
+const static BenchVariant s_Variants[] =
+{
+	{ "Half16",
+		[](PhysiCam::PostProcessor* pp) { pp->SetPrecisionProfile(PhysiCam::PrecisionProfile::Half16); }, AlwaysSupported,
+		{ { 50.0f, 0.999f, 2, 0.05f }, { 50.0f, 0.999f, 2, 0.05f }, { 50.0f, 0.999f, 2, 0.05f }, { 50.0f, 0.999f, 2, 0.05f } } },
+	{ "Packed11_11_10",
+		[](PhysiCam::PostProcessor* pp) { pp->SetPrecisionProfile(PhysiCam::PrecisionProfile::Packed11_11_10); }, AlwaysSupported,
+		{ { 45.0f, 0.995f, 4, 0.05f }, { 36.0f, 0.995f, 8, 0.05f }, { 42.0f, 0.995f, 4, 0.05f }, { 36.0f, 0.995f, 8, 0.05f } } },
+	//a few pixels of large images differ by up to 17, the fused shaders round intermediate values differently
+	{ "PassFusion",
+		[](PhysiCam::PostProcessor* pp) { pp->SetPassFusionEnabled(true); },
+		[](PhysiCam::PostProcessor* pp) { return pp->HasPassFusion(); },
+		{ { 60.0f, 0.9999f, 4, 0.01f }, { 60.0f, 0.9999f, 4, 0.01f }, { 60.0f, 0.9999f, 4, 0.01f }, { 60.0f, 0.9999f, 4, 0.01f } } },
+	{ "ComputeBloom",
+		[](PhysiCam::PostProcessor* pp) { pp->SetComputeBloomEnabled(true); },
+		[](PhysiCam::PostProcessor* pp) { return pp->HasComputeBloom(); },
+		{ { 60.0f, 0.9999f, 2, 0.01f }, { 60.0f, 0.9999f, 2, 0.01f }, { 60.0f, 0.9999f, 2, 0.01f }, { 60.0f, 0.9999f, 2, 0.01f } } },
+	{ "LinearGaussian",
+		[](PhysiCam::PostProcessor* pp) { pp->SetBloomFilter(PhysiCam::BloomFilter::LinearGaussian); }, AlwaysSupported,
+		{ { 60.0f, 0.9999f, 2, 0.01f }, { 50.0f, 0.999f, 2, 0.01f }, { 60.0f, 0.9999f, 2, 0.01f }, { 50.0f, 0.999f, 2, 0.01f } } },
+	//another kernel than the gaussian of the reference, the difference is spread evenly over the bloom halos.
+	//it is largest at small sizes, where the reference loses light at the edges of its smallest levels
+	{ "DualKawase",
+		[](PhysiCam::PostProcessor* pp) { pp->SetBloomFilter(PhysiCam::BloomFilter::DualKawase); }, AlwaysSupported,
+		{ { 60.0f, 0.9999f, 2, 0.01f }, { 32.0f, 0.993f, 16, 5.0f }, { 60.0f, 0.9999f, 2, 0.01f }, { 32.0f, 0.993f, 16, 5.0f } } },
+	//the rims of bokeh highlights are gathered per pixel like the reference. Single pixels there still flip a fringe color,
+	//the dither of the reference hashes the texture coordinate and does not repeat for coordinates a few ulps apart
+	{ "TiledDoF",
+		[](PhysiCam::PostProcessor* pp) { pp->SetDoFTiled(true); },
+		[](PhysiCam::PostProcessor* pp) { return pp->HasTiledDoF(); },
+		{ { 60.0f, 0.9999f, 2, 0.01f }, { 60.0f, 0.9999f, 2, 0.01f }, { 44.0f, 0.994f, 8, 0.25f }, { 45.0f, 0.995f, 8, 0.25f } } }
+};
+
+//the cpu backend runs the same stages. most of the difference is grain, its hash of large sin() arguments
+//does not match the gpu and the SSIM drops with the image size, the outliers are single pixels at the DoF highlights
+const static BenchVariant s_CPUVariant =
+	{ "CPU", nullptr, AlwaysSupported,
+		{ { 40.0f, 0.93f, 16, 0.01f }, { 40.0f, 0.93f, 16, 0.01f }, { 40.0f, 0.93f, 16, 0.25f }, { 40.0f, 0.93f, 16, 0.1f } } };
+
+//the straightforward path every optimisation is compared against: full precision, one pass per effect, fragment blur, per pixel DoF
+void ApplyReference(PhysiCam::Camera& camera, const BenchEffects& effects)
+{
+	PhysiCam::PostProcessor *pp = camera.GetPostProcessor();
+	pp->SetBloomEnabled(effects.Bloom);
+	pp->SetDoFEnabled(effects.DoF);
+	pp->SetTonemappingEnabled(effects.Tonemapping);
+	pp->SetPrecisionProfile(PhysiCam::PrecisionProfile::Full32);
+	pp->SetPassFusionEnabled(false);
+	pp->SetComputeBloomEnabled(false);
+	pp->SetBloomFilter(PhysiCam::BloomFilter::IncrementalGaussian);
+	pp->SetDoFTiled(false);
+	pp->SetGPUTimeBudget(0.0f);
+
+	//no state carried between frames: manual exposure, manual focus and frozen grain.
+	//ISO 100, f/8 and 1/125 s expose the sunny synthetic scene
+	camera.UseAutoExposure(false);
+	camera.SetIso(100.0f);
+	camera.SetAperture(8.0f);
+	camera.SetShutterSpeed(1.0f / 125.0f);
+	pp->SetDoFAutofocus(false);
+	pp->SetGrainSeed(1.0f);
+	pp->SetGrainAnimated(false);
+}
+
+void RenderImage(PhysiCam::Camera& camera, const BenchInputs& inputs, const BenchScene& scene, int frames, std::vector<unsigned char>& pixels)
+{
+	PhysiCam::PhysiCamFBOInputDesc desc;
+	desc.FramebufferId = inputs.Framebuffer;
+	desc.ColorTextureId = inputs.Color;
+	desc.depthBufferId = inputs.Depth;
+
+	//the first frames after a change allocate render targets and upload kernels, only the last one is compared
+	for (int i = 0; i < frames; i++)
+	{
+		camera.Update(1.0 / 60.0);
+		camera.RenderPostProcessing(desc, inputs.OutputFramebuffer);
+	}
+
+	pixels.resize(scene.Width * scene.Height * 4);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, inputs.OutputFramebuffer);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, scene.Width, scene.Height, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
+
+//PSNR, max error and outliers over RGB, SSIM of the luma in 8x8 windows with a stride of 4
+QualityResult CompareImages(const std::vector<unsigned char>& reference, const std::vector<unsigned char>& image, int width, int height,
+	int outlierError)
+{
+	QualityResult result;
+	double squaredError = 0.0;
+	int outliers = 0;
+	result.MaxError = 0;
+	for (int i = 0; i < width * height; i++)
+	{
+		int pixelError = 0;
+		for (int c = 0; c < 3; c++)
+		{
+			int error = std::abs(reference[i * 4 + c] - image[i * 4 + c]);
+			squaredError += error * error;
+			pixelError = std::max(pixelError, error);
+		}
+		result.MaxError = std::max(result.MaxError, pixelError);
+		if (pixelError > outlierError)
+			outliers++;
+	}
+	result.OutlierPercent = 100.0f * outliers / (width * height);
+	double mse = squaredError / (width * height * 3.0);
+	result.PSNR = mse > 0.0 ? (float)std::min(100.0, 10.0 * std::log10(255.0 * 255.0 / mse)) : 100.0f;
+
+	std::vector<float> lumaA(width * height), lumaB(width * height);
+	for (int i = 0; i < width * height; i++)
+	{
+		lumaA[i] = 0.2126f * reference[i * 4] + 0.7152f * reference[i * 4 + 1] + 0.0722f * reference[i * 4 + 2];
+		lumaB[i] = 0.2126f * image[i * 4] + 0.7152f * image[i * 4 + 1] + 0.0722f * image[i * 4 + 2];
+	}
+
+	const double c1 = (0.01 * 255.0) * (0.01 * 255.0), c2 = (0.03 * 255.0) * (0.03 * 255.0);
+	const int window = 8, stride = 4;
+	double ssim = 0.0;
+	int windows = 0;
+	for (int y = 0; y + window <= height; y += stride)
+	{
+		for (int x = 0; x + window <= width; x += stride)
+		{
+			double meanA = 0.0, meanB = 0.0;
+			for (int wy = 0; wy < window; wy++)
+			{
+				for (int wx = 0; wx < window; wx++)
+				{
+					meanA += lumaA[(y + wy) * width + x + wx];
+					meanB += lumaB[(y + wy) * width + x + wx];
+				}
+			}
+			meanA /= window * window;
+			meanB /= window * window;
+
+			double varA = 0.0, varB = 0.0, covariance = 0.0;
+			for (int wy = 0; wy < window; wy++)
+			{
+				for (int wx = 0; wx < window; wx++)
+				{
+					double a = lumaA[(y + wy) * width + x + wx] - meanA;
+					double b = lumaB[(y + wy) * width + x + wx] - meanB;
+					varA += a * a;
+					varB += b * b;
+					covariance += a * b;
+				}
+			}
+			varA /= window * window - 1;
+			varB /= window * window - 1;
+			covariance /= window * window - 1;
+
+			ssim += ((2.0 * meanA * meanB + c1) * (2.0 * covariance + c2)) / ((meanA * meanA + meanB * meanB + c1) * (varA + varB + c2));
+			windows++;
+		}
+	}
+	result.SSIM = windows > 0 ? (float)(ssim / windows) : 1.0f;
+	return result;
+}
+
+void WritePPM(const std::string& path, const std::vector<unsigned char>& pixels, int width, int height)
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::cerr << "failed to open " << path << "\n";
+		return;
+	}
+
+	file << "P6\n" << width << " " << height << "\n255\n";
+	for (int y = height - 1; y >= 0; y--)
+	{
+		for (int x = 0; x < width; x++)
+			file.write((const char*)&pixels[(y * width + x) * 4], 3);
+	}
+}
+
+std::string ImageName(const BenchOptions& options, const BenchScene& scene, const BenchEffects& effects, const char* variant)
+{
+	std::stringstream ss;
+	ss << options.DumpDirectory << "/" << scene.Width << "x" << scene.Height << "_" << effects.Name << "_" << variant << ".ppm";
+	return ss.str();
+}
+
+void RenderCPUImage(PhysiCam::CPUPostProcessor& cpu, PhysiCam::Camera& camera, const BenchScene& scene, std::vector<unsigned char>& pixels)
+{
+	PhysiCam::CPUImage color(scene.Width, scene.Height, 4), depth(scene.Width, scene.Height, 1), output;
+	color.Pixels = scene.Color;
+	depth.Pixels = scene.Depth;
+
+	cpu.CopySettings(&camera);
+	cpu.Render(color, depth, output);
+
+	pixels.resize(scene.Width * scene.Height * 4);
+	for (size_t i = 0; i < pixels.size(); i++)
+		pixels[i] = (unsigned char)(std::min(std::max(output.Pixels[i], 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+void PrintCompareResult(const CompareResult& result)
+{
+	std::cerr << result.Size.Width << "x" << result.Size.Height << " " << result.Effects->Name << " " << result.Variant->Name << ": ";
+	if (result.Supported)
+	{
+		std::cerr << "PSNR " << result.Quality.PSNR << " SSIM " << result.Quality.SSIM << " max error " << result.Quality.MaxError
+			<< " outliers " << result.Quality.OutlierPercent << "%" << (result.Passed ? "" : " FAILED") << "\n";
+	}
+	else
+		std::cerr << "not supported\n";
+}
+
+CompareResult CreateCompareResult(const BenchScene& scene, const BenchEffects& effects, const BenchVariant& variant, size_t effectIndex)
+{
+	CompareResult result;
+	result.Size.Width = scene.Width;
+	result.Size.Height = scene.Height;
+	result.Effects = &effects;
+	result.Variant = &variant;
+	result.Budget = variant.Budgets[effectIndex];
+	result.Quality = { 0.0f, 0.0f, 0, 0.0f };
+	result.Supported = true;
+	result.Passed = true;
+	return result;
+}
+
+void EvaluateCompareResult(const BenchOptions& options, const BenchScene& scene, const std::vector<unsigned char>& reference,
+	const std::vector<unsigned char>& image, CompareResult& result)
+{
+	result.Quality = CompareImages(reference, image, scene.Width, scene.Height, result.Budget.OutlierError);
+	result.Passed = result.Quality.PSNR >= result.Budget.MinPSNR && result.Quality.SSIM >= result.Budget.MinSSIM &&
+		result.Quality.OutlierPercent <= result.Budget.MaxOutlierPercent;
+
+	if (!result.Passed && !options.DumpDirectory.empty())
+		WritePPM(ImageName(options, scene, *result.Effects, result.Variant->Name), image, scene.Width, scene.Height);
+}
+
+void CompareVariants(PhysiCam::Camera& camera, PhysiCam::CPUPostProcessor* cpu, const BenchInputs& inputs, const BenchScene& scene,
+	const BenchOptions& options, std::vector<CompareResult>& results)
+{
+	PhysiCam::PostProcessor *pp = camera.GetPostProcessor();
+	int frames = std::max(1, options.Warmup) + 1;
+
+	for (size_t e = 0; e < sizeof(s_CompareEffects) / sizeof(s_CompareEffects[0]); e++)
+	{
+		const BenchEffects &effects = s_CompareEffects[e];
+		std::vector<unsigned char> reference, image;
+		ApplyReference(camera, effects);
+		RenderImage(camera, inputs, scene, frames, reference);
+		if (!options.DumpDirectory.empty())
+			WritePPM(ImageName(options, scene, effects, "reference"), reference, scene.Width, scene.Height);
+
+		for (auto &variant : s_Variants)
+		{
+			CompareResult result = CreateCompareResult(scene, effects, variant, e);
+
+			//paths without driver support fall back to the reference, there is nothing to compare
+			ApplyReference(camera, effects);
+			variant.Apply(pp);
+			result.Supported = variant.Supported(pp);
+			if (result.Supported)
+			{
+				RenderImage(camera, inputs, scene, frames, image);
+				EvaluateCompareResult(options, scene, reference, image, result);
+			}
+			results.push_back(result);
+			PrintCompareResult(result);
+		}
+
+		if (cpu)
+		{
+			CompareResult result = CreateCompareResult(scene, effects, s_CPUVariant, e);
+			ApplyReference(camera, effects);
+			RenderCPUImage(*cpu, camera, scene, image);
+			EvaluateCompareResult(options, scene, reference, image, result);
+			results.push_back(result);
+			PrintCompareResult(result);
+		}
+	}
+}
+
+void WriteCompareReport(std::ostream& out, const std::vector<CompareResult>& results)
+{
+	out << "{\n";
+	out << "\t\"version\": " << JsonString(PHYSICAM_VERSION_STR) << ",\n";
+	out << "\t\"renderer\": " << JsonString((const char*)glGetString(GL_RENDERER)) << ",\n";
+	out << "\t\"gl_version\": " << JsonString((const char*)glGetString(GL_VERSION)) << ",\n";
+	out << "\t\"results\": [\n";
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const CompareResult &r = results[i];
+		out << "\t\t{ \"width\": " << r.Size.Width << ", \"height\": " << r.Size.Height << ", \"effects\": " << JsonString(r.Effects->Name)
+			<< ", \"variant\": " << JsonString(r.Variant->Name) << ", \"supported\": " << (r.Supported ? "true" : "false")
+			<< ", \"psnr\": " << r.Quality.PSNR << ", \"ssim\": " << r.Quality.SSIM << ", \"max_error\": " << r.Quality.MaxError
+			<< ", \"outlier_percent\": " << r.Quality.OutlierPercent
+			<< ", \"budget\": { \"psnr\": " << r.Budget.MinPSNR << ", \"ssim\": " << r.Budget.MinSSIM << ", \"outlier_error\": " << r.Budget.OutlierError
+			<< ", \"outlier_percent\": " << r.Budget.MaxOutlierPercent << " }"
+			<< ", \"passed\": " << (r.Passed ? "true" : "false") << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+
+	out << "\t]\n";
+	out << "}\n";
+}
+
+
+/*** main ***/
+
+void PrintUsage()
+{
+	std::cerr << "usage: physicam_bench [--sizes 1280x720,1920x1080] [--frames 60] [--warmup 10] [--output report.json]\n"
+		<< "                      [--color fixture.pfm --depth fixture.pfm] [--compare [--cpu] [--dump directory]]\n"
+		<< "--compare needs images of at least " << s_MinCompareSize << " pixels on the shorter side\n";
+}
+
+bool ParseSizes(const std::string& arg, std::vector<BenchSize>& sizes)
+{
+	sizes.clear();
+	std::stringstream ss(arg);
+	std::string item;
+	while (std::getline(ss, item, ','))
+	{
+		BenchSize size;
+		if (sscanf(item.c_str(), "%dx%d", &size.Width, &size.Height) != 2 || size.Width <= 0 || size.Height <= 0)
+			return false;
+		sizes.push_back(size);
+	}
+	return !sizes.empty();
+}
+
+bool ParseOptions(int argc, char** argv, BenchOptions& options)
+{
+	options.Sizes = { { 640, 360 }, { 1280, 720 }, { 1920, 1080 } };
+	options.Frames = 60;
+	options.Warmup = 10;
+	options.Compare = false;
+	options.CompareCPU = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--compare")
+		{
+			options.Compare = true;
+			continue;
+		}
+		if (arg == "--cpu")
+		{
+			options.CompareCPU = true;
+			continue;
+		}
+
+		if (i + 1 >= argc)
+			return false;
+
+		std::string value = argv[++i];
+		if (arg == "--sizes")
+		{
+			if (!ParseSizes(value, options.Sizes))
+				return false;
+		}
+		else if (arg == "--frames")
+			options.Frames = std::max(1, atoi(value.c_str()));
+		else if (arg == "--warmup")
+			options.Warmup = std::max(0, atoi(value.c_str()));
+		else if (arg == "--output")
+			options.Output = value;
+		else if (arg == "--color")
+			options.ColorFixture = value;
+		else if (arg == "--depth")
+			options.DepthFixture = value;
+		else if (arg == "--dump")
+			options.DumpDirectory = value;
+		else
+			return false;
+	}
+	return options.ColorFixture.empty() == options.DepthFixture.empty();
+}
+
+//the fixture if one is given, otherwise the synthetic scene in every requested size
+bool LoadScenes(const BenchOptions& options, std::vector<BenchScene>& scenes)
+{
+	if (!options.ColorFixture.empty())
+	{
+		scenes.resize(1);
+		return LoadScene(options.ColorFixture, options.DepthFixture, scenes[0]);
+	}
+
+	scenes.resize(options.Sizes.size());
+	for (size_t i = 0; i < options.Sizes.size(); i++)
+		GenerateScene(options.Sizes[i].Width, options.Sizes[i].Height, scenes[i]);
+	return true;
+}
+
+//rejects images below the budgeted size and creates the --dump directory before anything is rendered
+bool PrepareCompare(const BenchOptions& options, const std::vector<BenchScene>& scenes)
+{
+	for (auto &scene : scenes)
+	{
+		if (std::min(scene.Width, scene.Height) < s_MinCompareSize)
+		{
+			std::cerr << "--compare needs images of at least " << s_MinCompareSize << " pixels on the shorter side, got "
+				<< scene.Width << "x" << scene.Height << "\n";
+			return false;
+		}
+	}
+
+	if (!options.DumpDirectory.empty() && mkdir(options.DumpDirectory.c_str(), 0755) != 0 && errno != EEXIST)
+	{
+		std::cerr << "failed to create " << options.DumpDirectory << ": " << strerror(errno) << "\n";
+		return false;
+	}
+	return true;
+}
+
+template<typename Report>
+void WriteOutput(const BenchOptions& options, Report report)
+{
+	if (options.Output.empty())
+	{
+		report(std::cout);
+		return;
+	}
+
+	std::ofstream file(options.Output);
+	if (!file)
+		std::cerr << "failed to open " << options.Output << "\n";
+	else
+		report(file);
+}
+
+int main(int argc, char** argv)
+{
+	BenchOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	std::vector<BenchScene> scenes;
+	if (!LoadScenes(options, scenes))
+		return 1;
+	if (options.Compare && !PrepareCompare(options, scenes))
+		return 1;
+
+	if (!CreateContext())
+		return 1;
+
+	if (!PhysiCam::Camera::Init())
+	{
+		std::cerr << "failed to initialize PhysiCam\n";
+		DeleteContext();
+		return 1;
+	}
+
+	std::vector<BenchResult> results;
+	std::vector<CompareResult> compareResults;
+	{
+		PhysiCam::Camera camera(scenes[0].Width, scenes[0].Height);
+		camera.GetPostProcessor()->WaitUntilReady();
+		PhysiCam::CPUPostProcessor cpu;
+
+		for (auto &scene : scenes)
+		{
+			BenchInputs inputs;
+			if (!CreateInputs(scene, inputs))
+			{
+				DeleteInputs(inputs);
+				continue;
+			}
+			camera.UpdateScreenSize(scene.Width, scene.Height);
+
+			if (options.Compare)
+			{
+				CompareVariants(camera, options.CompareCPU ? &cpu : nullptr, inputs, scene, options, compareResults);
+				DeleteInputs(inputs);
+				continue;
+			}
+
+			BenchSize size = { scene.Width, scene.Height };
+			for (auto &precision : s_Precisions)
+			{
+				for (auto &effects : s_Effects)
+				{
+					BenchResult result;
+					result.Size = size;
+					result.Effects = &effects;
+					result.Precision = &precision;
+					Measure(camera, inputs, options, result);
+					results.push_back(result);
+
+					std::cerr << size.Width << "x" << size.Height << " " << precision.Name << " " << effects.Name
+						<< ": " << Percentile(result.WallTimes, 0.5f) << " ms\n";
+				}
+			}
+
+			DeleteInputs(inputs);
+		}
+	}
+
+	int exitCode = 0;
+	if (options.Compare)
+	{
+		WriteOutput(options, [&](std::ostream& out) { WriteCompareReport(out, compareResults); });
+		for (auto &result : compareResults)
+		{
+			if (!result.Passed)
+				exitCode = 1;
+		}
+	}
+	else
+		WriteOutput(options, [&](std::ostream& out) { WriteReport(out, options, results); });
+
+	DeleteContext();
+	return exitCode;
+}
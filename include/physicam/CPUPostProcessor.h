@@ -0,0 +1,201 @@
+/*
+	PhysiCam - Physically based camera
+	Copyright (C) 2015 Frank Khnke
+
+	This file is part of PhysiCam.
+
+	This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License 
+	as published by the Free Software Foundation; either 
+	version 3 of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ *	@file CPUPostProcessor.h
+ */
+
+#pragma once
+
+#include <physicam/physicam_def.h>
+#include <physicam/PostProcessing.h>
+#include <physicam/ThreadPool.h>
+
+#include <vector>
+
+//rows per work item of the thread pool
+#define PC_CPU_ROWS_PER_TASK			8
+
+namespace PhysiCam
+{
+	//float image, rows from bottom to top like a GL texture
+	struct CPUImage
+	{
+		int Width;
+		int Height;
+		//4 = RGBA color, 1 = depth buffer values in [0,1]
+		int Channels;
+		std::vector<float> Pixels;
+
+		CPUImage() : Width(0), Height(0), Channels(4) {}
+		CPUImage(int width, int height, int channels = 4) : Width(width), Height(height), Channels(channels), Pixels(width * height * channels, 0.0f) {}
+	};
+
+	//the camera parameters the postprocessing depends on, see Camera for their meaning. defaults as in Camera
+	struct CPUCameraSettings
+	{
+		float Iso;
+		float MaxIso;
+		float Aperture;
+		float ShutterSpeed;
+		float FocalLength;
+		float CoC;
+		float ClipNear;
+		float ClipFar;
+
+		CPUCameraSettings() : Iso(100.0f), MaxIso(6400.0f), Aperture(7.5f), ShutterSpeed(0.0025f), FocalLength(36.0f), CoC(0.03f),
+			ClipNear(0.5f), ClipFar(1000.0f) {}
+	};
+
+	class Camera;
+
+	/*
+	* Postprocessing chain of PostProcessor on the cpu, for offline frames on machines without a gpu:
+	* lense distortion, exposure, bloom with lense flare, DoF and tonemapping with grain. The stages follow
+	* the shaders of the reference path (full precision, fragment blur, per pixel DoF), the work is split
+	* into bands of rows over a thread pool and the inner loops use SSE/AVX where the compiler targets it.
+	* Exposure is manual, autofocus uses the depth at the screen center and there is no lense dirt texture.
+	*/
+	class PHYSICAM_DLL CPUPostProcessor
+	{
+	public:
+		//0 = one thread per hardware thread
+		CPUPostProcessor(unsigned int threadCount = 0);
+		~CPUPostProcessor();
+
+		//color has to be RGBA, depth single channel of the same size. output gets resized, false for invalid inputs
+		bool Render(const CPUImage& color, const CPUImage& depth, CPUImage& output);
+
+		//takes over the camera parameters and the effect settings of a camera, so both produce matching images
+		void CopySettings(Camera* camera);
+
+		CPUCameraSettings GetCameraSettings() const { return m_CameraSettings; }
+		void SetCameraSettings(const CPUCameraSettings& val) { m_CameraSettings = val; }
+
+		unsigned int GetThreadCount() const { return m_ThreadPool.GetThreadCount(); }
+
+		/*** postprocessing effects functions, as in PostProcessor ***/
+
+		/* Bloom */
+		bool BloomEnabled() const { return m_BloomEnabled; }
+		void SetBloomEnabled(bool val) { m_BloomEnabled = val; }
+
+		float BloomThreshold() const { return m_BloomThreshold; }
+		void SetBloomThreshold(float val) { m_BloomThreshold = val; }
+
+		float BloomSpread(int id) const { return m_BloomSpreads[id]; }
+		void SetBloomSpead(int id, float val) { m_BloomSpreads[id] = val; }
+		float BloomIntensity() const { return m_BloomIntensity; }
+		void SetBloomIntensity(float val) { m_BloomIntensity = val; }
+		float BloomIntensity(int id) const { return m_BloomStrengths[id]; }
+		void SetBloomIntensity(int id, float val) { m_BloomStrengths[id] = val; }
+
+		/* Tonemapping */
+		bool TonemappingEnabled() const { return m_ToneMappingEnabled; }
+		void SetTonemappingEnabled(bool val) { m_ToneMappingEnabled = val; }
+		TonemappingMethod GetTonemappingMethod() const { return m_ToneMappingMethod; }
+		void SetTonemappingMethod(TonemappingMethod method) { m_ToneMappingMethod = method; }
+
+		/* DoF */
+		bool DoFEnabled() const { return m_DoFEnabled; }
+		void SetDoFEnabled(bool val) { m_DoFEnabled = val; }
+
+		float DoFAberation() const { return m_DoFAberation; }
+		void SetDoFAberation(float val) { m_DoFAberation = val; }
+
+		float DoFFocalDistance() const { return m_DoFFocalDistance; }
+		void SetDoFFocalDistance(float val) { m_DoFFocalDistance = val; }
+
+		bool DoFAutofocus() const { return m_DoFAutofocus; }
+		void SetDoFAutofocus(bool val) { m_DoFAutofocus = val; }
+
+		bool DoFShowFocus() const { return m_DoFShowFocus; }
+		void SetDoFShowFocus(bool val) { m_DoFShowFocus = val; }
+
+		bool DoFVignetting() const { return m_DoFVignetting; }
+		void SetDoFVignetting(bool val) { m_DoFVignetting = val; }
+
+		float DoFMaxBlur() const { return m_DoFMaxBlur; }
+		void SetDoFMaxBlur(float val) { m_DoFMaxBlur = val; }
+
+		float LensDistortionAmount() const { return m_LensDistortionAmount; }
+		void SetLensDistortionAmount(float val) { m_LensDistortionAmount = val; }
+
+		float MaxNoise() const { return m_MaxNoise; }
+		void SetMaxNoise(float val) { m_MaxNoise = val; }
+		float MinNoise() const { return m_MinNoise; }
+		void SetMinNoise(float val) { m_MinNoise = val; }
+
+		//grain is a function of the seed only, offline frames set a new seed per frame to animate it
+		float GrainSeed() const { return m_GrainSeed; }
+		void SetGrainSeed(float val) { m_GrainSeed = val; }
+
+	private:
+		void ApplyLenseDistortion(const CPUImage& color, const CPUImage& depth, float exposure);
+		void ApplyBloom();
+		void ApplyBrightPass(const CPUImage& input, CPUImage& bright, CPUImage& flareBright);
+		void ApplyBloomBlur(CPUImage& image, CPUImage& temp, float radius);
+		void ApplyLenseFlare(const CPUImage& input, CPUImage& output);
+		void ApplyDoF(const CPUImage& input, const CPUImage& depth, CPUImage& output);
+		void ApplyToneMapping(const CPUImage& input, CPUImage& output);
+
+		//bilinear resampling of the whole image, like a full screen pass reading a texture of another size
+		void Resample(const CPUImage& input, CPUImage& output);
+
+		void ParallelRows(int height, const std::function<void(int, int)>& func);
+
+		ThreadPool m_ThreadPool;
+		CPUCameraSettings m_CameraSettings;
+
+		//intermediates, kept between frames of the same size
+		CPUImage m_LensColor;
+		CPUImage m_LensDepth;
+		CPUImage m_Bright;
+		CPUImage m_FlareBright;
+		CPUImage m_BloomLevels[5];
+		CPUImage m_BloomTemp;
+		CPUImage m_BloomCompose;
+		CPUImage m_LenseFlare;
+		CPUImage m_Composed;
+		CPUImage m_DoF;
+
+		bool m_BloomEnabled;
+		float m_BloomThreshold;
+		float m_BloomSpreads[5];
+		float m_BloomStrengths[5];
+		float m_BloomIntensity;
+
+		bool m_ToneMappingEnabled;
+		TonemappingMethod m_ToneMappingMethod;
+
+		bool m_DoFEnabled;
+		float m_DoFAberation;
+		float m_DoFFocalDistance;
+		bool m_DoFAutofocus;
+		bool m_DoFShowFocus;
+		bool m_DoFVignetting;
+		float m_DoFMaxBlur;
+
+		float m_LensDistortionAmount;
+		float m_MaxNoise;
+		float m_MinNoise;
+		float m_GrainSeed;
+	};
+}
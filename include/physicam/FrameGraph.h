@@ -0,0 +1,141 @@
+/*
+	PhysiCam - Physically based camera
+	Copyright (C) 2015 Frank Khnke
+
+	This file is part of PhysiCam.
+
+	This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License 
+	as published by the Free Software Foundation; either 
+	version 3 of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ *	@file FrameGraph.h
+ */
+
+#pragma once
+
+#include <physicam/physicam_def.h>
+#include <physicam/RenderTargetPool.h>
+#include <physicam/GPUProfiler.h>
+
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#define PC_FRAMEGRAPH_MAX_READS		8
+//bytes a pass callback may capture, the callbacks are stored inside the pass so building the graph does not allocate
+#define PC_FRAMEGRAPH_PASS_CAPTURE	64
+
+namespace PhysiCam
+{
+	//handle of a texture declared in a frame graph, -1 is invalid
+	typedef int FrameGraphResource;
+
+	/*
+	* Minimal frame graph for the postprocessing chain.
+	* Passes declare the textures they read and write, passes whose results are never read
+	* (and which have no side effect like writing to the output framebuffer) are culled.
+	* Transient textures are only allocated between their first and last use and are taken from
+	* a RenderTargetPool, so textures with non-overlapping lifetimes share the same memory.
+	*/
+	class PHYSICAM_DLL FrameGraph
+	{
+	public:
+		typedef void (*ExecuteFunc)(FrameGraph&, const void* capture);
+
+		FrameGraph(RenderTargetPool *pool);
+
+		//every executed pass is timed as a scope named after the pass, null disables it
+		void SetProfiler(GPUProfiler *profiler) { m_Profiler = profiler; }
+
+		//removes all passes and resources, call before building the graph for a new frame
+		void Reset();
+
+		FrameGraphResource CreateTexture(const char* name, const RenderTargetDesc& desc);
+		//texture owned by the application (i.e. the scene color buffer), never allocated or released
+		FrameGraphResource ImportTexture(const char* name, unsigned int textureId, glm::ivec2 size);
+		//texture kept across frames by the caller (i.e. a history buffer), passes can render to it as well
+		FrameGraphResource ImportTexture(const char* name, RenderTexturePtr texture);
+
+		//func is called with the graph when the pass executes, its captures are copied into the pass
+		template<typename F> int AddPass(const char* name, const F& func)
+		{
+			static_assert(sizeof(F) <= PC_FRAMEGRAPH_PASS_CAPTURE, "pass captures more than PC_FRAMEGRAPH_PASS_CAPTURE bytes");
+			//the captures are never destroyed and move bytewise with the pass list, so only plain values (handles, sizes, flags)
+			static_assert(std::is_trivially_destructible<F>::value, "pass captures have to be plain values");
+
+			ExecuteFunc execute = [](FrameGraph &g, const void *capture) { (*static_cast<const F*>(capture))(g); };
+			int pass = AddPass(name, execute);
+			new (m_Passes[pass].Capture) F(func);
+			return pass;
+		}
+		int AddPass(const char* name, ExecuteFunc func);
+		void Read(int pass, FrameGraphResource res);
+		//writes are attached in call order to COLOR0, COLOR1, ...
+		void Write(int pass, FrameGraphResource res);
+		//pass writes outside of the graph (i.e. the output framebuffer) and is never culled
+		void SetSideEffect(int pass);
+
+		void Compile();
+		void Execute();
+
+		//only valid while a pass accessing the resource is executed
+		unsigned int GetTextureId(FrameGraphResource res);
+		RenderTexturePtr GetTexture(FrameGraphResource res);
+		glm::ivec2 GetSize(FrameGraphResource res);
+
+		//after Compile: true if any remaining pass reads the resource
+		bool IsUsed(FrameGraphResource res) const;
+		bool IsCulled(int pass) const { return m_Passes[pass].Culled; }
+
+		//binds a framebuffer with the writes of the executing pass attached and sets the viewport
+		void BindRenderTargets();
+
+	private:
+		struct Resource
+		{
+			const char* Name;
+			RenderTargetDesc Desc;
+			bool Imported;
+			unsigned int ImportedId;
+			int Producer;
+			int RefCount;
+			int FirstUse;
+			int LastUse;
+			RenderTexturePtr Texture;
+		};
+
+		struct Pass
+		{
+			const char* Name;
+			ExecuteFunc Func;
+			alignas(16) unsigned char Capture[PC_FRAMEGRAPH_PASS_CAPTURE];
+			FrameGraphResource Reads[PC_FRAMEGRAPH_MAX_READS];
+			int NumReads;
+			FrameGraphResource Writes[PC_MAX_RENDER_TARGETS];
+			int NumWrites;
+			bool SideEffect;
+			int RefCount;
+			bool Culled;
+		};
+
+		bool IsLive(const Resource& r) const { return r.Imported || r.RefCount > 0; }
+
+		RenderTargetPool *m_Pool;
+		GPUProfiler *m_Profiler;
+		std::vector<Resource> m_Resources;
+		std::vector<Pass> m_Passes;
+		std::vector<FrameGraphResource> m_CullStack;
+		int m_CurrentPass;
+	};
+}
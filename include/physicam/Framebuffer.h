@@ -18,6 +18,7 @@ namespace PhysiCam
 	public:
 		enum AttachmentType
 		{
+			NONE = 0,
 			COLOR0 = 0x8CE0,
 			COLOR1,
 			COLOR2,
@@ -51,6 +52,7 @@ namespace PhysiCam
 		void BindRead();
 		void Unbind();
 		unsigned int GetID() { return m_FBO; }
+		glm::ivec2 GetSize() { return m_Size; }
 
 		RenderTexturePtr GetAttachedTexture(AttachmentType at);
 
@@ -0,0 +1,141 @@
+/*
+	PhysiCam - Physically based camera
+	Copyright (C) 2015 Frank Khnke
+
+	This file is part of PhysiCam.
+
+	This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License 
+	as published by the Free Software Foundation; either 
+	version 3 of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ *	@file GLState.h
+ */
+
+#pragma once
+
+#include <physicam/physicam_def.h>
+
+#include <cstddef>
+#include <cstdint>
+
+//texture units whose 2D and 2D array bindings are tracked and restored, higher units are passed through
+#define PC_GL_STATE_TEXTURE_UNITS	8
+//indexed uniform buffer, shader storage buffer and image unit bindings that are tracked and restored
+#define PC_GL_STATE_UNIFORM_BUFFERS	16
+#define PC_GL_STATE_STORAGE_BUFFERS	4
+#define PC_GL_STATE_IMAGE_UNITS		4
+//generic buffer targets PhysiCam binds to: uniform, shader storage, pixel pack, copy read, copy write, dispatch indirect
+#define PC_GL_STATE_BUFFER_TARGETS	6
+
+namespace PhysiCam
+{
+	/*
+	* Shadow copy of the GL bindings PhysiCam touches while postprocessing. Between Save and Restore
+	* a bind that matches the cached value is dropped. Outside of that window every call goes to GL
+	* directly, because the host application may have changed the state in the meantime.
+	* Save only queries the program, the framebuffers, the viewport and the vertex array. Texture units, buffer
+	* bindings and image units are queried the first time PhysiCam binds them within the window, so only the ones
+	* it actually touches cost a glGet. Restore puts everything that was queried back.
+	* A host that sets all of its state before it draws can turn the restore off, then Save queries nothing.
+	*/
+	class GLState
+	{
+	public:
+		//queries the host state and starts filtering redundant changes
+		static void Save();
+		//rebinds the host state captured since Save and stops filtering
+		static void Restore();
+
+		//on by default. off: Save and Restore do not query or rebind anything, the host bindings are left as PhysiCam set them
+		static void SetRestoreEnabled(bool enabled) { s_RestoreEnabled = enabled; }
+		static bool RestoreEnabled() { return s_RestoreEnabled; }
+
+		static void UseProgram(unsigned int program);
+		//array textures go to the GL_TEXTURE_2D_ARRAY target of the unit, the 2D binding stays untouched
+		static void BindTexture(unsigned int unit, unsigned int texture, bool array = false);
+		static void BindFramebuffer(unsigned int target, unsigned int framebuffer);
+		static void Viewport(int x, int y, int width, int height);
+		static void BindVertexArray(unsigned int vertexArray);
+		static void BindBuffer(unsigned int target, unsigned int buffer);
+		//a size of 0 binds the whole buffer (glBindBufferBase), like GL also changes the generic binding of the target
+		static void BindBufferRange(unsigned int target, unsigned int index, unsigned int buffer, size_t offset = 0, size_t size = 0);
+		static void BindImageTexture(unsigned int unit, unsigned int texture, int level, bool layered, int layer, unsigned int access, unsigned int format);
+
+		//binds a texture to the active unit to change its state, returns the binding that has to be put back afterwards
+		static unsigned int BindTextureForUpdate(unsigned int texture, bool array = false);
+
+		//GL unbinds deleted objects and may hand out their names again
+		static void TextureDeleted(unsigned int texture);
+		static void FramebufferDeleted(unsigned int framebuffer);
+		static void BufferDeleted(unsigned int buffer);
+
+	private:
+		struct BufferRange
+		{
+			unsigned int Buffer;
+			size_t Offset;
+			size_t Size;
+		};
+
+		struct ImageBinding
+		{
+			unsigned int Texture;
+			int Level;
+			bool Layered;
+			int Layer;
+			unsigned int Access;
+			unsigned int Format;
+		};
+
+		struct State
+		{
+			unsigned int Program;
+			unsigned int ActiveUnit;
+			unsigned int Textures[PC_GL_STATE_TEXTURE_UNITS];
+			unsigned int TextureArrays[PC_GL_STATE_TEXTURE_UNITS];
+			unsigned int DrawFramebuffer;
+			unsigned int ReadFramebuffer;
+			int Viewport[4];
+			unsigned int VertexArray;
+			unsigned int Buffers[PC_GL_STATE_BUFFER_TARGETS];
+			BufferRange UniformBuffers[PC_GL_STATE_UNIFORM_BUFFERS];
+			BufferRange StorageBuffers[PC_GL_STATE_STORAGE_BUFFERS];
+			ImageBinding Images[PC_GL_STATE_IMAGE_UNITS];
+		};
+
+		//one bit per binding, set once the host value is in s_Saved and the cached value in s_Current is valid
+		struct Queried
+		{
+			uint32_t Textures;
+			uint32_t TextureArrays;
+			uint32_t Buffers;
+			uint32_t UniformBuffers;
+			uint32_t StorageBuffers;
+			uint32_t Images;
+		};
+
+		static void ActiveTexture(unsigned int unit);
+		static int BufferTargetIndex(unsigned int target);
+		static void QueryTexture(unsigned int unit, bool array);
+		static void QueryBuffer(int targetIndex);
+		static BufferRange* QueryIndexedBuffer(unsigned int target, unsigned int index);
+		static void QueryImage(unsigned int unit);
+
+		static State s_Current;
+		static State s_Saved;
+		static Queried s_Queried;
+		static bool s_Tracking;
+		static bool s_RestoreEnabled;
+	};
+}
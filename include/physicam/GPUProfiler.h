@@ -0,0 +1,123 @@
+/*
+	PhysiCam - Physically based camera
+	Copyright (C) 2015 Frank Khnke
+
+	This file is part of PhysiCam.
+
+	This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License 
+	as published by the Free Software Foundation; either 
+	version 3 of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ *	@file GPUProfiler.h
+ */
+
+#pragma once
+
+#include <physicam/physicam_def.h>
+
+#include <string>
+#include <vector>
+
+//frames a result may lag behind, the cpu never waits for a query
+#define PC_GPU_PROFILER_FRAMES			4
+//scopes per frame, further scopes are not timed
+#define PC_GPU_PROFILER_MAX_SCOPES		64
+//frames the rolling statistics cover
+#define PC_GPU_PROFILER_HISTORY			120
+
+namespace PhysiCam
+{
+	//gpu time of one scope in milliseconds over the last PC_GPU_PROFILER_HISTORY frames it ran in
+	struct PassTiming
+	{
+		//scopes repeated within a frame (e.g. the bloom levels) are numbered: "BloomBlurHorizontal #2"
+		std::string Name;
+		float Last;
+		float Average;
+		float Median;
+		float Percentile95;
+		float Max;
+		int Samples;
+	};
+
+	struct PassTimings
+	{
+		//in the order the scopes ran in the latest frame
+		std::vector<PassTiming> Passes;
+		//smoothed time from the first to the last scope of a frame
+		float FrameTime;
+	};
+
+	/*
+	* Times sequential scopes with a pair of GL_TIMESTAMP queries each. Every frame writes its own set
+	* of queries, which is read PC_GPU_PROFILER_FRAMES frames later if the gpu is done with it and dropped
+	* otherwise, so the profiler never stalls. Scopes do not nest, the names have to be string literals.
+	*/
+	class PHYSICAM_DLL GPUProfiler
+	{
+	public:
+		GPUProfiler();
+		~GPUProfiler();
+
+		void Init();
+		void Delete();
+
+		void Begin(const char* name);
+		void End();
+		//closes the frame and reads the results of the oldest frame in flight
+		void EndFrame();
+		//drops the frames in flight and the statistics, e.g. after the effect settings changed
+		void Reset();
+
+		PassTimings GetTimings() const;
+		float GetFrameTime() const { return m_FrameTime; }
+
+	private:
+		struct Scope
+		{
+			const char* Name;
+			int Occurrence;
+		};
+
+		struct FrameQueries
+		{
+			unsigned int Queries[PC_GPU_PROFILER_MAX_SCOPES * 2];
+			Scope Scopes[PC_GPU_PROFILER_MAX_SCOPES];
+			int ScopeCount;
+			bool Pending;
+		};
+
+		struct History
+		{
+			const char* Name;
+			int Occurrence;
+			float Samples[PC_GPU_PROFILER_HISTORY];
+			int Count;
+			int Next;
+			unsigned int LastFrame;
+			int Order;
+		};
+
+		void Resolve(FrameQueries& frame);
+		History& GetHistory(const Scope& scope);
+
+		bool m_Initialized;
+		FrameQueries m_Frames[PC_GPU_PROFILER_FRAMES];
+		unsigned int m_Frame;
+		bool m_ScopeOpen;
+		std::vector<History> m_History;
+		unsigned int m_ResolvedFrame;
+		float m_FrameTime;
+	};
+}
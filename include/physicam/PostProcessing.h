@@ -27,6 +27,12 @@
 #include <physicam/shader.h>
 #include <physicam/RenderTexture.h>
 #include <physicam/Framebuffer.h>
+#include <physicam/RenderTargetPool.h>
+#include <physicam/PostProcessingContext.h>
+#include <physicam/FrameGraph.h>
+#include <physicam/UniformRingBuffer.h>
+
+#include <vector>
 
 #define PC_MODEL_VERTEX_LOCATION 0
 #define PC_MODEL_NORMAL_LOCATION 1
@@ -34,9 +40,64 @@
 #define PC_MODEL_VERTEX_COLOR_LOCATION 3
 
 
-#define USE_INCREMENTAL_GAUSS_BLUR	1
 #define USE_LENSE_FLARE				1
 
+//number of frames the luminance readback may lag behind, the cpu never waits for the gpu
+#define PC_LUMINANCE_READBACK_FRAMES	3
+
+//gpu metering: log luminance histogram over a subsampled grid
+#define PC_METERING_HISTOGRAM_BINS		256
+#define PC_METERING_GRID_WIDTH			256
+#define PC_EXPOSURE_BLOCK_BINDING		0
+
+//largest bloom spread the compute blur can cache (apron of 64 texels), wider levels use the fragment blur
+#define PC_BLOOM_COMPUTE_MAX_RADIUS		128.0f
+#define PC_BLOOM_COMPUTE_TILE_SIZE		256
+
+//bilinear taps per bloom level of the linear sampled gaussian, enough for PC_BLOOM_COMPUTE_MAX_RADIUS
+#define PC_BLOOM_LINEAR_MAX_TAPS		33
+#define PC_BLOOM_KERNEL_BLOCK_BINDING	1
+
+//depth of the dual filter downsample chain, counted from the half resolution bright pass
+#define PC_BLOOM_DUAL_FILTER_LEVELS		10
+
+//tiled DoF: blur is classified per tile, only tiles with visible blur run the (half resolution) gather
+#define PC_DOF_TILE_SIZE				16
+
+//gpu autofocus: focus distance of the DoF, written by the autofocus pass
+#define PC_FOCUS_BLOCK_BINDING			2
+
+//per frame parameter blocks, pushed into the uniform ring buffer (see ShaderCode.cpp for the layouts)
+#define PC_EXPOSURE_SETTINGS_BLOCK_BINDING	3
+#define PC_TONEMAPPING_BLOCK_BINDING	4
+#define PC_LENS_BLOCK_BINDING			5
+#define PC_BLOOM_BLOCK_BINDING			6
+#define PC_DOF_BLOCK_BINDING			7
+#define PC_METERING_BLOCK_BINDING		8
+#define PC_AUTOFOCUS_BLOCK_BINDING		9
+#define PC_REPROJECTION_BLOCK_BINDING	10
+#define PC_TAA_BLOCK_BINDING			11
+#define PC_MOTION_BLUR_BLOCK_BINDING	12
+//blocks pushed per frame: every binding above once, the exposure settings a second time for the output blit
+#define PC_UNIFORM_BLOCKS_PER_FRAME		(PC_MOTION_BLUR_BLOCK_BINDING - PC_EXPOSURE_SETTINGS_BLOCK_BINDING + 2)
+//upper bound of their size
+#define PC_UNIFORM_BLOCK_MAX_SIZE		272
+
+//temporal anti-aliasing: length of the Halton sequence the projection is jittered with
+#define PC_TAA_JITTER_SAMPLES			8
+//samples on the first ring of the per pixel DoF while TAA accumulates the frames (18 instead of 36 taps)
+#define PC_TAA_DOF_RING_SAMPLES			3
+
+//motion blur: the velocity is clamped to the tile size, so the blur of a pixel never reaches past the neighbouring tiles
+#define PC_MOTION_BLUR_TILE_SIZE		16
+#define PC_MOTION_BLUR_SAMPLES			12
+
+//dynamic resolution: the scale changes in fixed steps, so the render target pool sees a few sizes only, and waits between changes
+#define PC_DYNAMIC_RESOLUTION_STEP		0.125f
+#define PC_DYNAMIC_RESOLUTION_INTERVAL	30
+//the scale only grows again while the gpu time is below this fraction of the budget
+#define PC_DYNAMIC_RESOLUTION_HEADROOM	0.8f
+
 namespace PhysiCam
 {
 	typedef struct
@@ -53,20 +114,133 @@ namespace PhysiCam
 		Uncharted2
 	};
 
+	/*
+	* Blur used for the bloom levels:
+	*	IncrementalGaussian:	spread/2 point samples per side and direction, runs as compute shader if enabled
+	*	LinearGaussian:			same kernel, two neighbouring taps merged into one bilinear fetch, weights and offsets
+	*							are computed on the cpu when a spread changes
+	*	DualKawase:				dual filter down/upsample chain, each step doubles the blur width so the cost per pixel
+	*							grows with log2(spread) instead of the spread. all levels share one upsample chain
+	*/
+	enum class BloomFilter : int
+	{
+		IncrementalGaussian = 0,
+		LinearGaussian,
+		DualKawase
+	};
+
+	enum class AutofocusMode : int
+	{
+		SinglePoint = 0,	//average depth of a few pixels at the center of the AF region
+		Zone,				//closest subject in the AF region
+		Rect				//average depth of the AF region, e.g. a face box supplied by the application
+	};
+
+	enum class MeteringMode : int
+	{
+		Matrix = 0,			//whole frame, slight center bias
+		CenterWeighted,		//gaussian falloff around the metering point
+		Spot,				//only a small circle around the metering point
+		HighlightProtect	//meters the brightest part of the frame and keeps it below clipping
+	};
+
+	/*
+	* Storage format of the postprocessing intermediates.
+	* Every target rounds its values once, so the relative error of a value reaching the output is at most
+	* (1+e)^n - 1 ~ n*e for n intermediates on its way (n <= 4 for the image, up to 13 for the bloom term):
+	*	Full32:			RGB32F color, R32F depth, e = 2^-24
+	*	Half16:			RGBA16F color, R16F depth, e = 2^-11 (0.05%), below one 8 bit output step even for the bloom term
+	*	Packed11_11_10:	R11F_G11F_B10F color, R16F depth, e = 2^-7 for red/green, 2^-6 (1.6%) for blue,
+	*					about one 8 bit output step in bright areas, no alpha and no negative values
+	* Both reduced formats clamp at 65000 and flush values below 6.1e-5 to zero, so targets holding the scene
+	* before exposure (unfused lense distortion, metering downsample) stay at 32 bit.
+	* The R16F depth copy is only used for DoF, whose blur is linear in 1/distance. The error in 1/distance is below
+	* 2^-11/nearClip, e.g. 0.005 diopters for a 0.1m near clip compared to 0.33 diopters for focusing at 3m.
+	*/
+	enum class PrecisionProfile : int
+	{
+		Full32 = 0,
+		Half16,
+		Packed11_11_10
+	};
+
 	class Camera;
 	class PHYSICAM_DLL PostProcessor
 	{
 		friend class Camera;
 	public:
-		PostProcessor(Camera *c);
+		//without a context the PostProcessor creates a private one
+		PostProcessor(Camera *c, PostProcessingContextPtr context = nullptr);
 		~PostProcessor();
 
 		
 		void Render(float exposure, PhysiCamFBOInputDesc inputFBODesc, unsigned int outputFramebufferId);
 
+		//the shaders are compiled in the background after construction, this polls without blocking.
+		//the Has* queries are only final once this returned true
+		bool IsReady();
+		//blocks until all shaders are linked, called by Render
+		void WaitUntilReady();
+
+		PostProcessingContextPtr GetContext() const { return m_Context; }
+
+		//lower left corner of the image in the output framebuffer, the image keeps the screen size of the camera.
+		//lets several cameras render split screen or picture in picture into the same framebuffer
+		glm::ivec2 OutputOffset() const { return m_OutputOffset; }
+		void SetOutputOffset(glm::ivec2 val) { m_OutputOffset = val; }
+
+		//0 for 2D inputs, otherwise the color and depth inputs are GL_TEXTURE_2D_ARRAY with this many layers (one per view,
+		//see Camera::SetViewCount) and the output framebuffer needs a layered attachment. Every pass runs once for all
+		//layers, metering and autofocus are shared: the exposure is metered over all layers, the focus on the first one
+		int LayerCount() const { return m_Layers; }
+		void SetLayerCount(int layers);
+
 		void UpdateScreenSize();
 
+		//starts metering the input texture and returns the latest finished result,
+		//which lags up to PC_LUMINANCE_READBACK_FRAMES frames behind
 		float GetAverageLuminance(unsigned int inputTexture);
+		//false until the first readback has finished, GetAverageLuminance returns no measured value before
+		bool HasAverageLuminance() const { return m_LuminanceResolved; }
+
+		//true if metering, eye adaption and program auto can run entirely on the gpu (compute shaders)
+		bool HasGPUMetering() const { return m_Shaders->m_ShaderLuminanceHistogram != nullptr; }
+
+		//histogram based metering on the gpu, the exposure used by Render stays in video memory
+		void MeterExposure(unsigned int inputTexture);
+
+		glm::vec2 MeteringLuminanceRange() const { return m_MeteringLuminanceRange; }
+		//min/max log2 luminance covered by the metering histogram
+		void SetMeteringLuminanceRange(glm::vec2 val) { m_MeteringLuminanceRange = val; }
+
+		//video memory currently held by the pooled intermediate render targets, shared with the other cameras of the context
+		size_t GetRenderTargetMemory() const { return m_Context->GetRenderTargetMemory(); }
+
+		PrecisionProfile GetPrecisionProfile() const { return m_PrecisionProfile; }
+		//intermediates with the old formats are released by the render target pool after a few frames
+		void SetPrecisionProfile(PrecisionProfile profile);
+
+		//runs point-wise effects (exposure, tonemapping, grain) at the end of the previous pass instead of in an own full screen pass
+		bool PassFusionEnabled() const { return m_PassFusionEnabled; }
+		void SetPassFusionEnabled(bool val) { m_PassFusionEnabled = val; }
+		//false if the generated shaders failed to compile, fusion is ignored then
+		bool HasPassFusion() const { return m_Shaders->m_HasPassFusion; }
+
+		/* Dynamic resolution */
+		//gpu time of Render in milliseconds. While it is exceeded the bloom chain, the lense flare and the tiled DoF gather
+		//render at a lower resolution, the composites stay at full resolution. <= 0 disables the scaling
+		float GPUTimeBudget() const { return m_GPUTimeBudget; }
+		void SetGPUTimeBudget(float val) { m_GPUTimeBudget = val; }
+		//limits of the scale, relative to the default resolution of these stages
+		void SetResolutionScaleRange(float minScale, float maxScale);
+		float ResolutionScale() const { return m_ResolutionScale; }
+		//smoothed gpu time of the postprocessing (metering and Render) in milliseconds, 0 without timer queries
+		float GPUTime() const { return m_Profiler.GetFrameTime(); }
+
+		//gpu time of every pass of the latest frames, read a few frames late without stalling. empty without timer queries
+		PassTimings GetPassTimings() const { return m_Profiler.GetTimings(); }
+		//starts the statistics over, the timings of the next few frames are still in flight
+		void ResetPassTimings() { m_Profiler.Reset(); }
 		
 		/*** postprocessing effects functions ***/
 
@@ -77,16 +251,29 @@ namespace PhysiCam
 		float BloomThreshold() const { return m_BloomThreshold; }
 		void SetBloomThreshold(float val) { m_BloomThreshold = val; }
 
-		void SetBloomSpead(int id, float val) { m_BloomSpreads[id] = val; }
+		float BloomSpread(int id) const { return m_BloomSpreads[id]; }
+		void SetBloomSpead(int id, float val) { m_BloomSpreads[id] = val; m_BloomKernelsDirty = true; }
+		float BloomIntensity() const { return m_BloomIntensity; }
 		void SetBloomIntensity(float val) { m_BloomIntensity = val; }
+		float BloomIntensity(int id) const { return m_BloomStrengths[id]; }
 		void SetBloomIntensity(int id, float val) { m_BloomStrengths[id] = val; }
 		
+		//true if the blur levels can run as compute shaders with a shared memory tap cache
+		bool HasComputeBloom() const { return GetBloomBlurComputeShader() != nullptr; }
+		//used by BloomFilter::IncrementalGaussian, it replaces the fragment passes where possible
+		bool ComputeBloomEnabled() const { return m_ComputeBloomEnabled; }
+		void SetComputeBloomEnabled(bool val) { m_ComputeBloomEnabled = val; }
+
+		BloomFilter GetBloomFilter() const { return m_BloomFilter; }
+		void SetBloomFilter(BloomFilter filter) { m_BloomFilter = filter; }
+
 		int DirtTextureId() const { return m_DirtTextureId; }
 		void SetDirtTextureId(int val) { m_DirtTextureId = val; }
 
 		/* Tonemapping */
 		bool TonemappingEnabled() const { return m_ToneMappingEnabled; }
 		void SetTonemappingEnabled(bool val) { m_ToneMappingEnabled = val; }
+		TonemappingMethod GetTonemappingMethod() const { return m_ToneMappingMethod; }
 		void SetTonemappingMethod(TonemappingMethod method) { m_ToneMappingMethod = method; }
 
 		/* DoF */
@@ -102,6 +289,20 @@ namespace PhysiCam
 		bool DoFAutofocus() const { return m_DoFAutofocus; }
 		//ignored when using autofocus
 		void SetDoFAutofocus(bool val) { m_DoFAutofocus = val; }
+
+		//true if the focus can be picked from a depth pyramid on the gpu, otherwise autofocus uses the screen center pixel
+		bool HasGPUAutofocus() const { return m_Shaders->m_ShaderDepthPyramid != nullptr && m_Shaders->m_ShaderAutofocus != nullptr; }
+
+		AutofocusMode DoFAutofocusMode() const { return m_DoFAutofocusMode; }
+		void SetDoFAutofocusMode(AutofocusMode mode) { m_DoFAutofocusMode = mode; }
+
+		//AF region in texture coordinates: x,y = lower left, z,w = upper right corner
+		glm::vec4 DoFAutofocusRegion() const { return m_DoFAutofocusRegion; }
+		void SetDoFAutofocusRegion(glm::vec4 val) { m_DoFAutofocusRegion = val; }
+
+		//speed of the focus pull in 1/s, the remaining focus error (in diopters) shrinks by e every 1/speed seconds. 0 = instant
+		float DoFFocusSpeed() const { return m_DoFFocusSpeed; }
+		void SetDoFFocusSpeed(float val) { m_DoFFocusSpeed = val; }
 		
 		bool DoFShowFocus() const { return m_DoFShowFocus; }
 		void SetDoFShowFocus(bool val) { m_DoFShowFocus = val; }
@@ -112,6 +313,12 @@ namespace PhysiCam
 		float DoFMaxBlur() const { return m_DoFMaxBlur; }
 		void SetDoFMaxBlur(float val) { m_DoFMaxBlur = val; }
 
+		//true if the tile classification and the indirect gather can run as compute shaders
+		bool HasTiledDoF() const { return m_Shaders->m_ShaderDoFTileClassify != nullptr && GetDoFGatherShader() != nullptr; }
+		bool DoFTiled() const { return m_DoFTiled; }
+		//the cost of the tiled DoF scales with the blurred area, the per pixel DoF is used without compute shaders
+		void SetDoFTiled(bool val) { m_DoFTiled = val; }
+
 		float LensDistortionAmount() const { return m_LensDistortionAmount; }
 		void SetLensDistortionAmount(float val) { m_LensDistortionAmount = val; }
 
@@ -120,58 +327,196 @@ namespace PhysiCam
 		float MinNoise() const { return m_MinNoise; }
 		void SetMinNoise(float val) { m_MinNoise = val; }
 
+		//the grain pattern depends on the seed plus the time since the seed was set,
+		//with a fixed seed and no animation every frame gets the same grain (e.g. for reference images)
+		float GrainSeed() const { return m_GrainSeed; }
+		void SetGrainSeed(float val) { m_GrainSeed = val; m_GrainTimer = 0.0f; }
+		bool GrainAnimated() const { return m_GrainAnimated; }
+		void SetGrainAnimated(bool val) { m_GrainAnimated = val; }
+
+		/* Temporal anti-aliasing */
+		//false if the TAA shader failed to compile, the setting is ignored then
+		bool HasTAA() const { return m_Shaders->m_ShaderTAA != nullptr; }
+		bool TAAEnabled() const { return m_TAAEnabled; }
+		//Camera::Update jitters the projection while enabled, so the scene has to be rendered with the matrices of the camera.
+		//The DoF then takes fewer samples and changes its noise every frame, the history averages it out
+		void SetTAAEnabled(bool val) { m_TAAEnabled = val; }
+		float TAAFeedback() const { return m_TAAFeedback; }
+		//weight of the history, higher values are smoother but smear more under motion
+		void SetTAAFeedback(float val) { m_TAAFeedback = glm::clamp(val, 0.0f, 0.98f); }
+		//drops the history on the next frame, i.e. after a camera cut
+		void ResetTAAHistory() { m_TAAHistoryValid = false; }
+
+		/* Motion blur */
+		//false if the motion blur shaders failed to compile, the setting is ignored then
+		bool HasMotionBlur() const;
+		bool MotionBlurEnabled() const { return m_MotionBlurEnabled; }
+		//blurs the motion during the exposure, the length follows the shutter speed of the camera relative to the frame time.
+		//Tiles without motion skip the gather, a static camera costs the velocity and tile passes only
+		void SetMotionBlurEnabled(bool val) { m_MotionBlurEnabled = val; }
+
+		unsigned int MotionVectors() const { return m_MotionVectors; }
+		//RG texture with the screen space motion of the scene since the last frame (current minus previous texture coordinate),
+		//same layout as the color input, used by TAA and motion blur. 0 derives the motion of a static scene from the depth
+		//and the camera matrices
+		void SetMotionVectors(unsigned int textureId) { m_MotionVectors = textureId; }
+
 	private:
-		void RenderFullscreenQuad();
+		void RenderFullscreenQuad() { m_Context->RenderFullscreenQuad(m_Layers); }
+		//binds a graph texture, arrays for layered frames
+		void BindTextureId(unsigned int slot, unsigned int textureId);
+		//write only image of a compute pass, all layers of arrays
+		void BindImageTexture(unsigned int textureId, int level, RenderTexture::Format format);
+		//intermediate target with one layer per view
+		RenderTargetDesc GetTargetDesc(glm::ivec2 size, RenderTexture::Format format) const { return RenderTargetDesc(size, format, 1, m_Layers); }
 
-		void InitFBOs();
 		void DeleteFBOs();
 
-		void InitQuadMesh();
-
-		void InitShaders();
-		void DeleteShaders();
+		//the variants for the current precision profile
+		const ShaderPtr& GetBloomBlurComputeShader() const { return m_Shaders->m_ShaderBloomBlurCompute[static_cast<int>(m_PrecisionProfile)]; }
+		const ShaderPtr& GetDoFGatherShader() const { return m_Shaders->m_ShaderDoFGather[static_cast<int>(m_PrecisionProfile)]; }
 
 		void InitRenderTextures();
 		void DeleteRenderTextures();
 
-		void ApplyLuminance(float exposure, unsigned int inputTexture);
-		void ApplyLenseDistortion(unsigned int colTex, unsigned int depthTex);
-		void ApplyBloom(RenderTexturePtr tex, unsigned int outputFBO);
-		void ApplyToneMapping(RenderTexturePtr tex, unsigned int outputFBO);
-		void ApplyDoF(RenderTexturePtr tex, unsigned int depthTextureId, unsigned int outputFBO);
+		void InitLuminanceReadback();
+		void DeleteLuminanceReadback();
+		void ResolveLuminanceReadback();
+
+		void InitMeteringBuffers();
+		void DeleteMeteringBuffers();
+
+		//weights and offsets of the linear sampled gaussian, uploaded again only after a spread changed
+		void InitBloomKernels();
+		void DeleteBloomKernels();
+		void UpdateBloomKernels();
+
+		//list of blurred tiles behind the indirect dispatch arguments, grows with the tile count
+		void InitDoFTileList();
+		void DeleteDoFTileList();
+		void ReserveDoFTileList(int tileCount);
+
+		void InitAutofocus();
+		void DeleteAutofocus();
+
+		//adapts m_ResolutionScale to the gpu time budget, called before the frame graph is built
+		void UpdateResolutionScale();
+		//size of a stage running at factor times the screen size, scaled by m_ResolutionScale
+		glm::ivec2 GetScaledSize(float factor) const;
+
+		//declares the bloom and lense flare passes in the frame graph, returns the composed image
+		//or -1 if the composition is the final pass and renders to the output framebuffer
+		FrameGraphResource AddBloomPasses(FrameGraphResource input, unsigned int fusedStages, bool toOutput);
+		//gaussian blur per level, each level blurs the result of the previous one. returns the composed levels
+		FrameGraphResource AddGaussianBloomPasses(FrameGraphResource bright);
+		//downsample chain from the bright pass and one upsample chain back, which adds every level at the depth its
+		//spread requires. returns the end of the chain, which is already composed
+		FrameGraphResource AddDualKawaseBloomPasses(FrameGraphResource bright);
+		//depth pyramid and autofocus, the focus distance stays in m_FocusBuffer
+		void AddAutofocusPasses(FrameGraphResource depth);
+		//circle of confusion, tile classification, half resolution gather of the blurred tiles and composite
+		FrameGraphResource AddTiledDoFPasses(FrameGraphResource input, FrameGraphResource depth, unsigned int fusedStages, bool toOutput);
+		//blends the input with the history of the last frame into the other history target, which is returned
+		FrameGraphResource AddTAAPass(FrameGraphResource input, FrameGraphResource depth);
+		//the history targets are held from frame to frame, they go back to the pool on resize or when TAA is disabled
+		void DeleteTAAHistory();
+		//velocity, its maximum per tile and per neighbourhood, and the gather where the neighbourhood moves
+		FrameGraphResource AddMotionBlurPasses(FrameGraphResource input, FrameGraphResource depth);
+
+		//formats of the exposed color intermediates, compute blur images and the DoF depth copy for the current profile
+		RenderTexture::Format GetColorFormat() const;
+		RenderTexture::Format GetImageFormat() const;
+		RenderTexture::Format GetDepthFormat() const;
+		RenderTexture::Format GetCoCFormat() const;
+		RenderTexture::Format GetDoFGatherFormat() const;
+
+		//binds the graph targets of the executing pass or the output framebuffer for the final pass
+		void BindPassOutput(FrameGraph &fg, bool toOutput);
+
+		//writes the effect parameters of this frame into the ring and binds them
+		void UpdateUniformBlocks();
+		template<typename T> void PushUniformBlock(unsigned int binding, const T& block)
+		{
+			size_t offset = m_UniformRing.Push(block);
+			if (offset != PC_UNIFORM_RING_FULL)
+				m_UniformRing.BindRange(binding, offset, sizeof(T));
+		}
+
+		//effect passes render to the currently bound framebuffer unless an output is given
+		void ApplyLuminance(unsigned int inputTexture);
+		void ApplyLenseDistortion(unsigned int colTex, unsigned int depthTex, unsigned int fusedStages = 0);
+		void ApplyBrightPass(unsigned int inputTexture);
+		void ApplyBloomBlur(unsigned int inputTexture, glm::ivec2 size, int level, bool horizontal);
+		void ApplyBloomBlurCompute(unsigned int inputTexture, unsigned int outputTexture, glm::ivec2 size, int level, bool horizontal);
+		void ApplyDualKawaseDown(unsigned int inputTexture, glm::ivec2 size);
+		void ApplyDualKawaseUp(unsigned int levelTexture, float levelWeight, unsigned int chainTexture, glm::ivec2 size, float offset);
+		void ApplyLenseBloomCompose(unsigned int bloomTex, unsigned int flareTex, unsigned int baseTex, unsigned int fusedStages = 0);
+		void ApplyToneMapping(unsigned int inputTexture, unsigned int outputFBO);
+		void ApplyDoF(unsigned int inputTexture, unsigned int depthTextureId, unsigned int fusedStages = 0);
+		void ApplyDoFCoC(unsigned int depthTextureId);
+		void ApplyDepthPyramid(unsigned int depthTextureId, unsigned int pyramidTexture, glm::ivec2 size, int levels);
+		void ApplyAutofocus(unsigned int pyramidTexture, int levels);
+		void ApplyDoFTileClassify(unsigned int cocTexture, unsigned int tileTexture, glm::ivec2 tileCount);
+		void ApplyDoFGather(unsigned int inputTexture, unsigned int cocTexture, unsigned int gatherTexture);
+		void ApplyDoFComposite(unsigned int inputTexture, unsigned int cocTexture, unsigned int tileTexture, unsigned int gatherTexture, unsigned int fusedStages = 0, bool toOutput = false);
+		void ApplyTAA(unsigned int inputTexture, unsigned int depthTexture, unsigned int historyTexture);
+		void ApplyMotionBlurVelocity(unsigned int depthTexture);
+		void ApplyMotionBlurTileMax(unsigned int velocityTexture);
+		void ApplyMotionBlurNeighborMax(unsigned int tileMaxTexture);
+		void ApplyMotionBlurGather(unsigned int inputTexture, unsigned int depthTexture, unsigned int velocityTexture, unsigned int neighborMaxTexture);
 
 		void RenderFlares();
 
 
 		Camera *m_Camera;
 
-		//Shader objects
-		ShaderPtr m_ShaderBlitScreen;
-		ShaderPtr m_ShaderDownsample;
-		ShaderPtr m_ShaderLensDistortion;
-		ShaderPtr m_ShaderBrightPass;
-		ShaderPtr m_ShaderIncrementalGaussBlur;
-		ShaderPtr m_ShaderHorizontalBlur;
-		ShaderPtr m_ShaderVerticalBlur;
-		ShaderPtr m_ShaderBloomCompose;
-		ShaderPtr m_ShaderLenseBloomCompose;
-		ShaderPtr m_ShaderLenseFlare;
-		ShaderPtr m_DoFShader;
-		ShaderPtr m_ShaderToneMapping;
-
-		//buffers for fullscreen quad mesh
-		unsigned int m_QuadVBO;
-		unsigned int m_IndexBuffer, m_VertexBuffer, m_NormalBuffer, m_TexCoordBuffer;
-
-		//FBOs
+		//shaders, fullscreen quad and render target pool, possibly shared with other cameras
+		PostProcessingContextPtr m_Context;
+		//m_Context or its layered shaders, only the shaders of it are used
+		PostProcessingContext *m_Shaders;
+		int m_Layers;
+		bool m_PassFusionEnabled;
+		PrecisionProfile m_PrecisionProfile;
+		//the context was ready and the per camera targets and buffers exist
+		bool m_Initialized;
+		glm::ivec2 m_OutputOffset;
+
+		UniformRingBuffer m_UniformRing;
+
+		//mipmap metering fallback
 		FramebufferPtr m_DownSampleFBO;
-		FramebufferPtr m_LenseDistortionFBO;
-		FramebufferPtr m_LenseFlareFBO;
-		FramebufferPtr m_BloomhorFBOs[5];
-		FramebufferPtr m_BloomvertFBOs[5];
-		FramebufferPtr m_BloomOutputFBO;
-		FramebufferPtr m_BrightnessPassFBO;
-		FramebufferPtr m_SceneFBOs[2];
+		RenderTexturePtr m_DownSampleTexture;
+
+		//intermediate targets are declared per frame and aliased by the frame graph, they come from the pool of the context
+		FrameGraph m_FrameGraph;
+
+		GPUProfiler m_Profiler;
+		float m_GPUTimeBudget;
+		float m_ResolutionScale;
+		float m_MinResolutionScale;
+		float m_MaxResolutionScale;
+		int m_ResolutionCooldown;
+
+		//state of the frame being rendered, read by the passes
+		float m_Exposure;
+		unsigned int m_OutputFramebufferId;
+		float m_GrainTimer;
+		float m_GrainSeed;
+		bool m_GrainAnimated;
+
+		//auto exposure readback ring (pixel pack buffers + fences)
+		unsigned int m_LuminancePBOs[PC_LUMINANCE_READBACK_FRAMES];
+		void* m_LuminanceFences[PC_LUMINANCE_READBACK_FRAMES];
+		bool m_ReadbackHoldsExposure[PC_LUMINANCE_READBACK_FRAMES];
+		unsigned int m_LuminanceFrame;
+		float m_AverageLuminance;
+		bool m_LuminanceResolved;
+
+		//gpu metering buffers
+		unsigned int m_HistogramBuffer;
+		unsigned int m_ExposureBuffer;
+		bool m_ExposureOnGPU;
+		glm::vec2 m_MeteringLuminanceRange;
 
 		/*** postprocessing effects parameters ***/
 		
@@ -185,6 +530,10 @@ namespace PhysiCam
 		float m_BloomStrengths[5];
 		float m_BloomIntensity;
 		int m_DirtTextureId;
+		bool m_ComputeBloomEnabled;
+		BloomFilter m_BloomFilter;
+		unsigned int m_BloomKernelBuffer;
+		bool m_BloomKernelsDirty;
 
 		//Depth of field
 		bool m_DoFEnabled;
@@ -193,12 +542,38 @@ namespace PhysiCam
 		//focal distance value in meters
 		float m_DoFFocalDistance;
 		bool m_DoFShowFocus;
+		bool m_DoFTiled;
+		unsigned int m_DoFTileBuffer;
+		int m_DoFTileCapacity;
+		AutofocusMode m_DoFAutofocusMode;
+		glm::vec4 m_DoFAutofocusRegion;
+		float m_DoFFocusSpeed;
+		unsigned int m_FocusBuffer;
+		//set by Render when the DoF passes read the focus distance from m_FocusBuffer
+		bool m_FocusOnGPU;
 		bool m_DoFVignetting;
 		bool m_DoFAutofocus;
 
 		float m_MaxNoise;
 		float m_MinNoise;
 
+		//temporal anti-aliasing
+		bool m_TAAEnabled;
+		float m_TAAFeedback;
+		RenderTexturePtr m_TAAHistory[2];
+		RenderTargetDesc m_TAAHistoryDesc;
+		//counts the accumulated frames, selects the history target written this frame
+		unsigned int m_TAAFrame;
+		bool m_TAAHistoryValid;
+		//set by Render when the TAA pass runs this frame
+		bool m_TAAActive;
+
+		//motion blur
+		bool m_MotionBlurEnabled;
+		bool m_MotionBlurActive;
+		//application velocity buffer of TAA and motion blur
+		unsigned int m_MotionVectors;
+
 		//Tonemapping
 		bool m_ToneMappingEnabled;
 		TonemappingMethod m_ToneMappingMethod;
@@ -0,0 +1,187 @@
+/*
+	PhysiCam - Physically based camera
+	Copyright (C) 2015 Frank Khnke
+
+	This file is part of PhysiCam.
+
+	This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License 
+	as published by the Free Software Foundation; either 
+	version 3 of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ *	@file PostProcessingContext.h
+ */
+
+#pragma once
+
+#include <physicam/physicam_def.h>
+#include <physicam/shader.h>
+#include <physicam/RenderTargetPool.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+//number of PrecisionProfile values, the compute shaders writing images exist once per profile
+#define PC_PRECISION_PROFILE_COUNT		3
+
+namespace PhysiCam
+{
+	enum class PrecisionProfile : int;
+	class PostProcessor;
+
+	//passes the point-wise stages can be appended to
+	enum FusedPass
+	{
+		FusedLensDistortion = 0,
+		FusedLenseBloomCompose,
+		FusedDoF,
+		FusedDoFComposite,
+		FusedPassCount
+	};
+
+	enum FusedStage
+	{
+		FusedExposure = 1,
+		FusedToneMapping = 2,
+		FusedStageCombinations = 4
+	};
+
+	class PostProcessingContext;
+	typedef std::shared_ptr<PostProcessingContext> PostProcessingContextPtr;
+
+	/*
+	* GL resources every PostProcessor needs and none of them changes: the shader programs, the fullscreen quad
+	* and the render target pool. Cameras created with the same context share them, so a split screen or a wall
+	* of monitors compiles the shaders once and the cameras reuse each others intermediate targets.
+	* Everything that carries state from frame to frame (exposure, focus, readbacks, timings) stays per PostProcessor.
+	* Cameras with several views (stereo) use a second set of the shaders, compiled for array textures.
+	*/
+	class PHYSICAM_DLL PostProcessingContext
+	{
+		friend class PostProcessor;
+	public:
+		~PostProcessingContext();
+
+		//needs a current GL context, the shaders are submitted for background compilation right away
+		static PostProcessingContextPtr Create();
+
+		//polls without blocking, see PostProcessor::IsReady
+		bool IsReady();
+		void WaitUntilReady();
+
+		RenderTargetPool& GetRenderTargetPool() { return m_RenderTargetPool; }
+		//video memory held by the pooled intermediate targets of all cameras
+		size_t GetRenderTargetMemory() const { return m_RenderTargetPool.GetAllocatedBytes(); }
+
+	private:
+		PostProcessingContext(bool layered = false);
+
+		void InitQuadMesh();
+		void DeleteQuadMesh();
+		//drawn once per layer if layers > 0, the layered shaders send every instance to its own layer
+		void RenderFullscreenQuad(int layers = 0);
+
+		//the shaders compiled for 2D array inputs, created on first use. Only the shaders of the returned
+		//context are used, the quad mesh and the render target pool are the ones of this context
+		PostProcessingContext* GetLayeredContext();
+
+		void InitShaders();
+		//submit a fullscreen pass or a compute shader in the variant of this context
+		ShaderPtr CreateShader(const std::string& fs, bool deferred);
+		ShaderPtr CreateComputeShader(const std::string& cs, bool deferred);
+		void InitFusedShaders();
+		void FinishFusedShaders();
+		//the compute blur and the DoF gather store into images of the profile's format, they are created on first use
+		void InitPrecisionShaders(PrecisionProfile profile);
+		//sampler units, uniform block bindings and the locations of per pass uniforms, set once after linking
+		void InitShaderConstants();
+		static std::string GenerateFusedShader(const std::string& passSrc, unsigned int stages);
+
+		//called by every PostProcessor after its frame. Once a camera renders again all of them had their turn,
+		//so the pool ages its targets once per application frame no matter how many cameras share it
+		void EndFrame(const PostProcessor* pp);
+		void RemovePostProcessor(const PostProcessor* pp);
+
+		//Shader objects
+		ShaderPtr m_ShaderBlitScreen;
+		ShaderPtr m_ShaderDownsample;
+		ShaderPtr m_ShaderLensDistortion;
+		ShaderPtr m_ShaderBrightPass;
+		ShaderPtr m_ShaderIncrementalGaussBlur;
+		ShaderPtr m_ShaderLinearGaussBlur;
+		ShaderPtr m_ShaderDualKawaseDown;
+		ShaderPtr m_ShaderDualKawaseUp;
+		ShaderPtr m_ShaderBloomCompose;
+		ShaderPtr m_ShaderLenseBloomCompose;
+		ShaderPtr m_ShaderLenseFlare;
+		ShaderPtr m_DoFShader;
+		ShaderPtr m_ShaderDoFCoC;
+		ShaderPtr m_ShaderDoFTileClassify;
+		ShaderPtr m_ShaderDoFComposite;
+		ShaderPtr m_ShaderDepthPyramid;
+		ShaderPtr m_ShaderAutofocus;
+		ShaderPtr m_ShaderToneMapping;
+		ShaderPtr m_ShaderLuminanceHistogram;
+		ShaderPtr m_ShaderLuminanceAverage;
+		ShaderPtr m_ShaderTAA;
+		ShaderPtr m_ShaderMotionBlurVelocity;
+		ShaderPtr m_ShaderMotionBlurTileMax;
+		ShaderPtr m_ShaderMotionBlurNeighborMax;
+		ShaderPtr m_ShaderMotionBlurGather;
+		//indexed by PrecisionProfile
+		ShaderPtr m_ShaderBloomBlurCompute[PC_PRECISION_PROFILE_COUNT];
+		ShaderPtr m_ShaderDoFGather[PC_PRECISION_PROFILE_COUNT];
+		bool m_PrecisionShadersCreated[PC_PRECISION_PROFILE_COUNT];
+
+		//[pass][stages], index 0 holds the unfused shader of the pass
+		ShaderPtr m_FusedShaders[FusedPassCount][FusedStageCombinations];
+		bool m_HasPassFusion;
+
+		//submitted but not yet checked shaders, failed ones are reset by WaitUntilReady
+		std::vector<ShaderPtr*> m_PendingShaders;
+		bool m_ShadersReady;
+
+		//locations of the uniforms which change from pass to pass, everything else is in uniform blocks
+		struct BlurUniforms
+		{
+			int Radius;
+			int Level;
+			int Resolution;
+			int Direction;
+		};
+		BlurUniforms m_IncrementalBlurUniforms;
+		BlurUniforms m_LinearBlurUniforms;
+		BlurUniforms m_ComputeBlurUniforms[PC_PRECISION_PROFILE_COUNT];
+		struct DualKawaseUniforms
+		{
+			int HalfPixel[2]; //down, up
+			int LevelWeight;
+			int HasChain;
+		};
+		DualKawaseUniforms m_DualKawaseUniforms;
+		int m_DepthPyramidSourceLevel;
+
+		//buffers for fullscreen quad mesh
+		unsigned int m_QuadVBO;
+		unsigned int m_IndexBuffer, m_VertexBuffer;
+
+		RenderTargetPool m_RenderTargetPool;
+		//cameras which rendered since the pool ended its last frame
+		std::vector<const PostProcessor*> m_RenderedPostProcessors;
+
+		//the shaders sample and write one layer of array textures, see LayerBlockSrc in ShaderCode.cpp
+		bool m_Layered;
+		PostProcessingContextPtr m_LayeredContext;
+	};
+}
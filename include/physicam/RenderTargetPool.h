@@ -0,0 +1,122 @@
+/*
+	PhysiCam - Physically based camera
+	Copyright (C) 2015 Frank Khnke
+
+	This file is part of PhysiCam.
+
+	This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License 
+	as published by the Free Software Foundation; either 
+	version 3 of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ *	@file RenderTargetPool.h
+ */
+
+#pragma once
+
+#include <physicam/physicam_def.h>
+#include <physicam/RenderTexture.h>
+#include <physicam/Framebuffer.h>
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+//maximum number of color targets a pass can render to at once
+#define PC_MAX_RENDER_TARGETS			4
+
+//frames a free render target is kept alive before it gets deleted
+#define PC_RENDER_TARGET_POOL_LIFETIME	60
+
+//bytes of free render targets kept for reuse, beyond that the least recently used ones are deleted at the end of the frame
+#define PC_RENDER_TARGET_POOL_FREE_BUDGET	(256 * 1024 * 1024)
+
+namespace PhysiCam
+{
+	struct RenderTargetDesc
+	{
+		glm::ivec2 Size;
+		RenderTexture::Format Format;
+		int MipLevels;
+		//0 for a 2D texture, otherwise the layer count of a 2D array texture
+		int Layers;
+
+		RenderTargetDesc() : Size(0), Format(RenderTexture::RGB32F), MipLevels(1), Layers(0) {}
+		RenderTargetDesc(glm::ivec2 size, RenderTexture::Format format, int mipLevels = 1, int layers = 0) : Size(size), Format(format),
+			MipLevels(mipLevels), Layers(layers) {}
+
+		bool operator==(const RenderTargetDesc& o) const { return Size == o.Size && Format == o.Format && MipLevels == o.MipLevels && Layers == o.Layers; }
+		bool operator!=(const RenderTargetDesc& o) const { return !(*this == o); }
+	};
+
+	/*
+	* Keeps render textures and the framebuffers they are attached to alive across frames.
+	* Released textures can be handed out again to any request with the same description,
+	* which is how the frame graph aliases textures with non-overlapping lifetimes.
+	* Textures are bucketed by (format, width, height, mips, layers). After a resize, the targets whose size
+	* did not change (e.g. the small bloom levels) are found again, and the old sizes expire lazily.
+	*/
+	class PHYSICAM_DLL RenderTargetPool
+	{
+	public:
+		RenderTargetPool();
+		~RenderTargetPool();
+
+		RenderTexturePtr Acquire(const RenderTargetDesc& desc);
+		void Release(const RenderTexturePtr& texture);
+
+		//returns a cached framebuffer with the given textures attached to COLOR0..count-1 (null entries stay unattached)
+		FramebufferPtr GetFramebuffer(const RenderTexturePtr* targets, int count);
+
+		//deletes targets which were not used for PC_RENDER_TARGET_POOL_LIFETIME frames or exceed the free budget
+		void EndFrame();
+		void Clear();
+
+		void SetFreeBudget(size_t bytes) { m_FreeBudget = bytes; }
+		size_t GetFreeBudget() const { return m_FreeBudget; }
+
+		//estimated video memory used by all pooled textures
+		size_t GetAllocatedBytes() const;
+		int GetTextureCount() const { return (int)m_TextureBuckets.size(); }
+
+		static size_t GetBytesPerPixel(RenderTexture::Format format);
+		static size_t GetBytes(const RenderTargetDesc& desc);
+
+	private:
+		struct Entry
+		{
+			RenderTargetDesc Desc;
+			RenderTexturePtr Texture;
+			bool InUse;
+			unsigned int LastUsedFrame;
+		};
+
+		struct FramebufferEntry
+		{
+			unsigned int TextureIds[PC_MAX_RENDER_TARGETS];
+			FramebufferPtr Framebuffer;
+		};
+
+		//exact key, the size takes 16 bits per axis, the mip count 8, the format enum 16 and the layer count the top 8
+		static uint64_t GetBucketKey(const RenderTargetDesc& desc);
+
+		void DeleteEntry(std::vector<Entry>& bucket, size_t index);
+		void DeleteFramebuffersUsing(unsigned int textureId);
+
+		std::unordered_map<uint64_t, std::vector<Entry>> m_Buckets;
+		std::unordered_map<unsigned int, uint64_t> m_TextureBuckets;
+		std::vector<FramebufferEntry> m_Framebuffers;
+		unsigned int m_Frame;
+		size_t m_FreeBudget;
+	};
+}
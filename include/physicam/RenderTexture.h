@@ -26,6 +26,7 @@
 
 #include <physicam/physicam_math.h>
 #include <memory>
+#include <unordered_map>
 
 namespace PhysiCam
 {
@@ -89,6 +90,7 @@ namespace PhysiCam
 			RGB32F = 0x8815,
 			RGBA16F = 0x881A,
 			RGBA32F = 0x8814,
+			R11F_G11F_B10F = 0x8C3A,
 			R8_SNORM = 0x8F94,
 			RG8_SNORM = 0x8F95,
 			RGB8_SNORM = 0x8F96,
@@ -111,9 +113,12 @@ namespace PhysiCam
 			TEXTURE_1D = 0x0DE0,
 			TEXTURE_2D = 0x0DE1,
 			TEXTURE_3D = 0x0DE2,
+			TEXTURE_2D_ARRAY = 0x8C1A,
 		};
 
 		static RenderTexturePtr Create(int width, int height, RenderTexture::Type type, RenderTexture::Format textureFormat, bool compressed = false, bool genMipMaps = false);
+		//GL_TEXTURE_2D_ARRAY with one layer per view, framebuffers attach all layers (layered rendering)
+		static RenderTexturePtr CreateArray(int width, int height, int layers, RenderTexture::Format textureFormat, bool genMipMaps = false);
 		~RenderTexture();
 
 		void SetParameteri(unsigned int pName, int param);
@@ -125,26 +130,48 @@ namespace PhysiCam
 
 		static void GetInternalFormat(unsigned int textureType, unsigned int targetFormat, int* internalFormat, int *type);
 
+		//resolves the transfer format and type of every sized format once, called by Camera::Init
+		static void InitFormatTable();
+
 		void SetLinearTextureFilter(bool state, float anisotropy = 0.0f);
 
 		unsigned int GetTextureId() { return m_TextureId; }
 		RenderTexture::Type GetType() { return (RenderTexture::Type)m_Type; }
 
 		glm::ivec2 GetSize() { return m_Size; }
+		//0 for 2D textures
+		int GetLayers() { return m_Layers; }
+		bool IsArray() { return m_Layers > 0; }
 
 		bool AttachToFramebuffer(unsigned int FramebufferId, unsigned int attachementPoint);
 
 		void GenerateMipMaps();
 
+		//index of the smallest (1x1) mipmap level for the current texture size
+		int GetMaxMipLevel();
+
 	protected:
 
 		RenderTexture();
 
 		void GenerateTexture(RenderTexture::Format textureFormat, bool genMipMaps);
 		static int GetInternalFormatLegacy(unsigned int targetFormat);
+		//the format glTexStorage2D accepts, 0 for unsized and generic compressed formats
+		static unsigned int GetSizedFormat(unsigned int targetFormat);
+		static void LookupFormat(unsigned int targetFormat, int* internalFormat, int *type);
+
+		struct FormatInfo
+		{
+			int InternalFormat;
+			int Type;
+		};
+		static std::unordered_map<unsigned int, FormatInfo> s_FormatTable;
 		
 		unsigned int m_TextureId;
 		glm::ivec2 m_Size;
+		int m_Layers;
+		//GL_TEXTURE_2D or GL_TEXTURE_2D_ARRAY
+		unsigned int m_Target;
 		RenderTexture::Format m_Format;
 		unsigned int m_InternalFormat;
 		int m_Type;
@@ -35,16 +35,35 @@
 namespace PhysiCam
 {
 	extern const std::string ScreenAlignedVertSrc;
+	extern const std::string LayeredVertSrc;
+	extern const std::string LayeredGeomSrc;
+	extern const std::string ExposureStageSrc;
 	extern const std::string BlitScreenSrc;
 	extern const std::string LensDistortionSrc;
 	extern const std::string DownsampleScreenSrc;
+	extern const std::string LuminanceHistogramSrc;
+	extern const std::string LuminanceAverageSrc;
 	extern const std::string BrightPassSrc;
 	extern const std::string IncrGaussBlurSrc;
-	extern const std::string BlurHorizontalSrc;
-	extern const std::string BlurVerticalSrc;
+	extern const std::string BloomBlurComputeSrc;
+	extern const std::string LinearGaussBlurSrc;
+	extern const std::string DualKawaseDownSrc;
+	extern const std::string DualKawaseUpSrc;
 	extern const std::string BloomComposeSrc;
 	extern const std::string LenseFlareSrc;
 	extern const std::string BloomLenseComposeSrc;
+	extern const std::string ToneMappingStageSrc;
 	extern const std::string ToneMapperSrc;
 	extern const std::string DoFSrc;
+	extern const std::string DepthPyramidSrc;
+	extern const std::string DoFAutofocusSrc;
+	extern const std::string DoFCoCSrc;
+	extern const std::string DoFTileClassifySrc;
+	extern const std::string DoFGatherComputeSrc;
+	extern const std::string DoFCompositeSrc;
+	extern const std::string TAASrc;
+	extern const std::string MotionBlurVelocitySrc;
+	extern const std::string MotionBlurTileMaxSrc;
+	extern const std::string MotionBlurNeighborMaxSrc;
+	extern const std::string MotionBlurGatherSrc;
 }
\ No newline at end of file
@@ -0,0 +1,73 @@
+/*
+	PhysiCam - Physically based camera
+	Copyright (C) 2015 Frank Khnke
+
+	This file is part of PhysiCam.
+
+	This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License 
+	as published by the Free Software Foundation; either 
+	version 3 of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ *	@file ThreadPool.h
+ */
+
+#pragma once
+
+#include <physicam/physicam_def.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace PhysiCam
+{
+	/*
+	* Fixed set of worker threads for data parallel loops. The workers sleep between loops,
+	* the thread calling ParallelFor works on the loop as well and returns once all ranges ran.
+	* ParallelFor must not be called from inside a loop body or from two threads at once.
+	*/
+	class PHYSICAM_DLL ThreadPool
+	{
+	public:
+		//0 = one thread per hardware thread, the calling thread counts as one of them
+		ThreadPool(unsigned int threadCount = 0);
+		~ThreadPool();
+
+		unsigned int GetThreadCount() const { return (unsigned int)m_Workers.size() + 1; }
+
+		//calls func(begin, end) for consecutive ranges of at most grainSize items covering [0, count)
+		void ParallelFor(int count, int grainSize, const std::function<void(int, int)>& func);
+
+	private:
+		void WorkerLoop();
+		void RunRanges();
+
+		std::vector<std::thread> m_Workers;
+		std::mutex m_Mutex;
+		std::condition_variable m_WakeCondition;
+		std::condition_variable m_DoneCondition;
+		bool m_Stop;
+		unsigned int m_Generation;
+		unsigned int m_Working;
+
+		//the loop being run
+		const std::function<void(int, int)>* m_Func;
+		int m_Count;
+		int m_GrainSize;
+		std::atomic<int> m_Next;
+	};
+}
@@ -0,0 +1,72 @@
+/*
+	PhysiCam - Physically based camera
+	Copyright (C) 2015 Frank Khnke
+
+	This file is part of PhysiCam.
+
+	This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License 
+	as published by the Free Software Foundation; either 
+	version 3 of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ *	@file UniformRingBuffer.h
+ */
+
+#pragma once
+
+#include <physicam/physicam_def.h>
+
+#include <cstddef>
+
+//frames the ring covers, a frame slot is only written again once the gpu is done with it
+#define PC_UNIFORM_RING_FRAMES		3
+//returned by Push when the frame slot is full
+#define PC_UNIFORM_RING_FULL		((size_t)-1)
+
+namespace PhysiCam
+{
+	/*
+	* Uniform buffer split into one slot per frame in flight. Uniform blocks are copied into the
+	* current slot and bound by range, so nothing is allocated or looked up by name per frame.
+	* With ARB_buffer_storage the buffer stays persistently mapped, otherwise every push is a glBufferSubData.
+	*/
+	class PHYSICAM_DLL UniformRingBuffer
+	{
+	public:
+		UniformRingBuffer();
+		~UniformRingBuffer();
+
+		//each frame slot holds up to blockCount pushes of at most maxBlockSize bytes
+		void Init(int blockCount, size_t maxBlockSize);
+		void Delete();
+
+		//copies the block into the current frame slot and returns its offset in the buffer.
+		//A full slot is a sizing bug: it asserts, release builds keep the blocks of this frame and return PC_UNIFORM_RING_FULL
+		size_t Push(const void* data, size_t size);
+		template<typename T> size_t Push(const T& block) { return Push(&block, sizeof(T)); }
+
+		void BindRange(unsigned int binding, size_t offset, size_t size);
+
+		//fences the current slot and moves on to the next one
+		void EndFrame();
+
+	private:
+		unsigned int m_Buffer;
+		unsigned char* m_Mapped;
+		size_t m_FrameSize;
+		size_t m_Alignment;
+		size_t m_Offset;
+		int m_Frame;
+		void* m_Fences[PC_UNIFORM_RING_FRAMES];
+	};
+}
@@ -29,6 +29,8 @@
 #include <physicam/PostProcessing.h>
 #include <memory>
 
+//views rendered into the layers of one set of array textures, e.g. 2 for stereo
+#define PC_MAX_VIEWS	4
 
 namespace PhysiCam
 {
@@ -54,18 +56,40 @@ namespace PhysiCam
 			SENSOR_LARGE_FORMAT
 		};
 
-		Camera(int screenWidth, int screenHeight);
+		//cameras created with the same context share shaders and intermediate render targets
+		Camera(int screenWidth, int screenHeight, PostProcessingContextPtr context = nullptr);
 		~Camera();
 
 		static bool Init();
 
+		//exposure of the Standard Output Sensitivity method, shared with the cpu postprocessing which has no camera
+		static float ComputeStandardOutputExposure(float aperture, float iso, float shutterSpeed, float middleGrey = 0.18f);
+
 		void Update(double deltaTime);
 		void RenderPostProcessing(PhysiCamFBOInputDesc inputFBODesc, unsigned int outputFramebufferId);
+		//false while the postprocessing shaders are still compiling, the first RenderPostProcessing waits for them
+		bool IsReady();
 
 
 		void UseAutoExposure(bool b){ m_AutoExposure = b; }
 		bool UsingAutoExposure() { return m_AutoExposure; }
 
+		PhysiCam::MeteringMode GetMeteringMode() const { return m_MeteringMode; }
+		//metering modes are only available with gpu metering, the fallback always averages the whole frame
+		void SetMeteringMode(PhysiCam::MeteringMode val) { m_MeteringMode = val; }
+
+		glm::vec2 MeteringPoint() const { return m_MeteringPoint; }
+		//center of spot and center weighted metering in screen coordinates (0,0 = lower left)
+		void SetMeteringPoint(glm::vec2 val) { m_MeteringPoint = val; }
+
+		float SpotMeteringRadius() const { return m_SpotMeteringRadius; }
+		//radius relative to the screen height
+		void SetSpotMeteringRadius(float val) { m_SpotMeteringRadius = val; }
+
+		glm::vec2 MeteringPercentiles() const { return m_MeteringPercentiles; }
+		//fraction of the darkest (x) and brightest (1-y) samples ignored by the metering
+		void SetMeteringPercentiles(glm::vec2 val) { m_MeteringPercentiles = glm::clamp(val, 0.0f, 1.0f); }
+
 		Camera::Sensor SensorType() { return m_SensorType; }
 		void SetSensorType(Camera::Sensor sensor) { m_SensorType = sensor; }
 		void SetSensorFromPreset(SensorPreset preset);
@@ -108,13 +132,35 @@ namespace PhysiCam
 		float GetClipFar() const;
 		void SetClipFar(float);
 
-		glm::mat4 GetViewMatrix() const { return m_ViewMatrix; }
-		void SetViewMatrix(glm::mat4 val) { m_ViewMatrix = val; }
-
-		glm::mat4 GetProjectionMatrix() const { return m_ProjectionMatrix; }
-		void SetProjectionMatrix(glm::mat4 val) { m_ProjectionMatrix = val; }
-
-		glm::mat4 GetViewProjectionMatrix() const { return m_ViewProjectionMatrix; }
+		glm::mat4 GetViewMatrix(int view = 0) const { return m_ViewMatrix[view]; }
+		void SetViewMatrix(glm::mat4 val) { SetViewMatrix(0, val); }
+		//per view matrix, e.g. the eye poses of a headset. Update keeps it instead of deriving it from the transform and the view offset
+		void SetViewMatrix(int view, glm::mat4 val);
+		//back to the transform and the view offset
+		void ResetViewMatrix(int view);
+
+		//with TAA the projection of the last Update includes the jitter
+		glm::mat4 GetProjectionMatrix(int view = 0) const { return m_ProjectionMatrix[view]; }
+		void SetProjectionMatrix(glm::mat4 val) { SetProjectionMatrix(0, val); }
+		//per view projection, e.g. the asymmetric frusta of a headset. Update keeps it instead of the lens projection and adds the jitter
+		void SetProjectionMatrix(int view, glm::mat4 val);
+		//back to the lens projection
+		void ResetProjectionMatrix(int view);
+
+		glm::mat4 GetViewProjectionMatrix(int view = 0) const { return m_ViewProjectionMatrix[view]; }
+		//view-projection of the last Update without jitter, e.g. for motion vectors of moving objects
+		glm::mat4 GetPreviousViewProjectionMatrix(int view = 0) const { return m_PreviousViewProjectionMatrix[view]; }
+		//sub pixel offset of the projection in pixels, only set while the postprocessor uses TAA
+		glm::vec2 Jitter() const { return m_Jitter; }
+
+		int ViewCount() const { return m_ViewCount; }
+		//with more than one view the color and depth inputs and the output attachment are GL_TEXTURE_2D_ARRAY with one layer
+		//per view. All views are processed in the same passes and share exposure and focus (metered on all views, focused on view 0)
+		void SetViewCount(int val);
+
+		glm::mat4 ViewOffset(int view) const { return m_ViewOffset[view]; }
+		//applied after the camera transform, e.g. half the eye distance along x for stereo. Not used for views with their own view matrix
+		void SetViewOffset(int view, glm::mat4 val) { m_ViewOffset[view] = val; }
 
 		float AspectRatio() const { return m_AspectRatio; }
 		void SetAspectRatio(float val) { m_AspectRatio = val; }
@@ -158,6 +204,9 @@ namespace PhysiCam
 
 		// Compute vertical Field of view degrees from focal length
 		float ComputeFOV(float fl);
+
+		// Radical inverse of index in the given base, the TAA jitter sequence
+		static float Halton(int index, int base);
 		Transform m_Transform;
 
 
@@ -166,6 +215,12 @@ namespace PhysiCam
 
 		bool m_AutoExposure;
 
+		//metering parameters
+		PhysiCam::MeteringMode m_MeteringMode;
+		glm::vec2 m_MeteringPoint;
+		float m_SpotMeteringRadius;
+		glm::vec2 m_MeteringPercentiles;
+
 		//sensor parameters
 
 		float m_MinIso;
@@ -204,7 +259,18 @@ namespace PhysiCam
 
 		PostProcessor *m_PostProcessor;
 		
-		glm::mat4 m_ViewMatrix, m_ProjectionMatrix, m_ViewProjectionMatrix;
+		int m_ViewCount;
+		glm::mat4 m_ViewOffset[PC_MAX_VIEWS];
+		glm::mat4 m_ViewMatrix[PC_MAX_VIEWS], m_ProjectionMatrix[PC_MAX_VIEWS], m_ViewProjectionMatrix[PC_MAX_VIEWS];
+		//matrices the application set per view, Update only builds the others
+		bool m_CustomViewMatrix[PC_MAX_VIEWS], m_CustomProjectionMatrix[PC_MAX_VIEWS];
+
+		//TAA reprojects with the matrices without jitter
+		glm::vec2 m_Jitter;
+		int m_JitterIndex;
+		bool m_PreviousValid;
+		glm::mat4 m_UnjitteredProjectionMatrix[PC_MAX_VIEWS];
+		glm::mat4 m_UnjitteredViewProjectionMatrix[PC_MAX_VIEWS], m_PreviousViewProjectionMatrix[PC_MAX_VIEWS];
 
 	};
 }
\ No newline at end of file
@@ -39,5 +39,10 @@ namespace PhysiCam
 		static bool HasTextureStorage;
 		static bool HasInternalFormatQuery;
 		static bool HasAnisotropicFiltering;
+		static bool HasComputeShader;
+		static bool HasProgramBinary;
+		static bool HasParallelShaderCompile;
+		static bool HasBufferStorage;
+		static bool HasTimerQuery;
 	};
 }
\ No newline at end of file
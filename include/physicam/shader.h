@@ -42,27 +42,52 @@ namespace PhysiCam
 	public:
 
 		~Shader();
-		static ShaderPtr Create(const std::string& vs, const std::string& fs);
+		//deferred shaders return right after submitting compile and link, errors are reported by Finish.
+		//with parallel shader compile the driver works on them in the background
+		static ShaderPtr Create(const std::string& vs, const std::string& fs, bool deferred = false);
+		//with a geometry stage in between, an empty gs is the same as the overload above
+		static ShaderPtr Create(const std::string& vs, const std::string& gs, const std::string& fs, bool deferred = false);
+		static ShaderPtr CreateCompute(const std::string& cs, bool deferred = false);
 		static ShaderPtr Load(const std::string& vertexShaderPath, const std::string& fragmentShaderPath);
 
+		//linked programs are stored in (and loaded from) this existing directory, empty disables the cache.
+		//files are named by a hash of the sources and the driver, so stale entries are never used
+		static void SetProgramCacheDirectory(const std::string& directory) { s_ProgramCacheDirectory = directory; }
+		static const std::string& ProgramCacheDirectory() { return s_ProgramCacheDirectory; }
+
+		//never blocks, always true without parallel shader compile since the status query would wait for the driver
+		bool IsCompleted();
+		//waits for a deferred shader, false if it failed to compile or link
+		bool Finish();
+
 		void Bind();
 		void Reload();
 
-		void SetParameterf(std::string name, float val);
-		void SetParameterfv(std::string name, int count, float* val);
-		void SetParameteri(std::string name, int val);
-		void SetParameteriv(std::string name, int count, int *val);
-		void SetParameterVec2(std::string name,glm::vec2 val);
-		void SetParameterVec3(std::string name, glm::vec3 val);
-		void SetParameterVec4(std::string name, glm::vec4 val);
-		void SetParameterMat3(std::string name, glm::mat3 val);
-		void SetParameterMat4(std::string name, glm::mat4 val);
-		//void SetParameterTexture(std::string name, Texture* tex, uint32_t slot);
+		void SetParameterf(const std::string& name, float val);
+		void SetParameterfv(const std::string& name, int count, float* val);
+		void SetParameteri(const std::string& name, int val);
+		void SetParameteriv(const std::string& name, int count, int *val);
+		void SetParameterVec2(const std::string& name,glm::vec2 val);
+		void SetParameterIVec2(const std::string& name, glm::ivec2 val);
+		void SetParameterVec3(const std::string& name, glm::vec3 val);
+		void SetParameterVec4(const std::string& name, glm::vec4 val);
+		void SetParameterMat3(const std::string& name, glm::mat3 val);
+		void SetParameterMat4(const std::string& name, glm::mat4 val);
+
+		//typed handles: the location is resolved once, setting it skips the name lookup
+		int GetUniformLocation(const char* name);
+		void SetParameterf(int location, float val);
+		void SetParameteri(int location, int val);
+		void SetParameterVec2(int location, glm::vec2 val);
+		void SetParameterIVec2(int location, glm::ivec2 val);
+		void SetParameterVec4(int location, glm::vec4 val);
+		//void SetParameterTexture(const std::string& name, Texture* tex, uint32_t slot);
 
 		void BindAttributeLocation(unsigned int id, const std::string &name);
 		int GetAttributeLocation(const std::string& name);
 
 		void BindFragdataLocation(unsigned int colorId, const std::string &name);
+		void SetUniformBlockBinding(const std::string &name, unsigned int binding);
 		//void SetTexture(Texture* tex);
 
 
@@ -73,6 +98,12 @@ namespace PhysiCam
 		static bool ValidateShader(unsigned int shader, const char* file = 0);
 		static bool ValidateProgram(unsigned int program);
 
+		//empty if the cache is disabled
+		static std::string GetProgramCachePath(const std::string& vs, const std::string& fs);
+		//returns 0 if there is no usable binary
+		static unsigned int LoadProgramBinary(const std::string& path);
+		static void SaveProgramBinary(unsigned int program, const std::string& path);
+
 	private:
 		//shader source code
 		std::string m_VertexSrc;
@@ -81,10 +112,17 @@ namespace PhysiCam
 		//opengl object ids
 		unsigned int m_ShaderObject;
 		unsigned int m_VSObject;
+		unsigned int m_GSObject;
 		unsigned int m_FSObject;
+		unsigned int m_CSObject;
 		
+		bool m_Pending;
+		bool m_Linked;
+		std::string m_CachePath;
 
 		//buffer for shader parameter locations
 		std::map<std::string, int> m_ParamLocations;
+
+		static std::string s_ProgramCacheDirectory;
 	};
 }
\ No newline at end of file
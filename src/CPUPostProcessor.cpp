@@ -0,0 +1,788 @@
+/*
+	PhysiCam - Physically based camera
+	Copyright (C) 2015 Frank Khnke
+
+	This file is part of PhysiCam.
+
+	This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License 
+	as published by the Free Software Foundation; either 
+	version 3 of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ *	@file CPUPostProcessor.cpp
+ */
+
+#include <physicam/CPUPostProcessor.h>
+#include <physicam/camera.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+//SSE2 is part of every x64 target, AVX is only used where the compiler targets it (/arch:AVX2, -mavx2)
+#if !defined(PC_CPU_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define PC_CPU_SSE 1
+#include <emmintrin.h>
+#if defined(__AVX__)
+#define PC_CPU_AVX 1
+#include <immintrin.h>
+#endif
+#endif
+
+namespace PhysiCam
+{
+	namespace
+	{
+		const float PI = 3.14159265f;
+
+		//one RGBA pixel
+#ifdef PC_CPU_SSE
+		struct Vec4
+		{
+			__m128 v;
+
+			Vec4() {}
+			Vec4(__m128 m) : v(m) {}
+			explicit Vec4(float s) : v(_mm_set1_ps(s)) {}
+			Vec4(float x, float y, float z, float w) : v(_mm_setr_ps(x, y, z, w)) {}
+
+			static Vec4 Load(const float* p) { return _mm_loadu_ps(p); }
+			void Store(float* p) const { _mm_storeu_ps(p, v); }
+		};
+
+		inline Vec4 operator+(Vec4 a, Vec4 b) { return _mm_add_ps(a.v, b.v); }
+		inline Vec4 operator-(Vec4 a, Vec4 b) { return _mm_sub_ps(a.v, b.v); }
+		inline Vec4 operator*(Vec4 a, Vec4 b) { return _mm_mul_ps(a.v, b.v); }
+		inline Vec4 operator/(Vec4 a, Vec4 b) { return _mm_div_ps(a.v, b.v); }
+		inline Vec4 Max(Vec4 a, Vec4 b) { return _mm_max_ps(a.v, b.v); }
+
+		//x of r, y of g, z of b and w = 1, for the chromatic samples
+		inline Vec4 Channels(Vec4 r, Vec4 g, Vec4 b)
+		{
+			const __m128 maskR = _mm_castsi128_ps(_mm_setr_epi32(-1, 0, 0, 0));
+			const __m128 maskG = _mm_castsi128_ps(_mm_setr_epi32(0, -1, 0, 0));
+			const __m128 maskB = _mm_castsi128_ps(_mm_setr_epi32(0, 0, -1, 0));
+			__m128 c = _mm_or_ps(_mm_and_ps(r.v, maskR), _mm_or_ps(_mm_and_ps(g.v, maskG), _mm_and_ps(b.v, maskB)));
+			return _mm_or_ps(c, _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f));
+		}
+#else
+		struct Vec4
+		{
+			float v[4];
+
+			Vec4() {}
+			explicit Vec4(float s) { v[0] = v[1] = v[2] = v[3] = s; }
+			Vec4(float x, float y, float z, float w) { v[0] = x; v[1] = y; v[2] = z; v[3] = w; }
+
+			static Vec4 Load(const float* p) { return Vec4(p[0], p[1], p[2], p[3]); }
+			void Store(float* p) const { p[0] = v[0]; p[1] = v[1]; p[2] = v[2]; p[3] = v[3]; }
+		};
+
+		inline Vec4 operator+(Vec4 a, Vec4 b) { return Vec4(a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]); }
+		inline Vec4 operator-(Vec4 a, Vec4 b) { return Vec4(a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3]); }
+		inline Vec4 operator*(Vec4 a, Vec4 b) { return Vec4(a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3]); }
+		inline Vec4 operator/(Vec4 a, Vec4 b) { return Vec4(a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2], a.v[3] / b.v[3]); }
+		inline Vec4 Max(Vec4 a, Vec4 b)
+		{
+			return Vec4(std::max(a.v[0], b.v[0]), std::max(a.v[1], b.v[1]), std::max(a.v[2], b.v[2]), std::max(a.v[3], b.v[3]));
+		}
+
+		inline Vec4 Channels(Vec4 r, Vec4 g, Vec4 b) { return Vec4(r.v[0], g.v[1], b.v[2], 1.0f); }
+#endif
+
+		inline Vec4 operator*(Vec4 a, float s) { return a * Vec4(s); }
+		inline Vec4 Lerp(Vec4 a, Vec4 b, float t) { return a + (b - a) * t; }
+
+		//out = w * a
+		inline void Scale(float* out, const float* a, float w, int count)
+		{
+			int i = 0;
+#ifdef PC_CPU_AVX
+			__m256 w8 = _mm256_set1_ps(w);
+			for (; i + 8 <= count; i += 8)
+				_mm256_storeu_ps(out + i, _mm256_mul_ps(w8, _mm256_loadu_ps(a + i)));
+#endif
+#ifdef PC_CPU_SSE
+			__m128 w4 = _mm_set1_ps(w);
+			for (; i + 4 <= count; i += 4)
+				_mm_storeu_ps(out + i, _mm_mul_ps(w4, _mm_loadu_ps(a + i)));
+#endif
+			for (; i < count; i++)
+				out[i] = w * a[i];
+		}
+
+		//out += w * (a + b), the two taps of a symmetric kernel
+		inline void AccumulatePair(float* out, const float* a, const float* b, float w, int count)
+		{
+			int i = 0;
+#ifdef PC_CPU_AVX
+			__m256 w8 = _mm256_set1_ps(w);
+			for (; i + 8 <= count; i += 8)
+			{
+				__m256 sum = _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+				_mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(out + i), _mm256_mul_ps(w8, sum)));
+			}
+#endif
+#ifdef PC_CPU_SSE
+			__m128 w4 = _mm_set1_ps(w);
+			for (; i + 4 <= count; i += 4)
+			{
+				__m128 sum = _mm_add_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+				_mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(w4, sum)));
+			}
+#endif
+			for (; i < count; i++)
+				out[i] += w * (a[i] + b[i]);
+		}
+
+		inline Vec4 Texel(const CPUImage& img, int x, int y)
+		{
+			x = std::min(std::max(x, 0), img.Width - 1);
+			y = std::min(std::max(y, 0), img.Height - 1);
+			return Vec4::Load(&img.Pixels[(y * img.Width + x) * 4]);
+		}
+
+		//bilinear filtering and clamp to edge, like texture() on the render targets
+		inline Vec4 Sample(const CPUImage& img, float u, float v)
+		{
+			float x = std::min(std::max(u, -1.0f), 2.0f) * img.Width - 0.5f;
+			float y = std::min(std::max(v, -1.0f), 2.0f) * img.Height - 0.5f;
+			float fx = std::floor(x), fy = std::floor(y);
+			int x0 = (int)fx, y0 = (int)fy;
+
+			Vec4 bottom = Lerp(Texel(img, x0, y0), Texel(img, x0 + 1, y0), x - fx);
+			Vec4 top = Lerp(Texel(img, x0, y0 + 1), Texel(img, x0 + 1, y0 + 1), x - fx);
+			return Lerp(bottom, top, y - fy);
+		}
+
+		inline float SampleDepth(const CPUImage& img, float u, float v)
+		{
+			float x = std::min(std::max(u, -1.0f), 2.0f) * img.Width - 0.5f;
+			float y = std::min(std::max(v, -1.0f), 2.0f) * img.Height - 0.5f;
+			float fx = std::floor(x), fy = std::floor(y);
+			int x0 = std::min(std::max((int)fx, 0), img.Width - 1), x1 = std::min(std::max((int)fx + 1, 0), img.Width - 1);
+			int y0 = std::min(std::max((int)fy, 0), img.Height - 1), y1 = std::min(std::max((int)fy + 1, 0), img.Height - 1);
+
+			const float *p = &img.Pixels[0];
+			float bottom = p[y0 * img.Width + x0] + (p[y0 * img.Width + x1] - p[y0 * img.Width + x0]) * (x - fx);
+			float top = p[y1 * img.Width + x0] + (p[y1 * img.Width + x1] - p[y1 * img.Width + x0]) * (x - fx);
+			return bottom + (top - bottom) * (y - fy);
+		}
+
+		inline float Fract(float x) { return x - std::floor(x); }
+		inline float Mix(float a, float b, float t) { return a + (b - a) * t; }
+		inline float Clamp(float x, float lo, float hi) { return std::min(std::max(x, lo), hi); }
+		inline float Smoothstep(float e0, float e1, float x)
+		{
+			float t = Clamp((x - e0) / (e1 - e0), 0.0f, 1.0f);
+			return t * t * (3.0f - 2.0f * t);
+		}
+
+		void Resize(CPUImage& img, int width, int height, int channels)
+		{
+			img.Width = width;
+			img.Height = height;
+			img.Channels = channels;
+			img.Pixels.resize(width * height * channels);
+		}
+
+		//GetScaledSize of PostProcessor without dynamic resolution
+		void ScaledSize(int width, int height, float factor, int& scaledWidth, int& scaledHeight)
+		{
+			scaledWidth = std::max(1, (int)std::ceil(width * factor));
+			scaledHeight = std::max(1, (int)std::ceil(height * factor));
+		}
+
+		//taps of IncrGaussBlurSrc. they are not normalized, the bloom strengths are tuned for that
+		void GaussWeights(float radius, std::vector<float>& weights)
+		{
+			weights.clear();
+			int samples = std::min(std::max((int)radius, 1), 4096) / 2;
+			if (samples == 0)
+			{
+				weights.push_back(1.0f);
+				return;
+			}
+
+			float sigma = radius / 8.0f;
+			float x = 1.0f / (std::sqrt(2.0f * PI) * sigma);
+			float y = std::exp(-0.5f / (sigma * sigma));
+			float z = y * y;
+			weights.push_back(x);
+			for (int i = 1; i < samples; i++)
+			{
+				x *= y;
+				y *= z;
+				weights.push_back(x);
+			}
+		}
+
+		/* tonemapping, see ToneMappingStageSrc */
+
+		inline float Uncharted2(float x)
+		{
+			const float A = 0.15f, B = 0.50f, C = 0.10f, D = 0.20f, E = 0.02f, F = 0.30f;
+			return ((x * (A * x + C * B) + D * E) / (x * (A * x + B) + D * F)) - E / F;
+		}
+
+		inline void Rnm(float x, float y, float timer, float rnm[4])
+		{
+			float noise = std::sin((x + timer) * 12.9898f + (y + timer) * 78.233f) * 43758.5453f;
+			rnm[0] = Fract(noise) * 2.0f - 1.0f;
+			rnm[1] = Fract(noise * 1.2154f) * 2.0f - 1.0f;
+			rnm[2] = Fract(noise * 1.3453f) * 2.0f - 1.0f;
+			rnm[3] = Fract(noise * 1.3647f) * 2.0f - 1.0f;
+		}
+
+		inline float Fade(float t) { return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f); }
+
+		float PerlinNoise(float px, float py, float pz, float timer)
+		{
+			const float permTexUnit = 1.0f / 256.0f, permTexUnitHalf = 0.5f / 256.0f;
+			float pi[3] = { permTexUnit * std::floor(px) + permTexUnitHalf, permTexUnit * std::floor(py) + permTexUnitHalf,
+				permTexUnit * std::floor(pz) + permTexUnitHalf };
+			float pf[3] = { Fract(px), Fract(py), Fract(pz) };
+
+			//corners in the order 000, 001, 010, 011, 100, 101, 110, 111 (x, y, z)
+			float n[8];
+			for (int corner = 0; corner < 8; corner++)
+			{
+				int cx = (corner >> 2) & 1, cy = (corner >> 1) & 1, cz = corner & 1;
+				float r[4], g[4];
+				Rnm(pi[0] + cx * permTexUnit, pi[1] + cy * permTexUnit, timer, r);
+				Rnm(r[3], pi[2] + cz * permTexUnit, timer, g);
+				n[corner] = (g[0] * 4.0f - 1.0f) * (pf[0] - cx) + (g[1] * 4.0f - 1.0f) * (pf[1] - cy) + (g[2] * 4.0f - 1.0f) * (pf[2] - cz);
+			}
+
+			float fx = Fade(pf[0]), fy = Fade(pf[1]), fz = Fade(pf[2]);
+			float nx[4] = { Mix(n[0], n[4], fx), Mix(n[1], n[5], fx), Mix(n[2], n[6], fx), Mix(n[3], n[7], fx) };
+			float nxy[2] = { Mix(nx[0], nx[2], fy), Mix(nx[1], nx[3], fy) };
+			return Mix(nxy[0], nxy[1], fz);
+		}
+
+		inline float Rand(float u, float v, float scale)
+		{
+			return Clamp(Fract(std::sin(u * 12.9898f * scale + v * 78.233f * scale) * 43758.5453f), 0.0f, 1.0f);
+		}
+	}
+
+	CPUPostProcessor::CPUPostProcessor(unsigned int threadCount /*= 0*/) : m_ThreadPool(threadCount), m_BloomEnabled(true),
+		m_BloomThreshold(1.0f), m_BloomIntensity(0.5f), m_ToneMappingEnabled(true), m_ToneMappingMethod(TonemappingMethod::Filmic),
+		m_DoFEnabled(true), m_DoFAberation(0.6f), m_DoFFocalDistance(3.0f), m_DoFAutofocus(true), m_DoFShowFocus(false),
+		m_DoFVignetting(true), m_DoFMaxBlur(3.0f), m_LensDistortionAmount(0.1f), m_MaxNoise(0.45f), m_MinNoise(0.015f), m_GrainSeed(0.0f)
+	{
+		//defaults of PostProcessor
+		m_BloomSpreads[0] = 16.0f;
+		m_BloomSpreads[1] = 16.0f;
+		m_BloomSpreads[2] = 24.0f;
+		m_BloomSpreads[3] = 24.0f;
+		m_BloomSpreads[4] = 32.0f;
+		m_BloomStrengths[0] = 0.75f;
+		m_BloomStrengths[1] = 0.75f;
+		m_BloomStrengths[2] = 1.0f;
+		m_BloomStrengths[3] = 1.0f;
+		m_BloomStrengths[4] = 1.0f;
+	}
+
+	CPUPostProcessor::~CPUPostProcessor()
+	{
+	}
+
+	void CPUPostProcessor::CopySettings(Camera* camera)
+	{
+		m_CameraSettings.Iso = camera->Iso();
+		m_CameraSettings.MaxIso = camera->MaxIso();
+		m_CameraSettings.Aperture = camera->Aperture();
+		m_CameraSettings.ShutterSpeed = camera->ShutterSpeed();
+		m_CameraSettings.FocalLength = camera->FocalLength();
+		m_CameraSettings.CoC = camera->SensorType().CoC;
+		m_CameraSettings.ClipNear = camera->GetClipNear();
+		m_CameraSettings.ClipFar = camera->GetClipFar();
+
+		PostProcessor *pp = camera->GetPostProcessor();
+		m_BloomEnabled = pp->BloomEnabled();
+		m_BloomThreshold = pp->BloomThreshold();
+		for (int i = 0; i < 5; i++)
+		{
+			m_BloomSpreads[i] = pp->BloomSpread(i);
+			m_BloomStrengths[i] = pp->BloomIntensity(i);
+		}
+		m_BloomIntensity = pp->BloomIntensity();
+
+		m_ToneMappingEnabled = pp->TonemappingEnabled();
+		m_ToneMappingMethod = pp->GetTonemappingMethod();
+
+		m_DoFEnabled = pp->DoFEnabled();
+		m_DoFAberation = pp->DoFAberation();
+		m_DoFFocalDistance = pp->DoFFocalDistance();
+		m_DoFAutofocus = pp->DoFAutofocus();
+		m_DoFShowFocus = pp->DoFShowFocus();
+		m_DoFVignetting = pp->DoFVignetting();
+		m_DoFMaxBlur = pp->DoFMaxBlur();
+
+		m_LensDistortionAmount = pp->LensDistortionAmount();
+		m_MaxNoise = pp->MaxNoise();
+		m_MinNoise = pp->MinNoise();
+		m_GrainSeed = pp->GrainSeed();
+	}
+
+	bool CPUPostProcessor::Render(const CPUImage& color, const CPUImage& depth, CPUImage& output)
+	{
+		if (color.Width <= 0 || color.Height <= 0 || color.Channels != 4 || color.Pixels.size() != (size_t)color.Width * color.Height * 4)
+		{
+			std::cerr << "CPUPostProcessor: the color input has to be a RGBA image\n";
+			return false;
+		}
+		if (depth.Width != color.Width || depth.Height != color.Height || depth.Channels != 1 || depth.Pixels.size() != (size_t)depth.Width * depth.Height)
+		{
+			std::cerr << "CPUPostProcessor: the depth input has to be a single channel image of the color size\n";
+			return false;
+		}
+
+		//manual exposure, like Camera::RenderPostProcessing without auto exposure
+		float exposure = Camera::ComputeStandardOutputExposure(m_CameraSettings.Aperture, m_CameraSettings.Iso, m_CameraSettings.ShutterSpeed);
+		ApplyLenseDistortion(color, depth, exposure);
+
+		const CPUImage *scene = &m_LensColor;
+		if (m_BloomEnabled)
+		{
+			ApplyBloom();
+			scene = &m_Composed;
+		}
+
+		if (m_DoFEnabled)
+		{
+			ApplyDoF(*scene, m_LensDepth, m_DoF);
+			scene = &m_DoF;
+		}
+
+		Resize(output, color.Width, color.Height, 4);
+		if (m_ToneMappingEnabled)
+			ApplyToneMapping(*scene, output);
+		else
+			output.Pixels = scene->Pixels;
+		return true;
+	}
+
+	void CPUPostProcessor::ParallelRows(int height, const std::function<void(int, int)>& func)
+	{
+		m_ThreadPool.ParallelFor(height, PC_CPU_ROWS_PER_TASK, func);
+	}
+
+	void CPUPostProcessor::Resample(const CPUImage& input, CPUImage& output)
+	{
+		if (input.Width == output.Width && input.Height == output.Height)
+		{
+			output.Pixels = input.Pixels;
+			return;
+		}
+
+		ParallelRows(output.Height, [&](int begin, int end) {
+			for (int y = begin; y < end; y++)
+			{
+				float v = (y + 0.5f) / output.Height;
+				for (int x = 0; x < output.Width; x++)
+					Sample(input, (x + 0.5f) / output.Width, v).Store(&output.Pixels[(y * output.Width + x) * 4]);
+			}
+		});
+	}
+
+	//LensDistortionSrc followed by the exposure stage
+	void CPUPostProcessor::ApplyLenseDistortion(const CPUImage& color, const CPUImage& depth, float exposure)
+	{
+		int width = color.Width, height = color.Height;
+		Resize(m_LensColor, width, height, 4);
+		Resize(m_LensDepth, width, height, 1);
+
+		const float scale = 0.9f, dispersion = 0.01f;
+		const float eta[3] = { 1.0f + dispersion * 0.9f, 1.0f + dispersion * 0.6f, 1.0f + dispersion * 0.3f };
+		float k = m_LensDistortionAmount;
+		Vec4 exposureScale(exposure, exposure, exposure, 1.0f);
+
+		ParallelRows(height, [&](int begin, int end) {
+			for (int y = begin; y < end; y++)
+			{
+				float v = (y + 0.5f) / height;
+				for (int x = 0; x < width; x++)
+				{
+					float u = (x + 0.5f) / width;
+					float r2 = (u - 0.5f) * (u - 0.5f) + (v - 0.5f) * (v - 0.5f);
+					float f = 1.0f + r2 * k;
+
+					float su[3], sv[3];
+					for (int c = 0; c < 3; c++)
+					{
+						su[c] = (f * eta[c]) * scale * (u - 0.5f) + 0.5f;
+						sv[c] = (f * eta[c]) * scale * (v - 0.5f) + 0.5f;
+					}
+
+					Vec4 col = Channels(Sample(color, su[0], sv[0]), Sample(color, su[1], sv[1]), Sample(color, su[2], sv[2]));
+					(col * exposureScale).Store(&m_LensColor.Pixels[(y * width + x) * 4]);
+					m_LensDepth.Pixels[y * width + x] = SampleDepth(depth, su[0], sv[0]);
+				}
+			}
+		});
+	}
+
+	//AddBloomPasses with the incremental gaussian, m_LensColor -> m_Composed
+	void CPUPostProcessor::ApplyBloom()
+	{
+		int width = m_LensColor.Width, height = m_LensColor.Height;
+		int halfWidth, halfHeight;
+		ScaledSize(width, height, 0.5f, halfWidth, halfHeight);
+
+		Resize(m_Bright, halfWidth, halfHeight, 4);
+		Resize(m_FlareBright, halfWidth, halfHeight, 4);
+		ApplyBrightPass(m_LensColor, m_Bright, m_FlareBright);
+
+		//every level blurs the previous one at half its size
+		const CPUImage *input = &m_Bright;
+		float size = 0.5f;
+		for (int i = 0; i < 5; i++)
+		{
+			int levelWidth, levelHeight;
+			ScaledSize(width, height, size, levelWidth, levelHeight);
+			size *= 0.5f;
+
+			Resize(m_BloomLevels[i], levelWidth, levelHeight, 4);
+			Resample(*input, m_BloomLevels[i]);
+			ApplyBloomBlur(m_BloomLevels[i], m_BloomTemp, m_BloomSpreads[i]);
+			input = &m_BloomLevels[i];
+		}
+
+		//BloomComposeSrc
+		Resize(m_BloomCompose, halfWidth, halfHeight, 4);
+		ParallelRows(halfHeight, [&](int begin, int end) {
+			for (int y = begin; y < end; y++)
+			{
+				float v = (y + 0.5f) / halfHeight;
+				for (int x = 0; x < halfWidth; x++)
+				{
+					float u = (x + 0.5f) / halfWidth;
+					Vec4 sum = Sample(m_BloomLevels[0], u, v) * m_BloomStrengths[0];
+					for (int i = 1; i < 5; i++)
+						sum = sum + Sample(m_BloomLevels[i], u, v) * m_BloomStrengths[i];
+					(sum * m_BloomIntensity).Store(&m_BloomCompose.Pixels[(y * halfWidth + x) * 4]);
+				}
+			}
+		});
+
+		Resize(m_LenseFlare, halfWidth, halfHeight, 4);
+		ApplyLenseFlare(m_FlareBright, m_LenseFlare);
+
+		//BloomLenseComposeSrc, the flare is scaled by the bloom intensity as well
+		Resize(m_Composed, width, height, 4);
+		Vec4 flareStrength(m_BloomIntensity);
+		ParallelRows(height, [&](int begin, int end) {
+			for (int y = begin; y < end; y++)
+			{
+				float v = (y + 0.5f) / height;
+				for (int x = 0; x < width; x++)
+				{
+					float u = (x + 0.5f) / width;
+					Vec4 base = Vec4::Load(&m_LensColor.Pixels[(y * width + x) * 4]);
+					Vec4 col = Sample(m_BloomCompose, u, v) + Sample(m_LenseFlare, u, v) * flareStrength + base;
+					Channels(col, col, col).Store(&m_Composed.Pixels[(y * width + x) * 4]);
+				}
+			}
+		});
+	}
+
+	//BrightPassSrc, reads the full resolution scene at the half resolution pixel centers
+	void CPUPostProcessor::ApplyBrightPass(const CPUImage& input, CPUImage& bright, CPUImage& flareBright)
+	{
+		float threshold = m_BloomThreshold;
+		float flareThreshold = m_BloomThreshold * 10.0f;
+		Vec4 black(0.0f, 0.0f, 0.0f, 1.0f);
+
+		ParallelRows(bright.Height, [&](int begin, int end) {
+			for (int y = begin; y < end; y++)
+			{
+				float v = (y + 0.5f) / bright.Height;
+				for (int x = 0; x < bright.Width; x++)
+				{
+					Vec4 col = Sample(input, (x + 0.5f) / bright.Width, v);
+					float rgb[4];
+					col.Store(rgb);
+					col = Vec4(rgb[0], rgb[1], rgb[2], 1.0f);
+					float luminance = 0.2126f * rgb[0] + 0.7152f * rgb[1] + 0.0722f * rgb[2];
+
+					int i = (y * bright.Width + x) * 4;
+					(luminance > threshold ? col : black).Store(&bright.Pixels[i]);
+					(luminance > flareThreshold ? col * (1.0f / (flareThreshold - 1.0f)) : black).Store(&flareBright.Pixels[i]);
+				}
+			}
+		});
+	}
+
+	//separable IncrGaussBlurSrc, horizontal into temp and vertical back into image
+	void CPUPostProcessor::ApplyBloomBlur(CPUImage& image, CPUImage& temp, float radius)
+	{
+		std::vector<float> weights;
+		GaussWeights(radius, weights);
+		int taps = (int)weights.size() - 1;
+		int width = image.Width, height = image.Height;
+		int rowFloats = width * 4;
+		Resize(temp, width, height, 4);
+
+		//rows are padded with their edge pixels, so every tap is a plain shifted read
+		ParallelRows(height, [&](int begin, int end) {
+			std::vector<float> padded((width + 2 * taps) * 4);
+			for (int y = begin; y < end; y++)
+			{
+				const float *row = &image.Pixels[y * rowFloats];
+				for (int x = -taps; x < width + taps; x++)
+				{
+					int src = std::min(std::max(x, 0), width - 1);
+					Vec4::Load(row + src * 4).Store(&padded[(x + taps) * 4]);
+				}
+
+				float *out = &temp.Pixels[y * rowFloats];
+				const float *center = &padded[taps * 4];
+				Scale(out, center, weights[0], rowFloats);
+				for (int k = 1; k <= taps; k++)
+					AccumulatePair(out, center - k * 4, center + k * 4, weights[k], rowFloats);
+			}
+		});
+
+		ParallelRows(height, [&](int begin, int end) {
+			for (int y = begin; y < end; y++)
+			{
+				float *out = &image.Pixels[y * rowFloats];
+				Scale(out, &temp.Pixels[y * rowFloats], weights[0], rowFloats);
+				for (int k = 1; k <= taps; k++)
+				{
+					const float *below = &temp.Pixels[std::max(y - k, 0) * rowFloats];
+					const float *above = &temp.Pixels[std::min(y + k, height - 1) * rowFloats];
+					AccumulatePair(out, below, above, weights[k], rowFloats);
+				}
+			}
+		});
+	}
+
+	//LenseFlareSrc: ghosts and a halo with chromatic distortion, in texture coordinates of the full screen
+	void CPUPostProcessor::ApplyLenseFlare(const CPUImage& input, CPUImage& output)
+	{
+		const int samples = 8;
+		const float dispersal = 0.3f, haloWidth = 0.4f, distortion = 1.0f;
+		float texelWidth = 1.0f / m_LensColor.Width;
+		float distortionR = -texelWidth * distortion, distortionB = texelWidth * distortion;
+		float centerLength = std::sqrt(0.5f);
+
+		ParallelRows(output.Height, [&](int begin, int end) {
+			for (int y = begin; y < end; y++)
+			{
+				for (int x = 0; x < output.Width; x++)
+				{
+					//flipped texture coordinates
+					float u = 1.0f - (x + 0.5f) / output.Width;
+					float v = 1.0f - (y + 0.5f) / output.Height;
+
+					float ghostU = (0.5f - u) * dispersal, ghostV = (0.5f - v) * dispersal;
+					float ghostLength = std::sqrt(ghostU * ghostU + ghostV * ghostV);
+					float dirU = ghostLength > 0.0f ? ghostU / ghostLength : 0.0f;
+					float dirV = ghostLength > 0.0f ? ghostV / ghostLength : 0.0f;
+
+					auto distorted = [&](float su, float sv) {
+						return Channels(Sample(input, su + dirU * distortionR, sv + dirV * distortionR), Sample(input, su, sv),
+							Sample(input, su + dirU * distortionB, sv + dirV * distortionB));
+					};
+					auto weight = [&](float su, float sv) {
+						float w = std::sqrt((0.5f - su) * (0.5f - su) + (0.5f - sv) * (0.5f - sv)) / centerLength;
+						return std::pow(1.0f - w, 10.0f);
+					};
+
+					Vec4 result(0.0f);
+					for (int i = 0; i < samples; i++)
+					{
+						float su = Fract(u + ghostU * i), sv = Fract(v + ghostV * i);
+						result = result + distorted(su, sv) * weight(su, sv);
+					}
+
+					float hu = Fract(u + dirU * haloWidth), hv = Fract(v + dirV * haloWidth);
+					result = result + distorted(hu, hv) * weight(hu, hv);
+					Channels(result, result, result).Store(&output.Pixels[(y * output.Width + x) * 4]);
+				}
+			}
+		});
+	}
+
+	//DoFSrc: ring gather with bokeh highlights, fringing and optical vignetting
+	void CPUPostProcessor::ApplyDoF(const CPUImage& input, const CPUImage& depth, CPUImage& output)
+	{
+		int width = input.Width, height = input.Height;
+		Resize(output, width, height, 4);
+
+		const int samples = 6, rings = 3;
+		const float vignout = 1.3f, vignin = 0.0f, vignfade = 22.0f;
+		const float threshold = 1.0f, gain = 1.8f, bias = 0.5f, namount = 0.0001f;
+		const float lumR = 0.299f, lumG = 0.587f, lumB = 0.114f;
+
+		float clipNear = m_CameraSettings.ClipNear, clipFar = m_CameraSettings.ClipFar;
+		auto linearize = [=](float d) { return -clipFar * clipNear / (d * (clipFar - clipNear) - clipFar); };
+
+		float fstop = m_CameraSettings.Aperture, f = m_CameraSettings.FocalLength, coc = m_CameraSettings.CoC;
+		float focalDepth = m_DoFAutofocus ? linearize(SampleDepth(depth, 0.5f, 0.5f)) : m_DoFFocalDistance;
+		float d = focalDepth * 1000.0f;
+		float texelU = 1.0f / width, texelV = 1.0f / height;
+		float fringe = m_DoFAberation;
+
+		ParallelRows(height, [&](int begin, int end) {
+			for (int y = begin; y < end; y++)
+			{
+				float v = (y + 0.5f) / height;
+				for (int x = 0; x < width; x++)
+				{
+					float u = (x + 0.5f) / width;
+					float o = linearize(depth.Pixels[y * width + x]) * 1000.0f;
+
+					float a = (o * f) / (o - f);
+					float b = (d * f) / (d - f);
+					float c = (d - f) / (d * fstop * coc);
+					float blur = Clamp(std::abs(a - b) * c, 0.0f, 1.0f);
+
+					float noiseU = (Rand(u, v, 1.0f) * 2.0f - 1.0f) * namount * blur;
+					float noiseV = (Rand(u, v, 2.0f) * 2.0f - 1.0f) * namount * blur;
+					float w = texelU * blur * m_DoFMaxBlur + noiseU;
+					float h = texelV * blur * m_DoFMaxBlur + noiseV;
+
+					Vec4 col = Vec4::Load(&input.Pixels[(y * width + x) * 4]);
+					if (blur >= 0.05f)
+					{
+						float s = 1.0f;
+						for (int i = 1; i <= rings; i++)
+						{
+							int ringSamples = i * samples;
+							float step = PI * 2.0f / ringSamples;
+							float ringWeight = Mix(1.0f, (float)i / rings, bias);
+							for (int j = 0; j < ringSamples; j++)
+							{
+								float su = u + std::cos(j * step) * i * w;
+								float sv = v + std::sin(j * step) * i * h;
+
+								//color(): fringed channels and a gain for highlights
+								float fu = texelU * fringe * blur, fv = texelV * fringe * blur;
+								Vec4 sample = Channels(Sample(input, su, sv + fv), Sample(input, su - 0.866f * fu, sv - 0.5f * fv),
+									Sample(input, su + 0.866f * fu, sv - 0.5f * fv));
+								float rgb[4];
+								sample.Store(rgb);
+								float lum = rgb[0] * lumR + rgb[1] * lumG + rgb[2] * lumB;
+								float thresh = std::max((lum - threshold) * gain, 0.0f);
+								sample = sample * (1.0f + thresh * blur);
+
+								col = col + sample * ringWeight;
+								s += ringWeight;
+							}
+						}
+						col = col * (1.0f / s);
+					}
+
+					float rgb[4];
+					col.Store(rgb);
+					if (m_DoFShowFocus)
+					{
+						float depthM = o / 1000.0f;
+						float edge = 0.002f * depthM;
+						float m = Clamp(Smoothstep(0.0f, edge, blur), 0.0f, 1.0f);
+						float e = Clamp(Smoothstep(1.0f - edge, 1.0f, blur), 0.0f, 1.0f);
+						const float focusColor[3] = { 1.0f, 0.5f, 0.0f }, rangeColor[3] = { 0.0f, 0.5f, 1.0f };
+						for (int ch = 0; ch < 3; ch++)
+						{
+							rgb[ch] = Mix(rgb[ch], focusColor[ch], (1.0f - m) * 0.6f);
+							rgb[ch] = Mix(rgb[ch], rangeColor[ch], ((1.0f - e) - (1.0f - m)) * 0.2f);
+						}
+					}
+					if (m_DoFVignetting)
+					{
+						float dist = std::sqrt((u - 0.5f) * (u - 0.5f) + (v - 0.5f) * (v - 0.5f));
+						float vignette = Clamp(Smoothstep(vignout + fstop / vignfade, vignin + fstop / vignfade, dist), 0.0f, 1.0f);
+						for (int ch = 0; ch < 3; ch++)
+							rgb[ch] *= vignette;
+					}
+
+					Vec4(rgb[0], rgb[1], rgb[2], 1.0f).Store(&output.Pixels[(y * width + x) * 4]);
+				}
+			}
+		});
+	}
+
+	//ToneMappingStageSrc with film grain
+	void CPUPostProcessor::ApplyToneMapping(const CPUImage& input, CPUImage& output)
+	{
+		int width = input.Width, height = input.Height;
+		float iso = m_CameraSettings.Iso, maxIso = m_CameraSettings.MaxIso;
+		float grainAmount = m_MinNoise + ((m_MaxNoise - m_MinNoise) / (maxIso - 1.0f)) * (iso - 1.0f);
+		float timer = m_GrainSeed;
+		float aspect = width / (float)height;
+		const float grainSize = 1.6f, lumAmount = 1.0f, rotOffset = 1.425f;
+		const float W = 11.2f, exposureBias = 2.0f;
+		float whiteScale = 1.0f / Uncharted2(W);
+		TonemappingMethod method = m_ToneMappingMethod;
+
+		ParallelRows(height, [&](int begin, int end) {
+			for (int y = begin; y < end; y++)
+			{
+				int x = 0;
+				float *out = &output.Pixels[y * width * 4];
+				const float *in = &input.Pixels[y * width * 4];
+
+				//the rational filmic curve runs on whole pixels, the others need pow per channel
+				if (method == TonemappingMethod::Filmic)
+				{
+					for (; x < width; x++)
+					{
+						Vec4 col = Max(Vec4::Load(in + x * 4) - Vec4(0.004f), Vec4(0.0f));
+						Vec4 mapped = (col * (col * 6.2f + Vec4(0.5f))) / (col * (col * 6.2f + Vec4(1.7f)) + Vec4(0.06f));
+						mapped.Store(out + x * 4);
+					}
+				}
+				else
+				{
+					for (; x < width; x++)
+					{
+						for (int c = 0; c < 3; c++)
+						{
+							float col = in[x * 4 + c];
+							if (method == TonemappingMethod::Reinhard)
+								col = std::pow(col / (col + 1.0f), 1.0f / 2.2f);
+							else
+								col = std::pow(Uncharted2(exposureBias * col) * whiteScale, 1.0f / 2.2f);
+							out[x * 4 + c] = col;
+						}
+					}
+				}
+
+				//grain, a rotated perlin noise fading out in bright areas
+				float v = (y + 0.5f) / height;
+				for (x = 0; x < width; x++)
+				{
+					float u = (x + 0.5f) / width;
+					float angle = timer + rotOffset;
+					float rotX = ((u * 2.0f - 1.0f) * aspect * std::cos(angle)) - ((v * 2.0f - 1.0f) * std::sin(angle));
+					float rotY = ((v * 2.0f - 1.0f) * std::cos(angle)) + ((u * 2.0f - 1.0f) * aspect * std::sin(angle));
+					rotX = (rotX / aspect) * 0.5f + 0.5f;
+					rotY = rotY * 0.5f + 0.5f;
+
+					float noise = PerlinNoise(rotX * (width / grainSize), rotY * (height / grainSize), 0.0f, timer);
+					float *col = out + x * 4;
+					float luminance = Mix(0.0f, col[0] * 0.299f + col[1] * 0.587f + col[2] * 0.114f, lumAmount);
+					noise = Mix(noise, 0.0f, luminance);
+					for (int c = 0; c < 3; c++)
+						col[c] += noise * grainAmount;
+					col[3] = 1.0f;
+				}
+			}
+		});
+	}
+
+}
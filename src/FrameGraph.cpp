@@ -0,0 +1,244 @@
+/*
+	PhysiCam - Physically based camera
+	Copyright (C) 2015 Frank Khnke
+
+	This file is part of PhysiCam.
+
+	This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License 
+	as published by the Free Software Foundation; either 
+	version 3 of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ *	@file FrameGraph.cpp
+ */
+
+#include <physicam/FrameGraph.h>
+
+#include <GL/glew.h>
+
+namespace PhysiCam
+{
+
+	FrameGraph::FrameGraph(RenderTargetPool *pool) : m_Pool(pool), m_Profiler(nullptr), m_CurrentPass(-1)
+	{
+	}
+
+	void FrameGraph::Reset()
+	{
+		m_Resources.clear();
+		m_Passes.clear();
+		m_CurrentPass = -1;
+	}
+
+	FrameGraphResource FrameGraph::CreateTexture(const char* name, const RenderTargetDesc& desc)
+	{
+		Resource r;
+		r.Name = name;
+		r.Desc = desc;
+		r.Imported = false;
+		r.ImportedId = 0;
+		r.Producer = -1;
+		r.RefCount = 0;
+		r.FirstUse = r.LastUse = -1;
+		m_Resources.push_back(r);
+		return (FrameGraphResource)m_Resources.size() - 1;
+	}
+
+	FrameGraphResource FrameGraph::ImportTexture(const char* name, unsigned int textureId, glm::ivec2 size)
+	{
+		FrameGraphResource res = CreateTexture(name, RenderTargetDesc(size, RenderTexture::RGB32F));
+		m_Resources[res].Imported = true;
+		m_Resources[res].ImportedId = textureId;
+		return res;
+	}
+
+	FrameGraphResource FrameGraph::ImportTexture(const char* name, RenderTexturePtr texture)
+	{
+		FrameGraphResource res = ImportTexture(name, texture->GetTextureId(), texture->GetSize());
+		m_Resources[res].Texture = texture;
+		return res;
+	}
+
+	int FrameGraph::AddPass(const char* name, ExecuteFunc func)
+	{
+		Pass p;
+		p.Name = name;
+		p.Func = func;
+		p.NumReads = 0;
+		p.NumWrites = 0;
+		p.SideEffect = false;
+		p.RefCount = 0;
+		p.Culled = false;
+		m_Passes.push_back(p);
+		return (int)m_Passes.size() - 1;
+	}
+
+	void FrameGraph::Read(int pass, FrameGraphResource res)
+	{
+		Pass &p = m_Passes[pass];
+		if (res < 0 || p.NumReads >= PC_FRAMEGRAPH_MAX_READS)
+		{
+			std::cerr << "FrameGraph: invalid read in pass " << p.Name << std::endl;
+			return;
+		}
+		p.Reads[p.NumReads++] = res;
+	}
+
+	void FrameGraph::Write(int pass, FrameGraphResource res)
+	{
+		Pass &p = m_Passes[pass];
+		if (res < 0 || p.NumWrites >= PC_MAX_RENDER_TARGETS)
+		{
+			std::cerr << "FrameGraph: invalid write in pass " << p.Name << std::endl;
+			return;
+		}
+		p.Writes[p.NumWrites++] = res;
+		m_Resources[res].Producer = pass;
+	}
+
+	void FrameGraph::SetSideEffect(int pass)
+	{
+		m_Passes[pass].SideEffect = true;
+	}
+
+	void FrameGraph::Compile()
+	{
+		//reference counts: readers per resource, writes per pass
+		for (auto &p : m_Passes)
+		{
+			p.RefCount = p.NumWrites;
+			for (int i = 0; i < p.NumReads; i++)
+				m_Resources[p.Reads[i]].RefCount++;
+		}
+
+		//cull passes whose outputs nobody reads, this can make their inputs unused as well
+		m_CullStack.clear();
+		for (size_t i = 0; i < m_Resources.size(); i++)
+		{
+			if (m_Resources[i].RefCount == 0 && !m_Resources[i].Imported)
+				m_CullStack.push_back((FrameGraphResource)i);
+		}
+		while (!m_CullStack.empty())
+		{
+			Resource &r = m_Resources[m_CullStack.back()];
+			m_CullStack.pop_back();
+
+			if (r.Producer < 0)
+				continue;
+
+			Pass &producer = m_Passes[r.Producer];
+			if (producer.SideEffect || --producer.RefCount > 0)
+				continue;
+
+			for (int i = 0; i < producer.NumReads; i++)
+			{
+				Resource &in = m_Resources[producer.Reads[i]];
+				if (--in.RefCount == 0 && !in.Imported)
+					m_CullStack.push_back(producer.Reads[i]);
+			}
+		}
+
+		//lifetimes of the remaining resources
+		for (size_t i = 0; i < m_Passes.size(); i++)
+		{
+			Pass &p = m_Passes[i];
+			p.Culled = p.RefCount == 0 && !p.SideEffect;
+			if (p.Culled)
+				continue;
+
+			for (int j = 0; j < p.NumReads + p.NumWrites; j++)
+			{
+				Resource &r = m_Resources[j < p.NumReads ? p.Reads[j] : p.Writes[j - p.NumReads]];
+				if (!IsLive(r))
+					continue;
+				if (r.FirstUse < 0)
+					r.FirstUse = (int)i;
+				r.LastUse = (int)i;
+			}
+		}
+	}
+
+	void FrameGraph::Execute()
+	{
+		for (size_t i = 0; i < m_Passes.size(); i++)
+		{
+			Pass &p = m_Passes[i];
+			if (p.Culled)
+				continue;
+
+			//allocate textures which are first used by this pass
+			for (int j = 0; j < p.NumReads + p.NumWrites; j++)
+			{
+				Resource &r = m_Resources[j < p.NumReads ? p.Reads[j] : p.Writes[j - p.NumReads]];
+				if (!r.Imported && r.FirstUse == (int)i && !r.Texture)
+					r.Texture = m_Pool->Acquire(r.Desc);
+			}
+
+			m_CurrentPass = (int)i;
+			if (m_Profiler)
+				m_Profiler->Begin(p.Name);
+			p.Func(*this, p.Capture);
+			if (m_Profiler)
+				m_Profiler->End();
+			m_CurrentPass = -1;
+
+			//hand textures back to the pool after their last use, later passes can alias them
+			for (int j = 0; j < p.NumReads + p.NumWrites; j++)
+			{
+				Resource &r = m_Resources[j < p.NumReads ? p.Reads[j] : p.Writes[j - p.NumReads]];
+				if (r.Texture && !r.Imported && r.LastUse == (int)i)
+				{
+					m_Pool->Release(r.Texture);
+					r.Texture.reset();
+				}
+			}
+		}
+	}
+
+	unsigned int FrameGraph::GetTextureId(FrameGraphResource res)
+	{
+		Resource &r = m_Resources[res];
+		if (r.Imported)
+			return r.ImportedId;
+		return r.Texture ? r.Texture->GetTextureId() : 0;
+	}
+
+	RenderTexturePtr FrameGraph::GetTexture(FrameGraphResource res)
+	{
+		return m_Resources[res].Texture;
+	}
+
+	glm::ivec2 FrameGraph::GetSize(FrameGraphResource res)
+	{
+		return m_Resources[res].Desc.Size;
+	}
+
+	bool FrameGraph::IsUsed(FrameGraphResource res) const
+	{
+		return m_Resources[res].RefCount > 0;
+	}
+
+	void FrameGraph::BindRenderTargets()
+	{
+		if (m_CurrentPass < 0)
+			return;
+
+		//writes nobody reads are left unattached, the fragment output for them is discarded
+		Pass &p = m_Passes[m_CurrentPass];
+		RenderTexturePtr targets[PC_MAX_RENDER_TARGETS];
+		for (int i = 0; i < p.NumWrites; i++)
+			targets[i] = m_Resources[p.Writes[i]].Texture;
+
+		m_Pool->GetFramebuffer(targets, p.NumWrites)->Bind();
+	}
+}
@@ -1,4 +1,6 @@
 #include <Physicam/Framebuffer.h>
+#include <physicam/GLState.h>
+#include <physicam/physicam_gl.h>
 
 #include <gl/glew.h>
 
@@ -11,6 +13,7 @@ namespace PhysiCam
 
 	Framebuffer::~Framebuffer()
 	{
+		GLState::FramebufferDeleted(m_FBO);
 		glDeleteFramebuffers(1, &m_FBO);
 	}
 
@@ -20,7 +23,11 @@ namespace PhysiCam
 		fb->m_Size.x = width;
 		fb->m_Size.y = height;
 
-		glGenFramebuffers(1, &fb->m_FBO);
+		//a created framebuffer exists right away, a generated name only after its first bind
+		if (GL::HasDirectStateAccess)
+			glCreateFramebuffers(1, &fb->m_FBO);
+		else
+			glGenFramebuffers(1, &fb->m_FBO);
 		return fb;
 	}
 
@@ -32,24 +39,34 @@ namespace PhysiCam
 		if (renderTexture->GetSize() != m_Size)
 			std::cerr << "Warning: Bound render texture does not match framebuffer size! TextureId:" << renderTexture->GetTextureId() << " FramebufferId:" << m_FBO;
 
-		glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
-		switch (renderTexture->GetType())
+		GLenum FBOstatus;
+		if (GL::HasDirectStateAccess)
 		{
-		case GL_TEXTURE_1D:
-			glFramebufferTexture1D(GL_FRAMEBUFFER, targetAttachmentType, renderTexture->GetType(), renderTexture->GetTextureId(), 0);
-			break;
-		case GL_TEXTURE_2D:
-			glFramebufferTexture2D(GL_FRAMEBUFFER, targetAttachmentType, renderTexture->GetType(), renderTexture->GetTextureId(), 0);
-			break;
-		case GL_TEXTURE_3D:
-			glFramebufferTexture3D(GL_FRAMEBUFFER, targetAttachmentType, renderTexture->GetType(), renderTexture->GetTextureId(), 0, 0);
-			break;
-		default:
-			glFramebufferTexture(GL_FRAMEBUFFER, targetAttachmentType, renderTexture->GetTextureId(), 0);
+			glNamedFramebufferTexture(m_FBO, targetAttachmentType, renderTexture->GetTextureId(), 0);
+			FBOstatus = glCheckNamedFramebufferStatus(m_FBO, GL_FRAMEBUFFER);
+		}
+		else
+		{
+			GLState::BindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+			switch (renderTexture->GetType())
+			{
+			case GL_TEXTURE_1D:
+				glFramebufferTexture1D(GL_FRAMEBUFFER, targetAttachmentType, renderTexture->GetType(), renderTexture->GetTextureId(), 0);
+				break;
+			case GL_TEXTURE_2D:
+				glFramebufferTexture2D(GL_FRAMEBUFFER, targetAttachmentType, renderTexture->GetType(), renderTexture->GetTextureId(), 0);
+				break;
+			case GL_TEXTURE_3D:
+				glFramebufferTexture3D(GL_FRAMEBUFFER, targetAttachmentType, renderTexture->GetType(), renderTexture->GetTextureId(), 0, 0);
+				break;
+			default:
+				glFramebufferTexture(GL_FRAMEBUFFER, targetAttachmentType, renderTexture->GetTextureId(), 0);
+			}
+
+			// check FBO status
+			FBOstatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
 		}
 
-		// check FBO status
-		GLenum FBOstatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
 		if (FBOstatus != GL_FRAMEBUFFER_COMPLETE)
 		{
 			std::cerr << "GLError: GL_FRAMEBUFFER_COMPLETE failed, CANNOT use FBO\n";
@@ -57,30 +74,46 @@ namespace PhysiCam
 		}
 
 		m_BoundTextures[targetAttachmentType] = renderTexture;
+
+		//draw buffer i receives fragment output location i, so COLORn has to end up at index n (gaps are NONE)
 		m_BoundAttachmentTypes.clear();
 		for (auto &rt : m_BoundTextures)
 		{
-			if (rt.second && !(rt.first == DEPTH_ATTACHMENT || rt.first == STENCIL_ATTACHMENT || rt.first == DEPTH_STENCIL_ATTACHMENT))
-				m_BoundAttachmentTypes.push_back(rt.first);
+			if (!rt.second || rt.first < COLOR0 || rt.first > COLOR15)
+				continue;
+
+			unsigned int location = rt.first - COLOR0;
+			if (m_BoundAttachmentTypes.size() <= location)
+				m_BoundAttachmentTypes.resize(location + 1, NONE);
+			m_BoundAttachmentTypes[location] = rt.first;
+		}
+
+		//the draw buffers belong to the framebuffer object, so they are only set when the attachments change
+		if (GL::HasDirectStateAccess)
+		{
+			if (m_BoundAttachmentTypes.size() > 0)
+				glNamedFramebufferDrawBuffers(m_FBO, m_BoundAttachmentTypes.size(), (GLenum*)&m_BoundAttachmentTypes[0]);
+			return true;
 		}
 
+		if (m_BoundAttachmentTypes.size() > 0)
+			glDrawBuffers(m_BoundAttachmentTypes.size(), (GLenum*)&m_BoundAttachmentTypes[0]);
+
 		// switch back to window-system-provided framebuffer
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		GLState::BindFramebuffer(GL_FRAMEBUFFER, 0);
 
 		return true;
 	}
 
 	void Framebuffer::Bind()
 	{
-		glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
-		if (m_BoundAttachmentTypes.size() > 0)
-			glDrawBuffers(m_BoundAttachmentTypes.size(), (GLenum*)&m_BoundAttachmentTypes[0]);
-		glViewport(0, 0, m_Size.x, m_Size.y);
+		GLState::BindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+		GLState::Viewport(0, 0, m_Size.x, m_Size.y);
 	}
 
 	void Framebuffer::Unbind()
 	{
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		GLState::BindFramebuffer(GL_FRAMEBUFFER, 0);
 	}
 
 	RenderTexturePtr Framebuffer::CreateAndAttachTexture(AttachmentType targetAttachmentType,
@@ -102,14 +135,12 @@ namespace PhysiCam
 
 	 void Framebuffer::BindWrite()
 	{
-		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_FBO);
-		if (m_BoundAttachmentTypes.size() > 0)
-			glDrawBuffers(m_BoundAttachmentTypes.size(), (GLenum*)&m_BoundAttachmentTypes[0]);
-		glViewport(0, 0, m_Size.x, m_Size.y);
+		GLState::BindFramebuffer(GL_DRAW_FRAMEBUFFER, m_FBO);
+		GLState::Viewport(0, 0, m_Size.x, m_Size.y);
 	}
 
 	 void Framebuffer::BindRead()
 	{
-		glBindFramebuffer(GL_READ_FRAMEBUFFER, m_FBO);
+		GLState::BindFramebuffer(GL_READ_FRAMEBUFFER, m_FBO);
 	}
 }
\ No newline at end of file
@@ -0,0 +1,435 @@
+/*
+	PhysiCam - Physically based camera
+	Copyright (C) 2015 Frank Khnke
+
+	This file is part of PhysiCam.
+
+	This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License 
+	as published by the Free Software Foundation; either 
+	version 3 of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ *	@file GLState.cpp
+ */
+
+#include <physicam/GLState.h>
+
+#include <GL/glew.h>
+
+//marks a binding whose value is not known, the next bind always goes to GL
+#define PC_GL_STATE_UNKNOWN		0xFFFFFFFFu
+
+namespace PhysiCam
+{
+
+	GLState::State GLState::s_Current;
+	GLState::State GLState::s_Saved;
+	GLState::Queried GLState::s_Queried;
+	bool GLState::s_Tracking = false;
+	bool GLState::s_RestoreEnabled = true;
+
+	static const unsigned int s_BufferTargets[PC_GL_STATE_BUFFER_TARGETS] =
+	{
+		GL_UNIFORM_BUFFER, GL_SHADER_STORAGE_BUFFER, GL_PIXEL_PACK_BUFFER, GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, GL_DISPATCH_INDIRECT_BUFFER
+	};
+	static const unsigned int s_BufferBindings[PC_GL_STATE_BUFFER_TARGETS] =
+	{
+		GL_UNIFORM_BUFFER_BINDING, GL_SHADER_STORAGE_BUFFER_BINDING, GL_PIXEL_PACK_BUFFER_BINDING, GL_COPY_READ_BUFFER_BINDING,
+		GL_COPY_WRITE_BUFFER_BINDING, GL_DISPATCH_INDIRECT_BUFFER_BINDING
+	};
+
+	static_assert(PC_GL_STATE_TEXTURE_UNITS <= 32 && PC_GL_STATE_UNIFORM_BUFFERS <= 32 && PC_GL_STATE_STORAGE_BUFFERS <= 32 &&
+		PC_GL_STATE_IMAGE_UNITS <= 32, "GLState: the queried bindings are kept in 32 bit masks");
+
+
+	void GLState::Save()
+	{
+		s_Queried = {};
+		s_Tracking = true;
+		if (!s_RestoreEnabled)
+		{
+			s_Current.Program = PC_GL_STATE_UNKNOWN;
+			s_Current.ActiveUnit = PC_GL_STATE_UNKNOWN;
+			s_Current.DrawFramebuffer = PC_GL_STATE_UNKNOWN;
+			s_Current.ReadFramebuffer = PC_GL_STATE_UNKNOWN;
+			s_Current.Viewport[0] = s_Current.Viewport[1] = s_Current.Viewport[2] = s_Current.Viewport[3] = -1;
+			s_Current.VertexArray = PC_GL_STATE_UNKNOWN;
+			return;
+		}
+
+		//bound by every frame, everything else is queried on its first bind
+		GLint value;
+		glGetIntegerv(GL_CURRENT_PROGRAM, &value);
+		s_Saved.Program = value;
+		glGetIntegerv(GL_ACTIVE_TEXTURE, &value);
+		s_Saved.ActiveUnit = value - GL_TEXTURE0;
+		glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &value);
+		s_Saved.DrawFramebuffer = value;
+		glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &value);
+		s_Saved.ReadFramebuffer = value;
+		glGetIntegerv(GL_VIEWPORT, s_Saved.Viewport);
+		glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &value);
+		s_Saved.VertexArray = value;
+
+		s_Current = s_Saved;
+	}
+
+	void GLState::Restore()
+	{
+		if (!s_Tracking)
+			return;
+
+		if (s_RestoreEnabled)
+		{
+			//still filtered, only what postprocessing changed is rebound
+			UseProgram(s_Saved.Program);
+			for (unsigned int unit = 0; unit < PC_GL_STATE_TEXTURE_UNITS; unit++)
+			{
+				if (s_Queried.Textures & (1u << unit))
+					BindTexture(unit, s_Saved.Textures[unit]);
+				if (s_Queried.TextureArrays & (1u << unit))
+					BindTexture(unit, s_Saved.TextureArrays[unit], true);
+			}
+			ActiveTexture(s_Saved.ActiveUnit);
+			for (unsigned int unit = 0; unit < PC_GL_STATE_IMAGE_UNITS; unit++)
+			{
+				const ImageBinding &image = s_Saved.Images[unit];
+				if (s_Queried.Images & (1u << unit))
+					BindImageTexture(unit, image.Texture, image.Level, image.Layered, image.Layer, image.Access, image.Format);
+			}
+
+			//the indexed binds also set the generic binding, it is put back afterwards
+			for (unsigned int index = 0; index < PC_GL_STATE_UNIFORM_BUFFERS; index++)
+			{
+				const BufferRange &range = s_Saved.UniformBuffers[index];
+				if (s_Queried.UniformBuffers & (1u << index))
+					BindBufferRange(GL_UNIFORM_BUFFER, index, range.Buffer, range.Offset, range.Size);
+			}
+			for (unsigned int index = 0; index < PC_GL_STATE_STORAGE_BUFFERS; index++)
+			{
+				const BufferRange &range = s_Saved.StorageBuffers[index];
+				if (s_Queried.StorageBuffers & (1u << index))
+					BindBufferRange(GL_SHADER_STORAGE_BUFFER, index, range.Buffer, range.Offset, range.Size);
+			}
+			for (int target = 0; target < PC_GL_STATE_BUFFER_TARGETS; target++)
+			{
+				if (s_Queried.Buffers & (1u << target))
+					BindBuffer(s_BufferTargets[target], s_Saved.Buffers[target]);
+			}
+
+			BindFramebuffer(GL_DRAW_FRAMEBUFFER, s_Saved.DrawFramebuffer);
+			BindFramebuffer(GL_READ_FRAMEBUFFER, s_Saved.ReadFramebuffer);
+			Viewport(s_Saved.Viewport[0], s_Saved.Viewport[1], s_Saved.Viewport[2], s_Saved.Viewport[3]);
+			BindVertexArray(s_Saved.VertexArray);
+		}
+
+		s_Tracking = false;
+	}
+
+	int GLState::BufferTargetIndex(unsigned int target)
+	{
+		for (int i = 0; i < PC_GL_STATE_BUFFER_TARGETS; i++)
+		{
+			if (s_BufferTargets[i] == target)
+				return i;
+		}
+		return -1;
+	}
+
+	void GLState::QueryTexture(unsigned int unit, bool array)
+	{
+		uint32_t &queried = array ? s_Queried.TextureArrays : s_Queried.Textures;
+		if (queried & (1u << unit))
+			return;
+		queried |= 1u << unit;
+
+		unsigned int &saved = array ? s_Saved.TextureArrays[unit] : s_Saved.Textures[unit];
+		saved = PC_GL_STATE_UNKNOWN;
+		if (s_RestoreEnabled)
+		{
+			GLint value;
+			ActiveTexture(unit);
+			glGetIntegerv(array ? GL_TEXTURE_BINDING_2D_ARRAY : GL_TEXTURE_BINDING_2D, &value);
+			saved = value;
+		}
+		(array ? s_Current.TextureArrays[unit] : s_Current.Textures[unit]) = saved;
+	}
+
+	void GLState::QueryBuffer(int targetIndex)
+	{
+		if (s_Queried.Buffers & (1u << targetIndex))
+			return;
+		s_Queried.Buffers |= 1u << targetIndex;
+
+		s_Saved.Buffers[targetIndex] = PC_GL_STATE_UNKNOWN;
+		if (s_RestoreEnabled)
+		{
+			GLint value;
+			glGetIntegerv(s_BufferBindings[targetIndex], &value);
+			s_Saved.Buffers[targetIndex] = value;
+		}
+		s_Current.Buffers[targetIndex] = s_Saved.Buffers[targetIndex];
+	}
+
+	GLState::BufferRange* GLState::QueryIndexedBuffer(unsigned int target, unsigned int index)
+	{
+		bool uniform = target == GL_UNIFORM_BUFFER;
+		if ((!uniform && target != GL_SHADER_STORAGE_BUFFER) || index >= (uniform ? PC_GL_STATE_UNIFORM_BUFFERS : PC_GL_STATE_STORAGE_BUFFERS))
+			return nullptr;
+
+		uint32_t &queried = uniform ? s_Queried.UniformBuffers : s_Queried.StorageBuffers;
+		BufferRange &current = uniform ? s_Current.UniformBuffers[index] : s_Current.StorageBuffers[index];
+		if (queried & (1u << index))
+			return &current;
+		queried |= 1u << index;
+
+		BufferRange &saved = uniform ? s_Saved.UniformBuffers[index] : s_Saved.StorageBuffers[index];
+		saved.Buffer = PC_GL_STATE_UNKNOWN;
+		saved.Offset = saved.Size = 0;
+		if (s_RestoreEnabled)
+		{
+			GLint value;
+			GLint64 start, size;
+			glGetIntegeri_v(uniform ? GL_UNIFORM_BUFFER_BINDING : GL_SHADER_STORAGE_BUFFER_BINDING, index, &value);
+			glGetInteger64i_v(uniform ? GL_UNIFORM_BUFFER_START : GL_SHADER_STORAGE_BUFFER_START, index, &start);
+			glGetInteger64i_v(uniform ? GL_UNIFORM_BUFFER_SIZE : GL_SHADER_STORAGE_BUFFER_SIZE, index, &size);
+			saved.Buffer = value;
+			saved.Offset = (size_t)start;
+			saved.Size = (size_t)size;
+		}
+		current = saved;
+		return &current;
+	}
+
+	void GLState::QueryImage(unsigned int unit)
+	{
+		if (s_Queried.Images & (1u << unit))
+			return;
+		s_Queried.Images |= 1u << unit;
+
+		ImageBinding &saved = s_Saved.Images[unit];
+		saved = {};
+		saved.Texture = PC_GL_STATE_UNKNOWN;
+		if (s_RestoreEnabled)
+		{
+			GLint value;
+			GLboolean layered;
+			glGetIntegeri_v(GL_IMAGE_BINDING_NAME, unit, &value);
+			saved.Texture = value;
+			glGetIntegeri_v(GL_IMAGE_BINDING_LEVEL, unit, &saved.Level);
+			glGetBooleani_v(GL_IMAGE_BINDING_LAYERED, unit, &layered);
+			saved.Layered = layered == GL_TRUE;
+			glGetIntegeri_v(GL_IMAGE_BINDING_LAYER, unit, &saved.Layer);
+			glGetIntegeri_v(GL_IMAGE_BINDING_ACCESS, unit, &value);
+			saved.Access = value;
+			glGetIntegeri_v(GL_IMAGE_BINDING_FORMAT, unit, &value);
+			saved.Format = value;
+		}
+		s_Current.Images[unit] = saved;
+	}
+
+	void GLState::UseProgram(unsigned int program)
+	{
+		if (s_Tracking)
+		{
+			if (s_Current.Program == program)
+				return;
+			s_Current.Program = program;
+		}
+		glUseProgram(program);
+	}
+
+	void GLState::ActiveTexture(unsigned int unit)
+	{
+		if (s_Tracking)
+		{
+			if (s_Current.ActiveUnit == unit)
+				return;
+			s_Current.ActiveUnit = unit;
+		}
+		glActiveTexture(GL_TEXTURE0 + unit);
+	}
+
+	void GLState::BindTexture(unsigned int unit, unsigned int texture, bool array /*= false*/)
+	{
+		if (s_Tracking && unit < PC_GL_STATE_TEXTURE_UNITS)
+		{
+			QueryTexture(unit, array);
+			unsigned int &bound = array ? s_Current.TextureArrays[unit] : s_Current.Textures[unit];
+			if (bound == texture)
+				return;
+			bound = texture;
+		}
+		ActiveTexture(unit);
+		glBindTexture(array ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D, texture);
+	}
+
+	unsigned int GLState::BindTextureForUpdate(unsigned int texture, bool array /*= false*/)
+	{
+		//the cache knows the binding, so the texture can simply stay bound
+		if (s_Tracking)
+		{
+			BindTexture(s_Current.ActiveUnit != PC_GL_STATE_UNKNOWN ? s_Current.ActiveUnit : 0, texture, array);
+			return texture;
+		}
+
+		GLint boundTexture = 0;
+		glGetIntegerv(array ? GL_TEXTURE_BINDING_2D_ARRAY : GL_TEXTURE_BINDING_2D, &boundTexture);
+		glBindTexture(array ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D, texture);
+		return boundTexture;
+	}
+
+	void GLState::BindFramebuffer(unsigned int target, unsigned int framebuffer)
+	{
+		if (s_Tracking)
+		{
+			bool draw = target != GL_READ_FRAMEBUFFER;
+			bool read = target != GL_DRAW_FRAMEBUFFER;
+			if ((!draw || s_Current.DrawFramebuffer == framebuffer) && (!read || s_Current.ReadFramebuffer == framebuffer))
+				return;
+			if (draw)
+				s_Current.DrawFramebuffer = framebuffer;
+			if (read)
+				s_Current.ReadFramebuffer = framebuffer;
+		}
+		glBindFramebuffer(target, framebuffer);
+	}
+
+	void GLState::Viewport(int x, int y, int width, int height)
+	{
+		if (s_Tracking)
+		{
+			int *v = s_Current.Viewport;
+			if (v[0] == x && v[1] == y && v[2] == width && v[3] == height)
+				return;
+			v[0] = x; v[1] = y; v[2] = width; v[3] = height;
+		}
+		glViewport(x, y, width, height);
+	}
+
+	void GLState::BindVertexArray(unsigned int vertexArray)
+	{
+		if (s_Tracking)
+		{
+			if (s_Current.VertexArray == vertexArray)
+				return;
+			s_Current.VertexArray = vertexArray;
+		}
+		glBindVertexArray(vertexArray);
+	}
+
+	void GLState::BindBuffer(unsigned int target, unsigned int buffer)
+	{
+		int targetIndex = s_Tracking ? BufferTargetIndex(target) : -1;
+		if (targetIndex >= 0)
+		{
+			QueryBuffer(targetIndex);
+			if (s_Current.Buffers[targetIndex] == buffer)
+				return;
+			s_Current.Buffers[targetIndex] = buffer;
+		}
+		glBindBuffer(target, buffer);
+	}
+
+	void GLState::BindBufferRange(unsigned int target, unsigned int index, unsigned int buffer, size_t offset /*= 0*/, size_t size /*= 0*/)
+	{
+		if (s_Tracking)
+		{
+			//the generic binding is queried before GL changes it
+			int targetIndex = BufferTargetIndex(target);
+			if (targetIndex >= 0)
+			{
+				QueryBuffer(targetIndex);
+				s_Current.Buffers[targetIndex] = buffer;
+			}
+
+			BufferRange *bound = QueryIndexedBuffer(target, index);
+			if (bound)
+			{
+				if (bound->Buffer == buffer && bound->Offset == offset && bound->Size == size)
+					return;
+				bound->Buffer = buffer;
+				bound->Offset = offset;
+				bound->Size = size;
+			}
+		}
+
+		if (size == 0 || buffer == 0)
+			glBindBufferBase(target, index, buffer);
+		else
+			glBindBufferRange(target, index, buffer, offset, size);
+	}
+
+	void GLState::BindImageTexture(unsigned int unit, unsigned int texture, int level, bool layered, int layer, unsigned int access, unsigned int format)
+	{
+		if (s_Tracking && unit < PC_GL_STATE_IMAGE_UNITS)
+		{
+			QueryImage(unit);
+			ImageBinding &bound = s_Current.Images[unit];
+			if (bound.Texture == texture && bound.Level == level && bound.Layered == layered && bound.Layer == layer &&
+				bound.Access == access && bound.Format == format)
+				return;
+			bound.Texture = texture;
+			bound.Level = level;
+			bound.Layered = layered;
+			bound.Layer = layer;
+			bound.Access = access;
+			bound.Format = format;
+		}
+		glBindImageTexture(unit, texture, level, layered ? GL_TRUE : GL_FALSE, layer, access, format);
+	}
+
+	void GLState::TextureDeleted(unsigned int texture)
+	{
+		for (unsigned int unit = 0; unit < PC_GL_STATE_TEXTURE_UNITS; unit++)
+		{
+			if (s_Current.Textures[unit] == texture)
+				s_Current.Textures[unit] = 0;
+			if (s_Current.TextureArrays[unit] == texture)
+				s_Current.TextureArrays[unit] = 0;
+		}
+		for (unsigned int unit = 0; unit < PC_GL_STATE_IMAGE_UNITS; unit++)
+		{
+			if (s_Current.Images[unit].Texture == texture)
+				s_Current.Images[unit].Texture = 0;
+		}
+	}
+
+	void GLState::FramebufferDeleted(unsigned int framebuffer)
+	{
+		if (s_Current.DrawFramebuffer == framebuffer)
+			s_Current.DrawFramebuffer = 0;
+		if (s_Current.ReadFramebuffer == framebuffer)
+			s_Current.ReadFramebuffer = 0;
+	}
+
+	void GLState::BufferDeleted(unsigned int buffer)
+	{
+		for (int target = 0; target < PC_GL_STATE_BUFFER_TARGETS; target++)
+		{
+			if (s_Current.Buffers[target] == buffer)
+				s_Current.Buffers[target] = 0;
+		}
+		for (unsigned int index = 0; index < PC_GL_STATE_UNIFORM_BUFFERS; index++)
+		{
+			if (s_Current.UniformBuffers[index].Buffer == buffer)
+				s_Current.UniformBuffers[index] = {};
+		}
+		for (unsigned int index = 0; index < PC_GL_STATE_STORAGE_BUFFERS; index++)
+		{
+			if (s_Current.StorageBuffers[index].Buffer == buffer)
+				s_Current.StorageBuffers[index] = {};
+		}
+	}
+
+}
@@ -0,0 +1,217 @@
+/*
+	PhysiCam - Physically based camera
+	Copyright (C) 2015 Frank Khnke
+
+	This file is part of PhysiCam.
+
+	This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License 
+	as published by the Free Software Foundation; either 
+	version 3 of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ *	@file GPUProfiler.cpp
+ */
+
+#include <physicam/GPUProfiler.h>
+#include <physicam/physicam_gl.h>
+
+#include <GL/glew.h>
+#include <algorithm>
+#include <cstring>
+
+namespace PhysiCam
+{
+
+	GPUProfiler::GPUProfiler() : m_Initialized(false), m_Frame(0), m_ScopeOpen(false), m_ResolvedFrame(0), m_FrameTime(0.0f)
+	{
+		for (auto &frame : m_Frames)
+		{
+			frame.ScopeCount = 0;
+			frame.Pending = false;
+		}
+	}
+
+	GPUProfiler::~GPUProfiler()
+	{
+	}
+
+	void GPUProfiler::Init()
+	{
+		if (!GL::HasTimerQuery || m_Initialized)
+			return;
+
+		for (auto &frame : m_Frames)
+			glGenQueries(PC_GPU_PROFILER_MAX_SCOPES * 2, frame.Queries);
+		m_Initialized = true;
+	}
+
+	void GPUProfiler::Delete()
+	{
+		if (!m_Initialized)
+			return;
+
+		for (auto &frame : m_Frames)
+			glDeleteQueries(PC_GPU_PROFILER_MAX_SCOPES * 2, frame.Queries);
+		m_Initialized = false;
+	}
+
+	void GPUProfiler::Begin(const char* name)
+	{
+		FrameQueries &frame = m_Frames[m_Frame % PC_GPU_PROFILER_FRAMES];
+		if (!m_Initialized || m_ScopeOpen || frame.ScopeCount >= PC_GPU_PROFILER_MAX_SCOPES)
+			return;
+
+		Scope &scope = frame.Scopes[frame.ScopeCount];
+		scope.Name = name;
+		scope.Occurrence = 0;
+		for (int i = 0; i < frame.ScopeCount; i++)
+		{
+			if (strcmp(frame.Scopes[i].Name, name) == 0)
+				scope.Occurrence++;
+		}
+
+		glQueryCounter(frame.Queries[frame.ScopeCount * 2], GL_TIMESTAMP);
+		m_ScopeOpen = true;
+	}
+
+	void GPUProfiler::End()
+	{
+		if (!m_ScopeOpen)
+			return;
+
+		FrameQueries &frame = m_Frames[m_Frame % PC_GPU_PROFILER_FRAMES];
+		glQueryCounter(frame.Queries[frame.ScopeCount * 2 + 1], GL_TIMESTAMP);
+		frame.ScopeCount++;
+		m_ScopeOpen = false;
+	}
+
+	void GPUProfiler::EndFrame()
+	{
+		End();
+
+		FrameQueries &frame = m_Frames[m_Frame % PC_GPU_PROFILER_FRAMES];
+		frame.Pending = frame.ScopeCount > 0;
+		m_Frame++;
+
+		//the queries of the oldest frame are reused next, results which did not arrive in time are dropped
+		FrameQueries &oldest = m_Frames[m_Frame % PC_GPU_PROFILER_FRAMES];
+		if (oldest.Pending)
+		{
+			Resolve(oldest);
+			oldest.Pending = false;
+			oldest.ScopeCount = 0;
+		}
+	}
+
+	void GPUProfiler::Reset()
+	{
+		End();
+
+		for (auto &frame : m_Frames)
+		{
+			frame.ScopeCount = 0;
+			frame.Pending = false;
+		}
+		m_History.clear();
+		m_FrameTime = 0.0f;
+	}
+
+	void GPUProfiler::Resolve(FrameQueries& frame)
+	{
+		//timestamps complete in order, the last one being available means all are
+		GLint available = 0;
+		glGetQueryObjectiv(frame.Queries[frame.ScopeCount * 2 - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			return;
+
+		GLuint64 first = 0, last = 0;
+		for (int i = 0; i < frame.ScopeCount; i++)
+		{
+			GLuint64 begin, end;
+			glGetQueryObjectui64v(frame.Queries[i * 2], GL_QUERY_RESULT, &begin);
+			glGetQueryObjectui64v(frame.Queries[i * 2 + 1], GL_QUERY_RESULT, &end);
+			if (i == 0)
+				first = begin;
+			last = end;
+
+			History &history = GetHistory(frame.Scopes[i]);
+			history.Samples[history.Next] = (end - begin) * 1e-6f;
+			history.Next = (history.Next + 1) % PC_GPU_PROFILER_HISTORY;
+			history.Count = std::min(history.Count + 1, PC_GPU_PROFILER_HISTORY);
+			history.LastFrame = m_Frame;
+			history.Order = i;
+		}
+
+		float frameTime = (last - first) * 1e-6f;
+		m_FrameTime = m_FrameTime > 0.0f ? m_FrameTime + (frameTime - m_FrameTime) * 0.1f : frameTime;
+		m_ResolvedFrame = m_Frame;
+	}
+
+	GPUProfiler::History& GPUProfiler::GetHistory(const Scope& scope)
+	{
+		for (auto &history : m_History)
+		{
+			if (history.Occurrence == scope.Occurrence && strcmp(history.Name, scope.Name) == 0)
+				return history;
+		}
+
+		History history;
+		history.Name = scope.Name;
+		history.Occurrence = scope.Occurrence;
+		history.Count = 0;
+		history.Next = 0;
+		history.LastFrame = 0;
+		history.Order = 0;
+		m_History.push_back(history);
+		return m_History.back();
+	}
+
+	PassTimings GPUProfiler::GetTimings() const
+	{
+		PassTimings timings;
+		timings.FrameTime = m_FrameTime;
+
+		//only the scopes of the latest resolved frame, disabled effects drop out
+		std::vector<const History*> current;
+		for (auto &history : m_History)
+		{
+			if (history.LastFrame == m_ResolvedFrame && history.Count > 0)
+				current.push_back(&history);
+		}
+		std::sort(current.begin(), current.end(), [](const History* a, const History* b) { return a->Order < b->Order; });
+
+		std::vector<float> sorted;
+		for (const History *history : current)
+		{
+			sorted.assign(history->Samples, history->Samples + history->Count);
+			std::sort(sorted.begin(), sorted.end());
+
+			PassTiming timing;
+			timing.Name = history->Name;
+			if (history->Occurrence > 0)
+				timing.Name += " #" + std::to_string(history->Occurrence);
+			timing.Last = history->Samples[(history->Next + PC_GPU_PROFILER_HISTORY - 1) % PC_GPU_PROFILER_HISTORY];
+			timing.Average = 0.0f;
+			for (float sample : sorted)
+				timing.Average += sample;
+			timing.Average /= sorted.size();
+			timing.Median = sorted[sorted.size() / 2];
+			timing.Percentile95 = sorted[std::min(sorted.size() - 1, sorted.size() * 95 / 100)];
+			timing.Max = sorted.back();
+			timing.Samples = history->Count;
+			timings.Passes.push_back(timing);
+		}
+		return timings;
+	}
+
+}
@@ -28,33 +28,157 @@
 #include <physicam/Face.h>
 #include <physicam/ShaderCode.h>
 #include <physicam/RenderTexture.h>
+#include <physicam/physicam_gl.h>
+#include <physicam/GLState.h>
 
 #include <GL/glew.h>
 
 namespace PhysiCam
 {
-	RenderTexturePtr LensDistColorTexture;
-	RenderTexturePtr LensDistDepthTexture;
-	RenderTexturePtr bloomBrightnessTexture;
-	RenderTexturePtr bloomLenseFlareBrightnessTexture;
-	RenderTexturePtr sceneTextures[2];
-	RenderTexturePtr downSampleTexture;
-	RenderTexturePtr bloomTextureHor[5];
-	RenderTexturePtr bloomTextureVert[5];
-	RenderTexturePtr bloomOutputTex;
-	RenderTexturePtr lenseFlareTexture;
-
-	PostProcessor::PostProcessor(Camera *c) : m_Camera(c), m_BloomThreshold(1.0f), m_BloomEnabled(true), m_DirtTextureId(-1), 
-		m_DoFEnabled(true), m_ToneMappingMethod(TonemappingMethod::Filmic), m_DoFAberation(0.6f), m_DoFFocalDistance(3.0f), 
-		m_DoFAutofocus(true), m_DoFVignetting(true), m_DoFShowFocus(false), m_DoFMaxBlur(3.0f), m_LensDistortionAmount(0.1f),
-		m_MaxNoise(0.45f), m_MinNoise(0.015f)
-	{
-		InitFBOs();
-		InitQuadMesh();
-		InitShaders();
-		InitRenderTextures();
+	/*
+	* std140 mirrors of the per frame parameter blocks in ShaderCode.cpp, bools are 4 byte ints.
+	* Sizes are padded to 16 bytes so the bound range always covers the whole block.
+	*/
+	struct ExposureSettingsBlock
+	{
+		float Exposure;
+		int UseExposureBuffer;
+		float Padding[2];
+	};
+
+	struct ToneMappingBlock
+	{
+		glm::vec2 OutputSize;
+		float Timer;
+		float GrainAmount;
+		int TonemappingMethod;
+		float Padding[3];
+	};
+
+	struct LensBlock
+	{
+		glm::vec3 ChromaticDistortionVector;
+		float K;
+		glm::vec2 ScreenSize;
+		float HaloWidth;
+		float Padding;
+	};
+
+	struct BloomBlock
+	{
+		glm::vec4 Strengths[5]; //float array, 16 byte stride
+		float Threshold;
+		float LenseFlareThreshold;
+		float Intensity;
+		float Strength;
+		int HasDirtTexture;
+		float Padding[3];
+	};
+
+	struct DoFBlock
+	{
+		glm::vec2 ScreenSize;
+		glm::vec2 CameraClips;
+		float FocalDepth;
+		float FocalLength;
+		float FStop;
+		float CoC;
+		float Fringe;
+		float MaxBlur;
+		int Autofocus;
+		int Vignetting;
+		int ShowFocus;
+		int UseFocusBuffer;
+		float GatherScale;
+		float NoiseSeed;
+		int RingSamples;
+		float Padding[3];
+	};
+
+	struct MeteringBlock
+	{
+		glm::vec2 LogLuminanceRange;
+		glm::vec2 MeteringPoint;
+		glm::vec2 Percentiles;
+		glm::vec2 ApertureRange;
+		glm::vec2 IsoRange;
+		glm::vec2 ShutterRange;
+		glm::ivec2 GridSize;
+		int MeteringMode;
+		float SpotRadius;
+		float Aspect;
+		float HighlightBias;
+		float DeltaTime;
+		float AdaptionSpeed;
+		float ExposureCompensation;
+		float FocalLength;
+		float Padding[2];
+	};
+
+	struct AutofocusBlock
+	{
+		glm::vec4 Region;
+		int Levels;
+		int Mode;
+		float FocusSpeed;
+		float DeltaTime;
+	};
+
+	struct ReprojectionBlock
+	{
+		glm::mat4 Reprojection[PC_MAX_VIEWS];
+		int UseMotionVectors;
+		float Padding[3];
+	};
+
+	struct TAABlock
+	{
+		float Feedback;
+		int HistoryValid;
+		float Padding[2];
+	};
+
+	struct MotionBlurBlock
+	{
+		glm::vec2 CameraClips;
+		float VelocityScale;
+		float MaxRadius;
+		int SampleCount;
+		float Padding[3];
+	};
+
+	static_assert(sizeof(ExposureSettingsBlock) == 16 && sizeof(ToneMappingBlock) == 32 && sizeof(LensBlock) == 32 &&
+		sizeof(BloomBlock) == 112 && sizeof(DoFBlock) == 80 && sizeof(MeteringBlock) == 96 && sizeof(AutofocusBlock) == 32 &&
+		sizeof(ReprojectionBlock) == 272 && sizeof(TAABlock) == 16 && sizeof(MotionBlurBlock) == 32,
+		"uniform block mirrors do not match the std140 layout");
+	static_assert(sizeof(ReprojectionBlock) <= PC_UNIFORM_BLOCK_MAX_SIZE, "PC_UNIFORM_BLOCK_MAX_SIZE is too small");
+	static_assert(PC_MOTION_BLUR_BLOCK_BINDING < PC_GL_STATE_UNIFORM_BUFFERS, "GLState does not restore every uniform block binding");
+
+	PostProcessor::PostProcessor(Camera *c, PostProcessingContextPtr context) : m_Camera(c),
+		m_Context(context ? context : PostProcessingContext::Create()), m_Shaders(m_Context.get()), m_Layers(0), m_PassFusionEnabled(true),
+		m_PrecisionProfile(PrecisionProfile::Full32), m_Initialized(false), m_OutputOffset(0),
+		m_FrameGraph(&m_Context->GetRenderTargetPool()), m_GPUTimeBudget(0.0f), m_ResolutionScale(1.0f), m_MinResolutionScale(0.5f),
+		m_MaxResolutionScale(1.0f), m_ResolutionCooldown(0), m_Exposure(1.0f), m_OutputFramebufferId(0), m_GrainTimer(0.0f),
+		m_GrainSeed(0.0f), m_GrainAnimated(true), m_LuminanceFrame(0), m_AverageLuminance(0.0f), m_LuminanceResolved(false), m_HistogramBuffer(0), m_ExposureBuffer(0),
+		m_ExposureOnGPU(false), m_MeteringLuminanceRange(-12.0f, 20.0f), m_LensDistortionAmount(0.1f), m_BloomEnabled(true),
+		m_BloomThreshold(1.0f), m_DirtTextureId(-1), m_ComputeBloomEnabled(true), m_BloomFilter(BloomFilter::IncrementalGaussian),
+		m_BloomKernelBuffer(0), m_BloomKernelsDirty(true), m_DoFEnabled(true), m_DoFAberation(0.6f), m_DoFMaxBlur(3.0f),
+		m_DoFFocalDistance(3.0f), m_DoFShowFocus(false), m_DoFTiled(true), m_DoFTileBuffer(0), m_DoFTileCapacity(0),
+		m_DoFAutofocusMode(AutofocusMode::SinglePoint), m_DoFAutofocusRegion(0.45f, 0.45f, 0.55f, 0.55f), m_DoFFocusSpeed(4.0f),
+		m_FocusBuffer(0), m_FocusOnGPU(false), m_DoFVignetting(true), m_DoFAutofocus(true), m_MaxNoise(0.45f), m_MinNoise(0.015f),
+		m_TAAEnabled(false), m_TAAFeedback(0.9f), m_TAAFrame(0), m_TAAHistoryValid(false), m_TAAActive(false), m_MotionBlurEnabled(false),
+		m_MotionBlurActive(false), m_MotionVectors(0), m_ToneMappingMethod(TonemappingMethod::Filmic)
+	{
+		//a new context only submits the shaders, the FBOs and metering buffers follow in WaitUntilReady
+		//since the metering fallback needs to know if the compute shaders linked
+		InitLuminanceReadback();
+		InitBloomKernels();
+		InitDoFTileList();
+		InitAutofocus();
+		m_Profiler.Init();
+		m_FrameGraph.SetProfiler(&m_Profiler);
+		m_UniformRing.Init(PC_UNIFORM_BLOCKS_PER_FRAME, PC_UNIFORM_BLOCK_MAX_SIZE);
 
-#if USE_INCREMENTAL_GAUSS_BLUR
 		m_BloomSpreads[0] = 16.0f;
 		m_BloomSpreads[1] = 16.0f;
 		m_BloomSpreads[2] = 24.0f;
@@ -65,472 +189,1425 @@ namespace PhysiCam
 		m_BloomStrengths[2] = 1.0f;
 		m_BloomStrengths[3] = 1.0f;
 		m_BloomStrengths[4] = 1.0f;
-#else
-		m_BloomSpreads[0] = 1.0f;
-		m_BloomSpreads[1] = 4.0f;
-		m_BloomSpreads[2] = 8.0f;
-		m_BloomSpreads[3] = 16.0f;
-		m_BloomSpreads[4] = 32.0f;
-		m_BloomStrengths[0] = 0.2f;
-		m_BloomStrengths[1] = 0.3f;
-		m_BloomStrengths[2] = 0.5f;
-		m_BloomStrengths[3] = 0.6f;
-		m_BloomStrengths[4] = 0.8f;
-#endif
 		m_BloomIntensity = 0.5f;
 	}
 
 	PostProcessor::~PostProcessor()
 	{
-		glDeleteBuffers(1, &m_QuadVBO);
 		DeleteFBOs();
-		DeleteShaders();
 		DeleteRenderTextures();
+		DeleteLuminanceReadback();
+		DeleteMeteringBuffers();
+		DeleteBloomKernels();
+		DeleteDoFTileList();
+		DeleteAutofocus();
+		m_Profiler.Delete();
+		m_UniformRing.Delete();
+		m_Context->RemovePostProcessor(this);
 	}
 
 
-	void PostProcessor::RenderFullscreenQuad()
+	bool PostProcessor::IsReady()
 	{
-		glBindVertexArray(m_QuadVBO);
-		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+		if (m_Initialized)
+			return true;
+		if (!m_Shaders->IsReady())
+			return false;
+
+		WaitUntilReady();
+		return true;
 	}
 
-	void PostProcessor::InitQuadMesh()
+	void PostProcessor::WaitUntilReady()
 	{
-		VertexList vertices;
-		FaceList faces;
+		if (m_Initialized)
+			return;
 
-		Vertex v(glm::vec3(-1, -1, 0), glm::vec3(0, 0, 1), glm::vec2(0, 0)); vertices.push_back(v);
-		v = Vertex(glm::vec3(1, -1, 0), glm::vec3(0, 0, 1), glm::vec2(1, 0)); vertices.push_back(v);
-		v = Vertex(glm::vec3(1, 1, 0), glm::vec3(0, 0, 1), glm::vec2(1, 1)); vertices.push_back(v);
-		v = Vertex(glm::vec3(-1, 1, 0), glm::vec3(0, 0, 1), glm::vec2(0, 1)); vertices.push_back(v);
-		faces.push_back(Face(0, 1, 3));
-		faces.push_back(Face(1, 2, 3));
+		m_Shaders->WaitUntilReady();
+		m_Initialized = true;
 
-		//generate vertex buffer object
-		glGenVertexArrays(1, &m_QuadVBO);
-		glBindVertexArray(m_QuadVBO);
-		
-		// buffer for indices
-		glGenBuffers(1, &m_IndexBuffer);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_IndexBuffer);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(Face) * faces.size(), &faces[0], GL_STATIC_DRAW);
+		//these depend on which metering path is available
+		InitRenderTextures();
+		InitMeteringBuffers();
+	}
 
-		//buffer for vertices
-		glGenBuffers(1, &m_VertexBuffer);
-		glBindBuffer(GL_ARRAY_BUFFER, m_VertexBuffer);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * vertices.size(), &vertices[0], GL_STATIC_DRAW);
+	void PostProcessor::SetPrecisionProfile(PrecisionProfile profile)
+	{
+		if (profile == m_PrecisionProfile)
+			return;
 
-		//setup data locations
+		m_PrecisionProfile = profile;
+		m_Shaders->InitPrecisionShaders(profile);
+	}
 
-		// Positions (location = 0)
-		glEnableVertexAttribArray(PC_MODEL_VERTEX_LOCATION);
-		glVertexAttribPointer(PC_MODEL_VERTEX_LOCATION, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), 0);
+	bool PostProcessor::HasMotionBlur() const
+	{
+		return m_Shaders->m_ShaderMotionBlurVelocity != nullptr && m_Shaders->m_ShaderMotionBlurTileMax != nullptr &&
+			m_Shaders->m_ShaderMotionBlurNeighborMax != nullptr && m_Shaders->m_ShaderMotionBlurGather != nullptr;
+	}
+
+	void PostProcessor::SetLayerCount(int layers)
+	{
+		layers = glm::max(layers, 0);
+		if (layers == m_Layers)
+			return;
+
+		m_Layers = layers;
+		PostProcessingContext *shaders = layers > 0 ? m_Context->GetLayeredContext() : m_Context.get();
+		if (shaders == m_Shaders)
+			return;
+
+		//the metering buffers depend on which shaders of the set linked, they are created again by WaitUntilReady
+		m_Shaders = shaders;
+		m_Shaders->InitPrecisionShaders(m_PrecisionProfile);
+		if (m_Initialized)
+		{
+			DeleteRenderTextures();
+			DeleteMeteringBuffers();
+			m_Initialized = false;
+		}
+	}
 
-		//Normals (location = 1)
-		glEnableVertexAttribArray(PC_MODEL_NORMAL_LOCATION);
-		glVertexAttribPointer(PC_MODEL_NORMAL_LOCATION, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)sizeof(glm::vec3));
+	RenderTexture::Format PostProcessor::GetColorFormat() const
+	{
+		switch (m_PrecisionProfile)
+		{
+		case PrecisionProfile::Half16:
+			return RenderTexture::RGBA16F;
+		case PrecisionProfile::Packed11_11_10:
+			return RenderTexture::R11F_G11F_B10F;
+		default:
+			return RenderTexture::RGB32F;
+		}
+	}
 
-		//texcoords (location = 2)
-		glEnableVertexAttribArray(PC_MODEL_TEXCOORD_LOCATION);
-		glVertexAttribPointer(PC_MODEL_TEXCOORD_LOCATION, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(sizeof(glm::vec3) * 2));
+	RenderTexture::Format PostProcessor::GetImageFormat() const
+	{
+		//image load/store has no three channel formats
+		return m_PrecisionProfile == PrecisionProfile::Full32 ? RenderTexture::RGBA32F : GetColorFormat();
+	}
 
-		//vertexColor (location = 3)
-		glEnableVertexAttribArray(PC_MODEL_VERTEX_COLOR_LOCATION);
-		glVertexAttribPointer(PC_MODEL_VERTEX_COLOR_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(sizeof(glm::vec3) * 2 + sizeof(glm::vec2)));
+	RenderTexture::Format PostProcessor::GetDepthFormat() const
+	{
+		return m_PrecisionProfile == PrecisionProfile::Full32 ? RenderTexture::R32F : RenderTexture::R16F;
+	}
 
-		// unbind buffers
-		glBindVertexArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	RenderTexture::Format PostProcessor::GetCoCFormat() const
+	{
+		return m_PrecisionProfile == PrecisionProfile::Full32 ? RenderTexture::RG32F : RenderTexture::RG16F;
 	}
 
-	void PostProcessor::InitShaders()
+	RenderTexture::Format PostProcessor::GetDoFGatherFormat() const
 	{
-		m_ShaderBlitScreen = Shader::Create(ScreenAlignedVertSrc, BlitScreenSrc);
-		m_ShaderDownsample = Shader::Create(ScreenAlignedVertSrc, DownsampleScreenSrc);
-		m_ShaderLensDistortion = Shader::Create(ScreenAlignedVertSrc, LensDistortionSrc);
-		m_ShaderBrightPass = Shader::Create(ScreenAlignedVertSrc, BrightPassSrc);
-		m_ShaderHorizontalBlur = Shader::Create(ScreenAlignedVertSrc, BlurHorizontalSrc);
-		m_ShaderVerticalBlur = Shader::Create(ScreenAlignedVertSrc, BlurVerticalSrc);
-		m_ShaderIncrementalGaussBlur = Shader::Create(ScreenAlignedVertSrc, IncrGaussBlurSrc);
-		m_ShaderBloomCompose = Shader::Create(ScreenAlignedVertSrc, BloomComposeSrc);
-		m_ShaderLenseFlare = Shader::Create(ScreenAlignedVertSrc, LenseFlareSrc);
-		m_ShaderLenseBloomCompose = Shader::Create(ScreenAlignedVertSrc, BloomLenseComposeSrc);
-		m_ShaderToneMapping = Shader::Create(ScreenAlignedVertSrc, ToneMapperSrc);
-		m_DoFShader = Shader::Create(ScreenAlignedVertSrc, DoFSrc);
+		//the gather stores linear depth in alpha, so the packed format is no option
+		return m_PrecisionProfile == PrecisionProfile::Full32 ? RenderTexture::RGBA32F : RenderTexture::RGBA16F;
 	}
-	void PostProcessor::DeleteShaders()
+
+	void PostProcessor::BindTextureId(unsigned int slot, unsigned int textureId)
 	{
-// 		DelPtr(m_ShaderBlitScreen);
-// 		DelPtr(m_ShaderDownsample);
-// 		DelPtr(m_ShaderBrightpass);
-// 		DelPtr(m_ShaderHorizontalBlur);
-// 		DelPtr(m_ShaderVerticalBlur);
-// 		DelPtr(m_ShaderBloomCompose);
-// 		DelPtr(m_ShaderLenseFlare);
+		GLState::BindTexture(slot, textureId, m_Layers > 0);
+	}
+
+	void PostProcessor::BindImageTexture(unsigned int textureId, int level, RenderTexture::Format format)
+	{
+		GLState::BindImageTexture(0, textureId, level, m_Layers > 0, 0, GL_WRITE_ONLY, format);
+	}
+
+	void PostProcessor::InitRenderTextures()
+	{
+		//only needed for mipmap based metering, the frame graph gets everything else from the pool per frame
+		if (!m_Initialized || HasGPUMetering())
+			return;
+
+		glm::ivec2 size = glm::max(m_Camera->m_ScreenSize / 2, glm::ivec2(1));
+		int levels = (int)glm::floor(glm::log2((float)glm::max(size.x, size.y))) + 1;
+		RenderTargetPool &pool = m_Context->GetRenderTargetPool();
+		m_DownSampleTexture = pool.Acquire(RenderTargetDesc(size, RenderTexture::RGB32F, levels));
+		m_DownSampleFBO = pool.GetFramebuffer(&m_DownSampleTexture, 1);
+	}
+
+	void PostProcessor::DeleteRenderTextures()
+	{
+		m_Context->GetRenderTargetPool().Release(m_DownSampleTexture);
+		m_DownSampleTexture.reset();
+		m_DownSampleFBO.reset();
+		DeleteTAAHistory();
+	}
+
+	void PostProcessor::DeleteTAAHistory()
+	{
+		RenderTargetPool &pool = m_Context->GetRenderTargetPool();
+		for (auto &history : m_TAAHistory)
+		{
+			pool.Release(history);
+			history.reset();
+		}
+		m_TAAHistoryValid = false;
+	}
+
+	void PostProcessor::UpdateScreenSize()
+	{
+		//the pool is kept, targets of the old size expire lazily and the ones that keep their size are reused
+		DeleteRenderTextures();
+		InitRenderTextures();
+	}
+
+	void PostProcessor::Render(float exposure, PhysiCamFBOInputDesc inputFBODesc, unsigned int outputFramebufferId)
+	{
+		WaitUntilReady();
+
+		auto scrSize = m_Camera->m_ScreenSize;
+		m_Exposure = exposure;
+		m_OutputFramebufferId = outputFramebufferId;
+		if (m_GrainAnimated)
+			m_GrainTimer += m_Camera->DeltaTime()*0.001f;
+		UpdateResolutionScale();
+
+		FrameGraph &fg = m_FrameGraph;
+		fg.Reset();
+
+		FrameGraphResource sceneColor = fg.ImportTexture("SceneColor", inputFBODesc.ColorTextureId, scrSize);
+		FrameGraphResource sceneDepth = fg.ImportTexture("SceneDepth", inputFBODesc.depthBufferId, scrSize);
+
+		//with pass fusion exposure is applied by the lense distortion pass and tonemapping by the last effect pass,
+		//which then renders straight to the output framebuffer
+		bool fuse = m_PassFusionEnabled && HasPassFusion();
+		unsigned int outputStages = m_ToneMappingEnabled ? FusedToneMapping : 0;
+		//TAA blends before tonemapping, so no effect pass renders to the output then
+		m_TAAActive = m_TAAEnabled && HasTAA();
+		if (!m_TAAActive && m_TAAHistory[0])
+			DeleteTAAHistory();
+		bool fuseOutput = fuse && !m_TAAActive;
+		m_MotionBlurActive = m_MotionBlurEnabled && HasMotionBlur();
+
+		//first apply lense distortion using the camera settings
+		bool toOutput = fuseOutput && !m_MotionBlurActive && !m_BloomEnabled && !m_DoFEnabled;
+		unsigned int stages = fuse ? FusedExposure | (toOutput ? outputStages : 0) : 0;
+		//without fusion this target holds the scene before exposure, which exceeds the range of the reduced formats
+		RenderTexture::Format lensFormat = fuse ? GetColorFormat() : RenderTexture::RGB32F;
+		FrameGraphResource lensColor = toOutput ? -1 : fg.CreateTexture("LensDistortionColor", GetTargetDesc(scrSize, lensFormat));
+		//since we dont do depth testing here, DEPTH_ATTACHMENT wont work. we just use a r32F texture
+		FrameGraphResource lensDepth = fg.CreateTexture("LensDistortionDepth", GetTargetDesc(scrSize, GetDepthFormat()));
+		int pass = fg.AddPass("LensDistortion", [=](FrameGraph &g) {
+			BindPassOutput(g, toOutput);
+			ApplyLenseDistortion(g.GetTextureId(sceneColor), g.GetTextureId(sceneDepth), stages);
+		});
+		fg.Read(pass, sceneColor);
+		fg.Read(pass, sceneDepth);
+		if (toOutput)
+			fg.SetSideEffect(pass);
+		else
+			fg.Write(pass, lensColor);
+		if (m_DoFEnabled || m_TAAActive || m_MotionBlurActive)
+			fg.Write(pass, lensDepth);
+
+		FrameGraphResource scene = lensColor;
+		if (!fuse)
+		{
+			scene = fg.CreateTexture("Exposure", GetTargetDesc(scrSize, GetColorFormat()));
+			pass = fg.AddPass("Exposure", [=](FrameGraph &g) {
+				g.BindRenderTargets();
+				ApplyLuminance(g.GetTextureId(lensColor));
+			});
+			fg.Read(pass, lensColor);
+			fg.Write(pass, scene);
+		}
+
+		//blur the motion during the exposure before anything spreads the highlights
+		if (m_MotionBlurActive)
+			scene = AddMotionBlurPasses(scene, lensDepth);
+
+		//apply bloom if enabled
+		if (m_BloomEnabled)
+		{
+			toOutput = fuseOutput && !m_DoFEnabled;
+			scene = AddBloomPasses(scene, toOutput ? outputStages : 0, toOutput);
+		}
+
+		//the focus distance is picked once per frame instead of in every DoF fragment
+		m_FocusOnGPU = m_DoFEnabled && m_DoFAutofocus && HasGPUAutofocus();
+		if (m_FocusOnGPU)
+			AddAutofocusPasses(lensDepth);
+
+		if (m_DoFEnabled && m_DoFTiled && HasTiledDoF())
+		{
+			toOutput = fuseOutput;
+			scene = AddTiledDoFPasses(scene, lensDepth, toOutput ? outputStages : 0, toOutput);
+		}
+		else if (m_DoFEnabled)
+		{
+			toOutput = fuseOutput;
+			stages = toOutput ? outputStages : 0;
+			FrameGraphResource dof = toOutput ? -1 : fg.CreateTexture("DoF", GetTargetDesc(scrSize, GetColorFormat()));
+			pass = fg.AddPass("DoF", [=](FrameGraph &g) {
+				BindPassOutput(g, toOutput);
+				ApplyDoF(g.GetTextureId(scene), g.GetTextureId(lensDepth), stages);
+			});
+			fg.Read(pass, scene);
+			fg.Read(pass, lensDepth);
+			if (toOutput)
+				fg.SetSideEffect(pass);
+			else
+				fg.Write(pass, dof);
+			scene = dof;
+		}
+
+		if (m_TAAActive)
+			scene = AddTAAPass(scene, lensDepth);
+
+		//final pass writes to the output framebuffer unless the last effect did, everything it does not depend on gets culled
+		if (!toOutput)
+		{
+			pass = fg.AddPass("Output", [=](FrameGraph &g) {
+				if (m_ToneMappingEnabled)
+				{
+					ApplyToneMapping(g.GetTextureId(scene), outputFramebufferId);
+					return;
+				}
+
+				//blit final image to output, the exposure was applied already
+				ExposureSettingsBlock identity = {};
+				identity.Exposure = 1.0f;
+				identity.UseExposureBuffer = false;
+				PushUniformBlock(PC_EXPOSURE_SETTINGS_BLOCK_BINDING, identity);
+				BindTextureId(0, g.GetTextureId(scene));
+				BindPassOutput(g, true);
+				m_Shaders->m_ShaderBlitScreen->Bind();
+				RenderFullscreenQuad();
+			});
+			fg.Read(pass, scene);
+			fg.SetSideEffect(pass);
+		}
+
+		UpdateUniformBlocks();
+		fg.Compile();
+		fg.Execute();
+		m_Profiler.EndFrame();
+		m_Context->EndFrame(this);
+		m_UniformRing.EndFrame();
+
+		//MeterExposure has to be called again for the next frame
+		m_ExposureOnGPU = false;
+		m_TAAHistoryValid = m_TAAActive;
 	}
 
+	void PostProcessor::BindPassOutput(FrameGraph &fg, bool toOutput)
+	{
+		if (!toOutput)
+		{
+			fg.BindRenderTargets();
+			return;
+		}
 
-	void PostProcessor::InitFBOs()
+		auto scrSize = m_Camera->m_ScreenSize;
+		GLState::BindFramebuffer(GL_FRAMEBUFFER, m_OutputFramebufferId);
+		GLState::Viewport(m_OutputOffset.x, m_OutputOffset.y, scrSize.x, scrSize.y);
+	}
+
+	FrameGraphResource PostProcessor::AddBloomPasses(FrameGraphResource input, unsigned int fusedStages, bool toOutput)
 	{
-		auto screenSize = m_Camera->m_ScreenSize;
-		m_LenseDistortionFBO = Framebuffer::Create(screenSize.x, screenSize.y);
-		m_SceneFBOs[0] = Framebuffer::Create(screenSize.x, screenSize.y);
-		m_SceneFBOs[1] = Framebuffer::Create(screenSize.x, screenSize.y);
+		FrameGraph &fg = m_FrameGraph;
+		auto scrSize = m_Camera->m_ScreenSize;
+		glm::ivec2 halfSize = GetScaledSize(0.5f);
+
+		//bright pass, the second target feeds the lense flare
+		RenderTexture::Format format = GetColorFormat();
+		FrameGraphResource bright = fg.CreateTexture("BloomBrightness", GetTargetDesc(halfSize, format));
+		FrameGraphResource flareBright = fg.CreateTexture("LenseFlareBrightness", GetTargetDesc(halfSize,
+			m_PrecisionProfile == PrecisionProfile::Full32 ? RenderTexture::RGB16F : format));
+		int pass = fg.AddPass("BrightPass", [=](FrameGraph &g) {
+			g.BindRenderTargets();
+			ApplyBrightPass(g.GetTextureId(input));
+		});
+		fg.Read(pass, input);
+		fg.Write(pass, bright);
+		fg.Write(pass, flareBright);
+
+		//the dual filter chain composes the levels while it upsamples
+		FrameGraphResource bloom;
+		if (m_BloomFilter == BloomFilter::DualKawase)
+			bloom = AddDualKawaseBloomPasses(bright);
+		else
+			bloom = AddGaussianBloomPasses(bright);
 
-		m_BrightnessPassFBO = Framebuffer::Create(screenSize.x*0.5f, screenSize.y*0.5f);
+		// ** Apply lenseflare **
+		FrameGraphResource flare = -1;
+#if USE_LENSE_FLARE
+		flare = fg.CreateTexture("LenseFlare", GetTargetDesc(halfSize, format));
+		pass = fg.AddPass("LenseFlare", [=](FrameGraph &g) {
+			g.BindRenderTargets();
+			BindTextureId(0, g.GetTextureId(flareBright));
+			m_Shaders->m_ShaderLenseFlare->Bind();
+			RenderFullscreenQuad();
+		});
+		fg.Read(pass, flareBright);
+		fg.Write(pass, flare);
+#endif
 
-		m_DownSampleFBO = Framebuffer::Create(screenSize.x*0.5f, screenSize.y*0.5f);
+		// compose bloom and lenseflare
+		FrameGraphResource output = toOutput ? -1 : fg.CreateTexture("Bloom", GetTargetDesc(scrSize, format));
+		pass = fg.AddPass("LenseBloomCompose", [=](FrameGraph &g) {
+			BindPassOutput(g, toOutput);
+			ApplyLenseBloomCompose(g.GetTextureId(bloom), flare < 0 ? 0 : g.GetTextureId(flare), g.GetTextureId(input), fusedStages);
+		});
+		fg.Read(pass, bloom);
+		if (flare >= 0)
+			fg.Read(pass, flare);
+		fg.Read(pass, input);
+		if (toOutput)
+			fg.SetSideEffect(pass);
+		else
+			fg.Write(pass, output);
+
+		return output;
+	}
+
+	FrameGraphResource PostProcessor::AddGaussianBloomPasses(FrameGraphResource bright)
+	{
+		FrameGraph &fg = m_FrameGraph;
+		RenderTexture::Format format = GetColorFormat();
 
+		if (m_BloomFilter == BloomFilter::LinearGaussian && m_BloomKernelsDirty)
+			UpdateBloomKernels();
+
+		FrameGraphResource blurred[5];
+		FrameGraphResource inp = bright;
 		float size = 0.5f;
 		for (int i = 0; i < 5; i++)
 		{
-			m_BloomhorFBOs[i] = Framebuffer::Create(screenSize.x*size, screenSize.y*size);
-			m_BloomvertFBOs[i] = Framebuffer::Create(screenSize.x*size, screenSize.y*size);
+			//image stores need a four channel format
+			bool compute = m_BloomFilter == BloomFilter::IncrementalGaussian && m_ComputeBloomEnabled && HasComputeBloom() &&
+				m_BloomSpreads[i] <= PC_BLOOM_COMPUTE_MAX_RADIUS;
+			RenderTargetDesc desc = GetTargetDesc(GetScaledSize(size), compute ? GetImageFormat() : format);
 			size *= 0.5f;
+
+			FrameGraphResource hor = fg.CreateTexture("BloomHorizontal", desc);
+			int pass = fg.AddPass("BloomBlurHorizontal", [=](FrameGraph &g) {
+				if (compute)
+				{
+					ApplyBloomBlurCompute(g.GetTextureId(inp), g.GetTextureId(hor), desc.Size, i, true);
+					return;
+				}
+				g.BindRenderTargets();
+				ApplyBloomBlur(g.GetTextureId(inp), desc.Size, i, true);
+			});
+			fg.Read(pass, inp);
+			fg.Write(pass, hor);
+
+			blurred[i] = fg.CreateTexture("BloomVertical", desc);
+			FrameGraphResource vert = blurred[i];
+			pass = fg.AddPass("BloomBlurVertical", [=](FrameGraph &g) {
+				if (compute)
+				{
+					ApplyBloomBlurCompute(g.GetTextureId(hor), g.GetTextureId(vert), desc.Size, i, false);
+					return;
+				}
+				g.BindRenderTargets();
+				ApplyBloomBlur(g.GetTextureId(hor), desc.Size, i, false);
+			});
+			fg.Read(pass, hor);
+			fg.Write(pass, blurred[i]);
+
+			inp = blurred[i];
 		}
-		m_BloomOutputFBO = Framebuffer::Create(screenSize.x*0.5f, screenSize.y*0.5f);
-		m_LenseFlareFBO = Framebuffer::Create(screenSize.x*0.5f, screenSize.y*0.5f);
 
+		//compose bloom passes
+		FrameGraphResource bloom = fg.CreateTexture("BloomCompose", GetTargetDesc(GetScaledSize(0.5f), format));
+		int pass = fg.AddPass("BloomCompose", [=](FrameGraph &g) {
+			g.BindRenderTargets();
+			for (int i = 0; i < 5; i++)
+				BindTextureId(i, g.GetTextureId(blurred[i]));
 
+			m_Shaders->m_ShaderBloomCompose->Bind();
+			RenderFullscreenQuad();
+		});
+		for (int i = 0; i < 5; i++)
+			fg.Read(pass, blurred[i]);
+		fg.Write(pass, bloom);
+		return bloom;
 	}
 
-	void PostProcessor::InitRenderTextures()
+	FrameGraphResource PostProcessor::AddDualKawaseBloomPasses(FrameGraphResource bright)
 	{
-		auto screenSize = m_Camera->m_ScreenSize;
-		
-		LensDistColorTexture = m_LenseDistortionFBO->CreateAndAttachTexture(Framebuffer::COLOR0, RenderTexture::TEXTURE_2D, RenderTexture::RGB32F);
-		LensDistDepthTexture = m_LenseDistortionFBO->CreateAndAttachTexture(Framebuffer::COLOR1, RenderTexture::TEXTURE_2D, RenderTexture::R32F); //since we dont do depth testing here, DEPTH_ATTACHMENT wont work. we just use a r32F texture
-		
-		downSampleTexture = m_DownSampleFBO->CreateAndAttachTexture(Framebuffer::COLOR0, RenderTexture::TEXTURE_2D, RenderTexture::RGB32F, true);
-		
-		bloomBrightnessTexture = m_BrightnessPassFBO->CreateAndAttachTexture(Framebuffer::COLOR1, RenderTexture::TEXTURE_2D, RenderTexture::RGB32F, false);
-		bloomLenseFlareBrightnessTexture = m_BrightnessPassFBO->CreateAndAttachTexture(Framebuffer::COLOR2, RenderTexture::TEXTURE_2D, RenderTexture::RGB16F, false);
-
-		sceneTextures[0] = m_SceneFBOs[0]->CreateAndAttachTexture(Framebuffer::COLOR0, RenderTexture::TEXTURE_2D, RenderTexture::RGB32F);
-		sceneTextures[1] = m_SceneFBOs[1]->CreateAndAttachTexture(Framebuffer::COLOR0, RenderTexture::TEXTURE_2D, RenderTexture::RGB32F);
-				
-		lenseFlareTexture = m_LenseFlareFBO->CreateAndAttachTexture(Framebuffer::COLOR0, RenderTexture::TEXTURE_2D, RenderTexture::RGB32F);
-		
+		FrameGraph &fg = m_FrameGraph;
+		RenderTexture::Format format = GetColorFormat();
+
+		//widths are compared as variances in texels of a level. a downsampled level carries about 0.25, the upsample into
+		//level j adds offset^2/3 (taps) + 2/3 (bilinear fetch from the coarser level) to its input, which doubles in width
+		static const float downVariance = 0.25f;
+		static const float maxOffset = 2.0f;
+
+		//variance of gaussian level i, it blurs the previous level (fetched as 2x2 box) with sigma = spread/8
+		float targets[5];
 		for (int i = 0; i < 5; i++)
 		{
-			bloomTextureHor[i] = m_BloomhorFBOs[i]->CreateAndAttachTexture(Framebuffer::COLOR0, RenderTexture::TEXTURE_2D, RenderTexture::RGB32F); 
-			bloomTextureVert[i] = m_BloomvertFBOs[i]->CreateAndAttachTexture(Framebuffer::COLOR0, RenderTexture::TEXTURE_2D, RenderTexture::RGB32F);	
+			float sigma = m_BloomSpreads[i] / 8.0f;
+			targets[i] = (i > 0 ? targets[i - 1] / 4.0f + 1.0f / 16.0f : 0.0f) + sigma * sigma;
 		}
 
-		bloomOutputTex = m_BloomOutputFBO->CreateAndAttachTexture(Framebuffer::COLOR0, RenderTexture::TEXTURE_2D, RenderTexture::RGB32F);
-	}
+		//the tap offset of the step into a bloom level is widened until a single down/up step is as wide as that level
+		float offsets[PC_BLOOM_DUAL_FILTER_LEVELS];
+		float stepVariances[PC_BLOOM_DUAL_FILTER_LEVELS];
+		for (int j = 0; j < PC_BLOOM_DUAL_FILTER_LEVELS; j++)
+		{
+			offsets[j] = j < 5 ? glm::clamp(glm::sqrt(glm::max(3.0f * (targets[j] - 4.0f * downVariance) - 2.0f, 0.0f)), 1.0f, maxOffset) : maxOffset;
+			stepVariances[j] = (offsets[j] * offsets[j] + 2.0f) / 3.0f;
+		}
 
-	void PostProcessor::DeleteRenderTextures()
-	{
-		downSampleTexture.reset();
-		sceneTextures[0].reset();
-		sceneTextures[1].reset();
+		//same sizes as the gaussian levels. a level a single texel high or wide averages the light the gaussians lose over
+		//the edges back into the image, it is only used when there is no other level below a bloom level
+		glm::ivec2 sizes[PC_BLOOM_DUAL_FILTER_LEVELS];
+		int levelCount = 0;
+		for (int i = 0; i < PC_BLOOM_DUAL_FILTER_LEVELS; i++)
+		{
+			sizes[i] = GetScaledSize(0.5f / (float)(1 << i));
+			if (glm::min(sizes[i].x, sizes[i].y) > 1)
+				levelCount = i + 1;
+		}
 
+		//every bloom level enters the upsample chain as the downsampled level k steps below its own, k is picked so the
+		//width (including the steps above the bloom level) matches the gaussian level, at least one down/up step.
+		//a width between two depths is split between both in log scale. the strengths and the intensity of the compose
+		//are folded into the weights, so the end of the chain is the composed bloom
+		float weights[PC_BLOOM_DUAL_FILTER_LEVELS] = { 0.0f };
+		int deepest = 1;
 		for (int i = 0; i < 5; i++)
 		{
-			bloomTextureHor[i].reset();
-			bloomTextureVert[i].reset();
+			float above = 0.0f;
+			for (int j = 0; j < i; j++)
+				above += stepVariances[j] / glm::pow(4.0f, (float)(i - j));
+
+			int k = 1;
+			float variance = stepVariances[i] + 4.0f * downVariance + above;
+			float deeper = variance;
+			while (i + k + 1 < levelCount)
+			{
+				//the chain is widened from below, the step into level i + k comes before the steps up to level i
+				float inner = downVariance;
+				for (int j = i + k; j >= i; j--)
+					inner = stepVariances[j] + 4.0f * inner;
+				deeper = inner + above;
+				if (deeper >= targets[i])
+					break;
+				k++;
+				variance = deeper;
+			}
+			float split = deeper > variance ? glm::clamp(glm::log(targets[i] / variance) / glm::log(deeper / variance), 0.0f, 1.0f) : 0.0f;
+			float weight = m_BloomStrengths[i] * m_BloomIntensity;
+			weights[i + k] += weight * (1.0f - split);
+			if (split > 0.0f)
+			{
+				weights[i + k + 1] += weight * split;
+				deepest = glm::max(deepest, i + k + 1);
+			}
+			else
+				deepest = glm::max(deepest, i + k);
 		}
+
+		//level i of the chain has the size of bloom level i, the bright pass is level 0
+		FrameGraphResource levels[PC_BLOOM_DUAL_FILTER_LEVELS];
+		levels[0] = bright;
+		for (int i = 1; i <= deepest; i++)
+		{
+			FrameGraphResource inp = levels[i - 1];
+			glm::ivec2 levelSize = sizes[i];
+			FrameGraphResource down = fg.CreateTexture("BloomDownsample", GetTargetDesc(levelSize, format));
+			int pass = fg.AddPass("BloomDownsample", [=](FrameGraph &g) {
+				g.BindRenderTargets();
+				ApplyDualKawaseDown(g.GetTextureId(inp), levelSize);
+			});
+			fg.Read(pass, inp);
+			fg.Write(pass, down);
+			levels[i] = down;
+		}
+
+		//one upsample chain from the deepest level up to the bright pass resolution, each step adds the weighted level below it
+		FrameGraphResource chain = -1;
+		for (int j = deepest - 1; j >= 0; j--)
+		{
+			FrameGraphResource level = levels[j + 1];
+			FrameGraphResource coarser = chain;
+			float levelWeight = weights[j + 1];
+			float offset = offsets[j];
+			glm::ivec2 levelSize = sizes[j];
+			FrameGraphResource up = fg.CreateTexture(j > 0 ? "BloomUpsample" : "BloomCompose", GetTargetDesc(levelSize, format));
+			int pass = fg.AddPass(j > 0 ? "BloomUpsample" : "BloomCompose", [=](FrameGraph &g) {
+				g.BindRenderTargets();
+				ApplyDualKawaseUp(levelWeight > 0.0f ? g.GetTextureId(level) : 0, levelWeight, coarser < 0 ? 0 : g.GetTextureId(coarser), levelSize, offset);
+			});
+			if (levelWeight > 0.0f)
+				fg.Read(pass, level);
+			if (coarser >= 0)
+				fg.Read(pass, coarser);
+			fg.Write(pass, up);
+			chain = up;
+		}
+		return chain;
 	}
 
-	void PostProcessor::UpdateScreenSize()
+	void PostProcessor::AddAutofocusPasses(FrameGraphResource depth)
 	{
-		DeleteRenderTextures();
-		InitRenderTextures();
+		FrameGraph &fg = m_FrameGraph;
+		glm::ivec2 size = glm::max(m_Camera->m_ScreenSize / 4, glm::ivec2(1));
+		int levels = (int)glm::floor(glm::log2((float)glm::max(size.x, size.y))) + 1;
+
+		FrameGraphResource pyramid = fg.CreateTexture("DepthPyramid", RenderTargetDesc(size, RenderTexture::RGBA32F, levels, m_Layers > 0 ? 1 : 0));
+		int pass = fg.AddPass("DepthPyramid", [=](FrameGraph &g) {
+			ApplyDepthPyramid(g.GetTextureId(depth), g.GetTextureId(pyramid), size, levels);
+		});
+		fg.Read(pass, depth);
+		fg.Write(pass, pyramid);
+
+		//writes m_FocusBuffer, which the graph does not track. it is declared before the DoF passes and never culled
+		pass = fg.AddPass("Autofocus", [=](FrameGraph &g) {
+			ApplyAutofocus(g.GetTextureId(pyramid), levels);
+		});
+		fg.Read(pass, pyramid);
+		fg.SetSideEffect(pass);
 	}
 
-	void PostProcessor::Render(float exposure, PhysiCamFBOInputDesc inputFBODesc, unsigned int outputFramebufferId)
+	FrameGraphResource PostProcessor::AddTiledDoFPasses(FrameGraphResource input, FrameGraphResource depth, unsigned int fusedStages, bool toOutput)
 	{
-		//first apply lense distortion using the camera settings
-		ApplyLenseDistortion(inputFBODesc.ColorTextureId, inputFBODesc.depthBufferId);
+		FrameGraph &fg = m_FrameGraph;
+		auto scrSize = m_Camera->m_ScreenSize;
+		glm::ivec2 tileCount = (scrSize + PC_DOF_TILE_SIZE - 1) / PC_DOF_TILE_SIZE;
+		ReserveDoFTileList(tileCount.x * tileCount.y * glm::max(m_Layers, 1));
+
+		//blur and linear depth, computed once instead of per gather sample
+		FrameGraphResource coc = fg.CreateTexture("DoFCoC", GetTargetDesc(scrSize, GetCoCFormat()));
+		int pass = fg.AddPass("DoFCoC", [=](FrameGraph &g) {
+			g.BindRenderTargets();
+			ApplyDoFCoC(g.GetTextureId(depth));
+		});
+		fg.Read(pass, depth);
+		fg.Write(pass, coc);
+
+		//the tile list in m_DoFTileBuffer is produced here as well, the gather reads the tile texture to keep the order
+		FrameGraphResource tiles = fg.CreateTexture("DoFTiles", GetTargetDesc(tileCount, RenderTexture::RG16F));
+		pass = fg.AddPass("DoFTileClassify", [=](FrameGraph &g) {
+			ApplyDoFTileClassify(g.GetTextureId(coc), g.GetTextureId(tiles), tileCount);
+		});
+		fg.Read(pass, coc);
+		fg.Write(pass, tiles);
+
+		FrameGraphResource gather = fg.CreateTexture("DoFGather", GetTargetDesc(GetScaledSize(0.5f), GetDoFGatherFormat()));
+		pass = fg.AddPass("DoFGather", [=](FrameGraph &g) {
+			ApplyDoFGather(g.GetTextureId(input), g.GetTextureId(coc), g.GetTextureId(gather));
+		});
+		fg.Read(pass, input);
+		fg.Read(pass, coc);
+		fg.Read(pass, tiles);
+		fg.Write(pass, gather);
+
+		FrameGraphResource output = toOutput ? -1 : fg.CreateTexture("DoF", GetTargetDesc(scrSize, GetColorFormat()));
+		pass = fg.AddPass("DoFComposite", [=](FrameGraph &g) {
+			BindPassOutput(g, toOutput);
+			ApplyDoFComposite(g.GetTextureId(input), g.GetTextureId(coc), g.GetTextureId(tiles), g.GetTextureId(gather), fusedStages, toOutput);
+		});
+		fg.Read(pass, input);
+		fg.Read(pass, coc);
+		fg.Read(pass, tiles);
+		fg.Read(pass, gather);
+		if (toOutput)
+			fg.SetSideEffect(pass);
+		else
+			fg.Write(pass, output);
+
+		return output;
+	}
 
-		ApplyLuminance(exposure, LensDistColorTexture->GetTextureId());
-		int indx = 0;
+	FrameGraphResource PostProcessor::AddMotionBlurPasses(FrameGraphResource input, FrameGraphResource depth)
+	{
+		FrameGraph &fg = m_FrameGraph;
+		auto scrSize = m_Camera->m_ScreenSize;
+		glm::ivec2 tileCount = (scrSize + PC_MOTION_BLUR_TILE_SIZE - 1) / PC_MOTION_BLUR_TILE_SIZE;
+
+		FrameGraphResource velocity = fg.CreateTexture("MotionBlurVelocity", GetTargetDesc(scrSize, RenderTexture::RG16F));
+		int pass = fg.AddPass("MotionBlurVelocity", [=](FrameGraph &g) {
+			g.BindRenderTargets();
+			ApplyMotionBlurVelocity(g.GetTextureId(depth));
+		});
+		fg.Read(pass, depth);
+		fg.Write(pass, velocity);
+
+		FrameGraphResource tileMax = fg.CreateTexture("MotionBlurTileMax", GetTargetDesc(tileCount, RenderTexture::RG16F));
+		pass = fg.AddPass("MotionBlurTileMax", [=](FrameGraph &g) {
+			g.BindRenderTargets();
+			ApplyMotionBlurTileMax(g.GetTextureId(velocity));
+		});
+		fg.Read(pass, velocity);
+		fg.Write(pass, tileMax);
+
+		FrameGraphResource neighborMax = fg.CreateTexture("MotionBlurNeighborMax", GetTargetDesc(tileCount, RenderTexture::RG16F));
+		pass = fg.AddPass("MotionBlurNeighborMax", [=](FrameGraph &g) {
+			g.BindRenderTargets();
+			ApplyMotionBlurNeighborMax(g.GetTextureId(tileMax));
+		});
+		fg.Read(pass, tileMax);
+		fg.Write(pass, neighborMax);
+
+		FrameGraphResource output = fg.CreateTexture("MotionBlur", GetTargetDesc(scrSize, GetColorFormat()));
+		pass = fg.AddPass("MotionBlur", [=](FrameGraph &g) {
+			g.BindRenderTargets();
+			ApplyMotionBlurGather(g.GetTextureId(input), g.GetTextureId(depth), g.GetTextureId(velocity), g.GetTextureId(neighborMax));
+		});
+		fg.Read(pass, input);
+		fg.Read(pass, depth);
+		fg.Read(pass, velocity);
+		fg.Read(pass, neighborMax);
+		fg.Write(pass, output);
+
+		return output;
+	}
 
-		//apply bloom if enabled
-		if (m_BloomEnabled)
+	FrameGraphResource PostProcessor::AddTAAPass(FrameGraphResource input, FrameGraphResource depth)
+	{
+		//the history has to survive the frame, so it is held instead of declared in the graph
+		RenderTargetDesc desc = GetTargetDesc(m_Camera->m_ScreenSize, GetColorFormat());
+		if (!m_TAAHistory[0] || !(m_TAAHistoryDesc == desc))
 		{
-			int t = (indx + 1) % 2;
-			ApplyBloom(sceneTextures[indx], m_SceneFBOs[t]->GetID());
-			indx = t;
+			DeleteTAAHistory();
+			RenderTargetPool &pool = m_Context->GetRenderTargetPool();
+			m_TAAHistory[0] = pool.Acquire(desc);
+			m_TAAHistory[1] = pool.Acquire(desc);
+			m_TAAHistoryDesc = desc;
 		}
 
-		if (m_DoFEnabled)
+		//this frame writes the target the last frame read from
+		m_TAAFrame++;
+		FrameGraph &fg = m_FrameGraph;
+		FrameGraphResource history = fg.ImportTexture("TAAHistory", m_TAAHistory[(m_TAAFrame + 1) % 2]);
+		FrameGraphResource output = fg.ImportTexture("TAA", m_TAAHistory[m_TAAFrame % 2]);
+		int pass = fg.AddPass("TAA", [=](FrameGraph &g) {
+			g.BindRenderTargets();
+			ApplyTAA(g.GetTextureId(input), g.GetTextureId(depth), g.GetTextureId(history));
+		});
+		fg.Read(pass, input);
+		fg.Read(pass, depth);
+		fg.Read(pass, history);
+		fg.Write(pass, output);
+
+		return output;
+	}
+
+	void PostProcessor::InitLuminanceReadback()
+	{
+		glGenBuffers(PC_LUMINANCE_READBACK_FRAMES, m_LuminancePBOs);
+		for (int i = 0; i < PC_LUMINANCE_READBACK_FRAMES; i++)
 		{
-			int t = (indx + 1) % 2;
-			ApplyDoF(sceneTextures[indx], LensDistDepthTexture->GetTextureId(), m_SceneFBOs[t]->GetID());
-			indx = t;
+			GLState::BindBuffer(GL_PIXEL_PACK_BUFFER, m_LuminancePBOs[i]);
+			glBufferData(GL_PIXEL_PACK_BUFFER, sizeof(float) * 8, 0, GL_STREAM_READ);
+			m_LuminanceFences[i] = nullptr;
+			m_ReadbackHoldsExposure[i] = false;
 		}
-		
-		if (m_ToneMappingEnabled)
+		GLState::BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+
+	void PostProcessor::DeleteLuminanceReadback()
+	{
+		for (int i = 0; i < PC_LUMINANCE_READBACK_FRAMES; i++)
 		{
-			ApplyToneMapping(sceneTextures[indx], outputFramebufferId);
+			if (m_LuminanceFences[i])
+				glDeleteSync((GLsync)m_LuminanceFences[i]);
+			m_LuminanceFences[i] = nullptr;
 		}
+		for (int i = 0; i < PC_LUMINANCE_READBACK_FRAMES; i++)
+			GLState::BufferDeleted(m_LuminancePBOs[i]);
+		glDeleteBuffers(PC_LUMINANCE_READBACK_FRAMES, m_LuminancePBOs);
+	}
 
-
-		if (!m_ToneMappingEnabled)
+	void PostProcessor::ResolveLuminanceReadback()
+	{
+		//walk the ring from the oldest pending readback to the newest one, stop at the first one the gpu hasnt finished yet
+		for (int i = 0; i < PC_LUMINANCE_READBACK_FRAMES; i++)
 		{
-			sceneTextures[indx]->Bind(0);
-
-			//blit final image to output
-			auto scrSize = m_Camera->m_ScreenSize;
-			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, outputFramebufferId);
-			m_ShaderBlitScreen->Bind();
-			m_ShaderBlitScreen->SetParameteri("tex", 0);
-			m_ShaderBlitScreen->SetParameterf("exp", 1.0f);
-			glViewport(0, 0, scrSize.x, scrSize.y);
-			RenderFullscreenQuad();
+			int slot = (m_LuminanceFrame + i) % PC_LUMINANCE_READBACK_FRAMES;
+			if (!m_LuminanceFences[slot])
+				continue;
+
+			GLenum state = glClientWaitSync((GLsync)m_LuminanceFences[slot], 0, 0); //timeout 0, only polls the fence
+			if (state != GL_ALREADY_SIGNALED && state != GL_CONDITION_SATISFIED)
+				break;
+
+			glDeleteSync((GLsync)m_LuminanceFences[slot]);
+			m_LuminanceFences[slot] = nullptr;
+
+			GLState::BindBuffer(GL_PIXEL_PACK_BUFFER, m_LuminancePBOs[slot]);
+			float *data = (float*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, sizeof(float) * 8, GL_MAP_READ_BIT);
+			if (data && m_ReadbackHoldsExposure[slot])
+			{
+				//copy of the gpu exposure buffer, mirror it to the camera so the getters show the values in use
+				m_AverageLuminance = data[0];
+				m_LuminanceResolved = true;
+				if (m_Camera->m_AutoExposure)
+				{
+					m_Camera->m_AverageSceneLuminance = data[1];
+					m_Camera->m_Aperture = data[4];
+					m_Camera->m_ShutterSpeed = data[5];
+					m_Camera->m_Iso = data[6];
+				}
+			}
+			else if (data)
+			{
+				//relative luminance: https://en.wikipedia.org/wiki/Relative_luminance
+				m_AverageLuminance = (0.2126f*data[0] + 0.7152f*data[1] + 0.0722f*data[2]);
+				m_LuminanceResolved = true;
+			}
+			if (data)
+				glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
 		}
+		GLState::BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
 	}
 
 	float PostProcessor::GetAverageLuminance(unsigned int inputTexture)
 	{
+		//pick up the results of previous frames the gpu has finished by now
+		ResolveLuminanceReadback();
+
+		int slot = m_LuminanceFrame % PC_LUMINANCE_READBACK_FRAMES;
+		if (m_LuminanceFences[slot] || !m_DownSampleFBO) //gpu is more than PC_LUMINANCE_READBACK_FRAMES behind, skip metering this frame
+			return m_AverageLuminance;
+
+		m_Profiler.Begin("Luminance");
+
 		//bind output framebuffer and bind renderTexture to it
 		m_DownSampleFBO->Bind();
 
 		//bind input texture
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, inputTexture);
+		BindTextureId(0, inputTexture);
 
-		m_ShaderDownsample->Bind();
-		m_ShaderDownsample->SetParameteri("tex", 0);
+		m_Shaders->m_ShaderDownsample->Bind();
 
-		//auto scrSize = m_Camera->m_ScreenSize;
-		//glViewport(0, 0, scrSize.x*0.5f, scrSize.y*0.5f);
-		RenderFullscreenQuad();
-		downSampleTexture->GenerateMipMaps();
-		
-		float *fPixel = new float[3];
-		glGetTexImage(GL_TEXTURE_2D, 9, GL_RGB, GL_FLOAT, fPixel); //9 is highest maximum mipmap level and should always end in a 1x1 texture
+		//the downsample target is 2D, the fallback meters the first view
+		m_Context->RenderFullscreenQuad(m_Layers > 0 ? 1 : 0);
+		m_DownSampleTexture->GenerateMipMaps();
 
-		//relative luminance: https://en.wikipedia.org/wiki/Relative_luminance
-		float ret = (0.2126f*fPixel[0] + 0.7152f*fPixel[1] + 0.0722f*fPixel[2]);
-		return ret;
+		//queue the copy of the 1x1 mipmap level into the pixel pack buffer, returns without waiting for the gpu
+		GLState::BindBuffer(GL_PIXEL_PACK_BUFFER, m_LuminancePBOs[slot]);
+		glGetTexImage(GL_TEXTURE_2D, m_DownSampleTexture->GetMaxMipLevel(), GL_RGB, GL_FLOAT, 0);
+		GLState::BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		m_LuminanceFences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		m_ReadbackHoldsExposure[slot] = false;
+		m_Profiler.End();
+
+		m_LuminanceFrame++;
+		return m_AverageLuminance;
+	}
+
+	void PostProcessor::InitMeteringBuffers()
+	{
+		if (!HasGPUMetering())
+			return;
+
+		unsigned int zeroBins[PC_METERING_HISTOGRAM_BINS] = { 0 };
+		glGenBuffers(1, &m_HistogramBuffer);
+		GLState::BindBuffer(GL_SHADER_STORAGE_BUFFER, m_HistogramBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(zeroBins), zeroBins, GL_DYNAMIC_COPY);
+
+		//Luminance (metered, adapted, target EV, exposure) and Settings (aperture, shutter speed, iso, unused)
+		float exposure[8] = { 0.0f };
+		glGenBuffers(1, &m_ExposureBuffer);
+		GLState::BindBuffer(GL_SHADER_STORAGE_BUFFER, m_ExposureBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(exposure), exposure, GL_DYNAMIC_COPY);
+		GLState::BindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+
+	void PostProcessor::DeleteMeteringBuffers()
+	{
+		GLState::BufferDeleted(m_HistogramBuffer);
+		glDeleteBuffers(1, &m_HistogramBuffer);
+		GLState::BufferDeleted(m_ExposureBuffer);
+		glDeleteBuffers(1, &m_ExposureBuffer);
 	}
-	
 
+	void PostProcessor::InitBloomKernels()
+	{
+		glGenBuffers(1, &m_BloomKernelBuffer);
+		GLState::BindBuffer(GL_UNIFORM_BUFFER, m_BloomKernelBuffer);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(glm::vec4) * 5 * PC_BLOOM_LINEAR_MAX_TAPS + sizeof(glm::ivec4) * 5, nullptr, GL_STATIC_DRAW);
+		GLState::BindBuffer(GL_UNIFORM_BUFFER, 0);
+		m_BloomKernelsDirty = true;
+	}
 
-	void PostProcessor::ApplyLuminance(float exposure, unsigned int inputTexture)
+	void PostProcessor::DeleteBloomKernels()
 	{
-		//render to scene framebuffer
-		m_SceneFBOs[0]->Bind();
+		GLState::BufferDeleted(m_BloomKernelBuffer);
+		glDeleteBuffers(1, &m_BloomKernelBuffer);
+	}
 
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, inputTexture);
+	void PostProcessor::UpdateBloomKernels()
+	{
+		//std140 layout of BloomKernelBlock
+		glm::vec4 taps[5 * PC_BLOOM_LINEAR_MAX_TAPS];
+		glm::ivec4 tapCounts[5];
 
-		m_ShaderBlitScreen->Bind();
-		m_ShaderBlitScreen->SetParameteri("tex", 0);
-		m_ShaderBlitScreen->SetParameterf("exp", exposure);
+		for (int level = 0; level < 5; level++)
+		{
+			glm::vec4 *levelTaps = &taps[level * PC_BLOOM_LINEAR_MAX_TAPS];
+			float radius = glm::min(m_BloomSpreads[level], PC_BLOOM_COMPUTE_MAX_RADIUS);
+
+			//same kernel as the incremental gaussian
+			int nSamples = glm::max((int)radius, 1) / 2;
+			if (nSamples == 0)
+			{
+				levelTaps[0] = glm::vec4(0.0f, 1.0f, 0.0f, 0.0f);
+				tapCounts[level] = glm::ivec4(1);
+				continue;
+			}
+
+			float sigma = radius / 8.0f;
+			float g0 = 1.0f / (glm::sqrt(6.2831853071795f) * sigma);
+			auto weight = [=](int i) { return g0 * glm::exp(-0.5f * i * i / (sigma * sigma)); };
+
+			//merge the taps i and i+1 into one fetch at their weighted center
+			int count = 1;
+			levelTaps[0] = glm::vec4(0.0f, weight(0), 0.0f, 0.0f);
+			for (int i = 1; i < nSamples; i += 2)
+			{
+				float w1 = weight(i);
+				float w2 = i + 1 < nSamples ? weight(i + 1) : 0.0f;
+				levelTaps[count++] = glm::vec4((i * w1 + (i + 1) * w2) / (w1 + w2), w1 + w2, 0.0f, 0.0f);
+			}
+			tapCounts[level] = glm::ivec4(count);
+		}
 
-		RenderFullscreenQuad();
+		GLState::BindBuffer(GL_UNIFORM_BUFFER, m_BloomKernelBuffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(taps), taps);
+		glBufferSubData(GL_UNIFORM_BUFFER, sizeof(taps), sizeof(tapCounts), tapCounts);
+		GLState::BindBuffer(GL_UNIFORM_BUFFER, 0);
+		m_BloomKernelsDirty = false;
 	}
 
+	void PostProcessor::InitDoFTileList()
+	{
+		if (!GL::HasComputeShader)
+			return;
+
+		glGenBuffers(1, &m_DoFTileBuffer);
+		m_DoFTileCapacity = 0;
+	}
 
-	void PostProcessor::ApplyLenseDistortion(unsigned int colTex, unsigned int depthTex)
+	void PostProcessor::DeleteDoFTileList()
 	{
-		m_LenseDistortionFBO->Bind();
-		
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, colTex);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, depthTex);
+		GLState::BufferDeleted(m_DoFTileBuffer);
+		glDeleteBuffers(1, &m_DoFTileBuffer);
+		m_DoFTileCapacity = 0;
+	}
 
-		auto scrSize = m_Camera->m_ScreenSize;
-		m_ShaderLensDistortion->Bind();
-		m_ShaderLensDistortion->SetParameteri("tex", 0);
-		m_ShaderLensDistortion->SetParameteri("depth", 1);
-		m_ShaderLensDistortion->SetParameterf("k", m_LensDistortionAmount);
-		m_ShaderLensDistortion->SetParameterVec2("screenSize", glm::vec2(scrSize));
-		RenderFullscreenQuad();
+	void PostProcessor::ReserveDoFTileList(int tileCount)
+	{
+		if (tileCount <= m_DoFTileCapacity)
+			return;
+
+		//uvec4 dispatch arguments followed by one uvec2 per tile
+		GLState::BindBuffer(GL_SHADER_STORAGE_BUFFER, m_DoFTileBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, 4 * sizeof(unsigned int) + 2 * sizeof(unsigned int) * tileCount, nullptr, GL_DYNAMIC_COPY);
+		GLState::BindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		m_DoFTileCapacity = tileCount;
 	}
 
-	void PostProcessor::ApplyBloom(RenderTexturePtr tex, unsigned int outputFBO)
+	void PostProcessor::InitAutofocus()
 	{
-		//render bright pass to temp fbo
-		
-		m_BrightnessPassFBO->Bind();
-		
-		//bind input texture
-		tex->Bind(0);
+		//always created, the DoF shaders declare the focus block even if the distance comes from a uniform
+		float focus[4] = { 0.0f };
+		glGenBuffers(1, &m_FocusBuffer);
+		GLState::BindBuffer(GL_UNIFORM_BUFFER, m_FocusBuffer);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(focus), focus, GL_DYNAMIC_COPY);
+		GLState::BindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
 
-		m_ShaderBrightPass->Bind();
-		m_ShaderBrightPass->SetParameterf("threshold", m_BloomThreshold);
-		m_ShaderBrightPass->SetParameterf("LenseFlareThreshold", m_BloomThreshold*10.f);
-		m_ShaderBrightPass->SetParameteri("tex", 0);
-		RenderFullscreenQuad();
+	void PostProcessor::DeleteAutofocus()
+	{
+		GLState::BufferDeleted(m_FocusBuffer);
+		glDeleteBuffers(1, &m_FocusBuffer);
+	}
 
+	void PostProcessor::SetResolutionScaleRange(float minScale, float maxScale)
+	{
+		m_MaxResolutionScale = glm::clamp(maxScale, PC_DYNAMIC_RESOLUTION_STEP, 1.0f);
+		m_MinResolutionScale = glm::clamp(minScale, PC_DYNAMIC_RESOLUTION_STEP, m_MaxResolutionScale);
+		m_ResolutionScale = glm::clamp(m_ResolutionScale, m_MinResolutionScale, m_MaxResolutionScale);
+	}
+
+	void PostProcessor::UpdateResolutionScale()
+	{
+		float gpuTime = m_Profiler.GetFrameTime();
+		if (m_GPUTimeBudget <= 0.0f || gpuTime <= 0.0f)
+		{
+			m_ResolutionScale = m_MaxResolutionScale;
+			return;
+		}
+
+		//the measured time lags a few frames behind a change, so the next step waits for it to show
+		if (m_ResolutionCooldown > 0)
+		{
+			m_ResolutionCooldown--;
+			return;
+		}
+
+		float scale = m_ResolutionScale;
+		if (gpuTime > m_GPUTimeBudget)
+			scale -= PC_DYNAMIC_RESOLUTION_STEP;
+		else if (gpuTime < m_GPUTimeBudget * PC_DYNAMIC_RESOLUTION_HEADROOM)
+			scale += PC_DYNAMIC_RESOLUTION_STEP;
+		scale = glm::clamp(scale, m_MinResolutionScale, m_MaxResolutionScale);
+
+		if (scale != m_ResolutionScale)
+		{
+			m_ResolutionScale = scale;
+			m_ResolutionCooldown = PC_DYNAMIC_RESOLUTION_INTERVAL;
+		}
+	}
+
+	glm::ivec2 PostProcessor::GetScaledSize(float factor) const
+	{
+		return glm::max(glm::ivec2(glm::ceil(glm::vec2(m_Camera->m_ScreenSize) * (factor * m_ResolutionScale))), glm::ivec2(1));
+	}
+
+	void PostProcessor::MeterExposure(unsigned int inputTexture)
+	{
+		//pick up the results of previous frames, only used to mirror the values to the camera
+		ResolveLuminanceReadback();
+		m_Profiler.Begin("Metering");
 
 		auto scrSize = m_Camera->m_ScreenSize;
-		RenderTexturePtr inp = bloomBrightnessTexture;
-		for (int i = 0; i < 5; i++)
+		glm::ivec2 grid(PC_METERING_GRID_WIDTH, glm::max(1, (int)(PC_METERING_GRID_WIDTH * scrSize.y / (float)scrSize.x)));
+
+		float lowPercentile = m_Camera->m_MeteringPercentiles.x;
+		float highPercentile = m_Camera->m_MeteringPercentiles.y;
+		float highlightBias = 0.0f;
+		if (m_Camera->m_MeteringMode == MeteringMode::HighlightProtect)
 		{
-			//horizontal blur
-			m_BloomhorFBOs[i]->Bind();
-			inp->Bind(0);
-
-			auto tSize = bloomTextureHor[i]->GetSize();
-#if USE_INCREMENTAL_GAUSS_BLUR
-			static glm::vec2 horBlurDir = glm::vec2(1.0f, 0.0f);
-			m_ShaderIncrementalGaussBlur->Bind();
-			m_ShaderIncrementalGaussBlur->SetParameteri("tex", 0);
-			m_ShaderIncrementalGaussBlur->SetParameterf("radius", m_BloomSpreads[i]);
-			m_ShaderIncrementalGaussBlur->SetParameterVec2("resolution", (glm::vec2)tSize);
-			m_ShaderIncrementalGaussBlur->SetParameterVec2("uBlurDirection", horBlurDir);
-#else
-			m_ShaderHorizontalBlur->Bind();
-			m_ShaderHorizontalBlur->SetParameteri("tex", 0);
-			m_ShaderHorizontalBlur->SetParameterf("resolution", scrSize.x);
-			m_ShaderHorizontalBlur->SetParameterf("radius", m_BloomSpreads[i]);
-#endif
-			RenderFullscreenQuad();
+			//meter only the brightest part of the frame and place it 2.5 EV above middle grey
+			lowPercentile = glm::max(lowPercentile, 0.8f);
+			highlightBias = 2.5f;
+		}
 
-			//vertical blur
-			m_BloomvertFBOs[i]->Bind();
-			bloomTextureHor[i]->Bind(0);
-
-#if USE_INCREMENTAL_GAUSS_BLUR
-			static glm::vec2 vertBlurDir = glm::vec2(0.0f, 1.0f);
-			//m_ShaderIncrementalGaussBlur->Bind();
-			//m_ShaderIncrementalGaussBlur->SetParameteri("tex", 0);
-			//m_ShaderIncrementalGaussBlur->SetParameterf("radius", m_BloomSpreads[i]);
-			//m_ShaderIncrementalGaussBlur->SetParameterVec2("resolution", (glm::vec2)scrSize);
-			m_ShaderIncrementalGaussBlur->SetParameterVec2("uBlurDirection", vertBlurDir);
-#else
-			m_ShaderVerticalBlur->Bind();
-			m_ShaderVerticalBlur->SetParameteri("tex", 0);
-			m_ShaderVerticalBlur->SetParameterf("resolution", scrSize.y);
-			m_ShaderVerticalBlur->SetParameterf("radius", m_BloomSpreads[i]);
-#endif
-			RenderFullscreenQuad();
+		BindTextureId(0, inputTexture);
+		GLState::BindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, m_HistogramBuffer);
+		GLState::BindBufferRange(GL_SHADER_STORAGE_BUFFER, 1, m_ExposureBuffer);
+
+		//both metering passes share one block
+		MeteringBlock metering = {};
+		metering.LogLuminanceRange = m_MeteringLuminanceRange;
+		metering.MeteringPoint = m_Camera->m_MeteringPoint;
+		metering.Percentiles = glm::vec2(lowPercentile, highPercentile);
+		metering.ApertureRange = glm::vec2(m_Camera->MinAperture(), m_Camera->MaxAperture());
+		metering.IsoRange = glm::vec2(m_Camera->MinIso(), m_Camera->MaxIso());
+		metering.ShutterRange = glm::vec2(m_Camera->MaxShutterSpeed(), m_Camera->MinShutterSpeed());
+		metering.GridSize = grid;
+		metering.MeteringMode = static_cast<int>(m_Camera->m_MeteringMode);
+		metering.SpotRadius = m_Camera->m_SpotMeteringRadius;
+		metering.Aspect = scrSize.x / (float)scrSize.y;
+		metering.HighlightBias = highlightBias;
+		metering.DeltaTime = m_Camera->DeltaTime();
+		metering.AdaptionSpeed = 2.0f;
+		metering.ExposureCompensation = m_Camera->m_TargetEV;
+		metering.FocalLength = m_Camera->FocalLength();
+		PushUniformBlock(PC_METERING_BLOCK_BINDING, metering);
+
+		//build the weighted log luminance histogram
+		m_Shaders->m_ShaderLuminanceHistogram->Bind();
+		glDispatchCompute((grid.x + 15) / 16, (grid.y + 15) / 16, glm::max(m_Layers, 1));
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+		//reduce it to a percentile clipped average, adapt and compute the exposure
+		m_Shaders->m_ShaderLuminanceAverage->Bind();
+		glDispatchCompute(1, 1, 1);
+		glMemoryBarrier(GL_UNIFORM_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+		GLState::BindBufferRange(GL_UNIFORM_BUFFER, PC_EXPOSURE_BLOCK_BINDING, m_ExposureBuffer);
+		m_ExposureOnGPU = true;
+
+		//queue a copy of the exposure buffer for the camera getters, read back a few frames late
+		int slot = m_LuminanceFrame % PC_LUMINANCE_READBACK_FRAMES;
+		if (!m_LuminanceFences[slot])
+		{
+			GLState::BindBuffer(GL_COPY_READ_BUFFER, m_ExposureBuffer);
+			GLState::BindBuffer(GL_COPY_WRITE_BUFFER, m_LuminancePBOs[slot]);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, sizeof(float) * 8);
+			GLState::BindBuffer(GL_COPY_READ_BUFFER, 0);
+			GLState::BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+			m_LuminanceFences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			m_ReadbackHoldsExposure[slot] = true;
+			m_LuminanceFrame++;
+		}
+		m_Profiler.End();
+	}
+	
+
+
+	void PostProcessor::UpdateUniformBlocks()
+	{
+		auto scrSize = m_Camera->m_ScreenSize;
+		glm::vec2 cameraClips(m_Camera->GetClipNear(), m_Camera->GetClipFar());
+
+		ExposureSettingsBlock exposure = {};
+		exposure.Exposure = m_Exposure;
+		exposure.UseExposureBuffer = m_ExposureOnGPU;
+		PushUniformBlock(PC_EXPOSURE_SETTINGS_BLOCK_BINDING, exposure);
+
+		ToneMappingBlock toneMapping = {};
+		toneMapping.OutputSize = glm::vec2(scrSize);
+		toneMapping.Timer = m_GrainSeed + m_GrainTimer;
+		toneMapping.GrainAmount = m_MinNoise + ((m_MaxNoise - m_MinNoise) / (m_Camera->MaxIso() - 1.0f)) * (m_Camera->Iso() - 1.0f);
+		toneMapping.TonemappingMethod = static_cast<int>(m_ToneMappingMethod);
+		PushUniformBlock(PC_TONEMAPPING_BLOCK_BINDING, toneMapping);
+
+		const float ChromaticDistortion = 1.5f;
+		LensBlock lens = {};
+		lens.ChromaticDistortionVector = glm::vec3(-ChromaticDistortion / scrSize.x*0.5f, 0.0f, ChromaticDistortion / scrSize.y*0.5f);
+		lens.K = m_LensDistortionAmount;
+		lens.ScreenSize = glm::vec2(scrSize);
+		lens.HaloWidth = 0.4f;
+		PushUniformBlock(PC_LENS_BLOCK_BINDING, lens);
+
+		if (m_BloomEnabled)
+		{
+			BloomBlock bloom = {};
+			for (int i = 0; i < 5; i++)
+				bloom.Strengths[i].x = m_BloomStrengths[i];
+			bloom.Threshold = m_BloomThreshold;
+			bloom.LenseFlareThreshold = m_BloomThreshold*10.f;
+			bloom.Intensity = m_BloomIntensity;
+			bloom.Strength = m_BloomIntensity;
+			bloom.HasDirtTexture = m_DirtTextureId < 0 ? 0 : 1;
+			PushUniformBlock(PC_BLOOM_BLOCK_BINDING, bloom);
+		}
 
-			inp = bloomTextureVert[i];
+		if (m_DoFEnabled)
+		{
+			DoFBlock dof = {};
+			dof.ScreenSize = glm::vec2(scrSize);
+			dof.CameraClips = cameraClips;
+			dof.FocalDepth = DoFFocalDistance();
+			dof.FocalLength = m_Camera->FocalLength();
+			dof.FStop = m_Camera->Aperture();
+			dof.CoC = m_Camera->SensorType().CoC;
+			dof.Fringe = DoFAberation();
+			dof.MaxBlur = DoFMaxBlur();
+			dof.Autofocus = DoFAutofocus();
+			dof.Vignetting = DoFVignetting();
+			dof.ShowFocus = DoFShowFocus();
+			dof.UseFocusBuffer = m_FocusOnGPU;
+			dof.GatherScale = 0.5f * m_ResolutionScale;
+			//the per pixel DoF halves its taps and rotates them every frame while TAA accumulates
+			dof.NoiseSeed = m_TAAActive ? (m_TAAFrame % PC_TAA_JITTER_SAMPLES + 1) / (float)(PC_TAA_JITTER_SAMPLES + 1) : 0.0f;
+			dof.RingSamples = m_TAAActive ? PC_TAA_DOF_RING_SAMPLES : 6;
+			PushUniformBlock(PC_DOF_BLOCK_BINDING, dof);
+			GLState::BindBufferRange(GL_UNIFORM_BUFFER, PC_FOCUS_BLOCK_BINDING, m_FocusBuffer);
 		}
 
+		if (m_TAAActive || m_MotionBlurActive)
+		{
+			ReprojectionBlock reprojection = {};
+			for (int i = 0; i < glm::clamp(m_Layers, 1, PC_MAX_VIEWS); i++)
+				reprojection.Reprojection[i] = m_Camera->m_PreviousViewProjectionMatrix[i] * glm::inverse(m_Camera->m_UnjitteredViewProjectionMatrix[i]);
+			reprojection.UseMotionVectors = m_MotionVectors != 0;
+			PushUniformBlock(PC_REPROJECTION_BLOCK_BINDING, reprojection);
+		}
 
-		//render composition pass to scene fbo
-		m_BloomOutputFBO->Bind();
+		if (m_TAAActive)
+		{
+			TAABlock taa = {};
+			taa.Feedback = m_TAAFeedback;
+			taa.HistoryValid = m_TAAHistoryValid;
+			PushUniformBlock(PC_TAA_BLOCK_BINDING, taa);
+		}
 
-		//compose bloom passes
-		for (int i = 0; i < 5; i++)
-			bloomTextureVert[i]->Bind(i);
+		if (m_MotionBlurActive)
+		{
+			MotionBlurBlock motionBlur = {};
+			motionBlur.CameraClips = cameraClips;
+			//the shutter is open for a fraction of the frame time, the blur covers that fraction of the motion
+			motionBlur.VelocityScale = glm::min(m_Camera->ShutterSpeed() / glm::max(m_Camera->DeltaTime(), 0.0001f), 1.0f);
+			motionBlur.MaxRadius = (float)PC_MOTION_BLUR_TILE_SIZE;
+			motionBlur.SampleCount = PC_MOTION_BLUR_SAMPLES;
+			PushUniformBlock(PC_MOTION_BLUR_BLOCK_BINDING, motionBlur);
+		}
+	}
 
-		m_ShaderBloomCompose->Bind();
-		int texLocations[] = { 0, 1, 2, 3, 4 };
-		m_ShaderBloomCompose->SetParameteriv("tex", 5, texLocations);
-		m_ShaderBloomCompose->SetParameterfv("strengths", 5, m_BloomStrengths);
-		m_ShaderBloomCompose->SetParameterf("intensity", m_BloomIntensity);
+	void PostProcessor::ApplyLuminance(unsigned int inputTexture)
+	{
+		BindTextureId(0, inputTexture);
 
+		m_Shaders->m_ShaderBlitScreen->Bind();
 		RenderFullscreenQuad();
+	}
 
 
-		// ** Apply lenseflare **
-#if USE_LENSE_FLARE
-		m_LenseFlareFBO->Bind();
-		
-		const float ChromaticDistortion = 1.5f;
-		glm::vec3 ChromaticDistortionVector(-ChromaticDistortion / scrSize.x*0.5f, 0.0f, ChromaticDistortion /scrSize.y*0.5f);
+	void PostProcessor::ApplyLenseDistortion(unsigned int colTex, unsigned int depthTex, unsigned int fusedStages)
+	{
+		BindTextureId(0, colTex);
+		BindTextureId(1, depthTex);
+
+		m_Shaders->m_FusedShaders[FusedLensDistortion][fusedStages]->Bind();
+		RenderFullscreenQuad();
+	}
 
-		bloomLenseFlareBrightnessTexture->Bind(0);
-		m_ShaderLenseFlare->Bind();
-		m_ShaderLenseFlare->SetParameteri("tex", 0);
-		m_ShaderLenseFlare->SetParameterf("HaloWidth", 0.4f);
-		m_ShaderLenseFlare->SetParameterVec3("ChromaticDistortionVector", ChromaticDistortionVector);
-		m_ShaderLenseFlare->SetParameterVec2("screenSize", glm::vec2(scrSize));
+	void PostProcessor::ApplyBrightPass(unsigned int inputTexture)
+	{
+		BindTextureId(0, inputTexture);
 
+		m_Shaders->m_ShaderBrightPass->Bind();
 		RenderFullscreenQuad();
-#endif
+	}
 
-		// compose bloom and lenseflare
-		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, outputFBO);
-		bloomOutputTex->Bind(0);
-		lenseFlareTexture->Bind(1);
-		tex->Bind(2);
+	void PostProcessor::ApplyBloomBlur(unsigned int inputTexture, glm::ivec2 size, int level, bool horizontal)
+	{
+		BindTextureId(0, inputTexture);
 
-		if (m_DirtTextureId > 0)
+		static glm::vec2 horBlurDir = glm::vec2(1.0f, 0.0f);
+		static glm::vec2 vertBlurDir = glm::vec2(0.0f, 1.0f);
+		//the uploaded kernels are cut off at PC_BLOOM_COMPUTE_MAX_RADIUS
+		if (m_BloomFilter == BloomFilter::LinearGaussian && m_BloomSpreads[level] <= PC_BLOOM_COMPUTE_MAX_RADIUS)
 		{
-			glActiveTexture(GL_TEXTURE3);
-			glBindTexture(GL_TEXTURE_2D, m_DirtTextureId);
+			GLState::BindBufferRange(GL_UNIFORM_BUFFER, PC_BLOOM_KERNEL_BLOCK_BINDING, m_BloomKernelBuffer);
+			const ShaderPtr &linear = m_Shaders->m_ShaderLinearGaussBlur;
+			const auto &uniforms = m_Shaders->m_LinearBlurUniforms;
+			linear->Bind();
+			linear->SetParameteri(uniforms.Level, level);
+			linear->SetParameterVec2(uniforms.Resolution, (glm::vec2)size);
+			linear->SetParameterVec2(uniforms.Direction, horizontal ? horBlurDir : vertBlurDir);
+			RenderFullscreenQuad();
+			return;
 		}
 
-		m_ShaderLenseBloomCompose->Bind();
-		m_ShaderLenseBloomCompose->SetParameteri("bloomPass", 0);
-		m_ShaderLenseBloomCompose->SetParameteri("lenseFlare", 1);
-		m_ShaderLenseBloomCompose->SetParameteri("baseTex", 2);
-		if (m_DirtTextureId > 0) m_ShaderLenseBloomCompose->SetParameteri("dirtTexture", 3);
-		m_ShaderLenseBloomCompose->SetParameteri("hasDirtTexture", m_DirtTextureId < 0 ? 0 : 1);
-		m_ShaderLenseBloomCompose->SetParameterf("strength", m_BloomIntensity);
-		glViewport(0, 0, scrSize.x, scrSize.y);
+		const ShaderPtr &incremental = m_Shaders->m_ShaderIncrementalGaussBlur;
+		const auto &uniforms = m_Shaders->m_IncrementalBlurUniforms;
+		incremental->Bind();
+		incremental->SetParameterf(uniforms.Radius, m_BloomSpreads[level]);
+		incremental->SetParameterVec2(uniforms.Resolution, (glm::vec2)size);
+		incremental->SetParameterVec2(uniforms.Direction, horizontal ? horBlurDir : vertBlurDir);
 		RenderFullscreenQuad();
+	}
 
-		
+	void PostProcessor::ApplyBloomBlurCompute(unsigned int inputTexture, unsigned int outputTexture, glm::ivec2 size, int level, bool horizontal)
+	{
+		BindTextureId(0, inputTexture);
+		BindImageTexture(outputTexture, 0, GetImageFormat());
+
+		const ShaderPtr &shader = GetBloomBlurComputeShader();
+		const auto &uniforms = m_Shaders->m_ComputeBlurUniforms[static_cast<int>(m_PrecisionProfile)];
+		shader->Bind();
+		shader->SetParameterIVec2(uniforms.Resolution, size);
+		shader->SetParameterf(uniforms.Radius, m_BloomSpreads[level]);
+		shader->SetParameteri(uniforms.Direction, !horizontal);
+
+		//one workgroup per tile of a row (horizontal) or column (vertical)
+		int length = horizontal ? size.x : size.y;
+		int lines = horizontal ? size.y : size.x;
+		glDispatchCompute((length + PC_BLOOM_COMPUTE_TILE_SIZE - 1) / PC_BLOOM_COMPUTE_TILE_SIZE, lines, glm::max(m_Layers, 1));
+
+		//the next blur or the compose pass samples the result
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+		GLState::BindImageTexture(0, 0, 0, false, 0, GL_WRITE_ONLY, GL_RGBA32F);
 	}
 
+	void PostProcessor::ApplyDualKawaseDown(unsigned int inputTexture, glm::ivec2 size)
+	{
+		BindTextureId(0, inputTexture);
 
-	void PostProcessor::ApplyToneMapping(RenderTexturePtr tex, unsigned int outputFBO)
+		const ShaderPtr &shader = m_Shaders->m_ShaderDualKawaseDown;
+		shader->Bind();
+		shader->SetParameterVec2(m_Shaders->m_DualKawaseUniforms.HalfPixel[0], 0.5f / glm::vec2(size));
+		RenderFullscreenQuad();
+	}
+
+	void PostProcessor::ApplyDualKawaseUp(unsigned int levelTexture, float levelWeight, unsigned int chainTexture, glm::ivec2 size, float offset)
+	{
+		BindTextureId(0, levelTexture);
+		BindTextureId(1, chainTexture);
+
+		const ShaderPtr &shader = m_Shaders->m_ShaderDualKawaseUp;
+		shader->Bind();
+		shader->SetParameterVec2(m_Shaders->m_DualKawaseUniforms.HalfPixel[1], 0.5f * offset / glm::vec2(size));
+		shader->SetParameterf(m_Shaders->m_DualKawaseUniforms.LevelWeight, levelWeight);
+		shader->SetParameteri(m_Shaders->m_DualKawaseUniforms.HasChain, chainTexture != 0);
+		RenderFullscreenQuad();
+	}
+
+	void PostProcessor::ApplyLenseBloomCompose(unsigned int bloomTex, unsigned int flareTex, unsigned int baseTex, unsigned int fusedStages)
 	{
-		static float tTime = 0.0;
-		tTime += m_Camera->DeltaTime()*0.001f;
+		BindTextureId(0, bloomTex);
+		BindTextureId(1, flareTex);
+		BindTextureId(2, baseTex);
 
-		float noiseAmount = m_MinNoise + ((m_MaxNoise - m_MinNoise) / (m_Camera->MaxIso() - 1.0f)) * (m_Camera->Iso() - 1.0f);
+		if (m_DirtTextureId > 0)
+			GLState::BindTexture(3, m_DirtTextureId);
 
-		tex->Bind(0);
+		m_Shaders->m_FusedShaders[FusedLenseBloomCompose][fusedStages]->Bind();
+		RenderFullscreenQuad();
+	}
+
+
+	void PostProcessor::ApplyToneMapping(unsigned int inputTexture, unsigned int outputFBO)
+	{
+		BindTextureId(0, inputTexture);
 
 		//blit final image to output
 		auto scrSize = m_Camera->m_ScreenSize;
-		glBindFramebuffer(GL_FRAMEBUFFER, outputFBO);
-		m_ShaderToneMapping->Bind();
-		m_ShaderToneMapping->SetParameteri("tex", 0);
-		m_ShaderToneMapping->SetParameterf("grainamount", noiseAmount);
-		m_ShaderToneMapping->SetParameterf("timer", tTime);
-		m_ShaderToneMapping->SetParameterVec2("screenSize", glm::vec2(scrSize));
-		m_ShaderToneMapping->SetParameteri("tonemappingMethod", static_cast<int>(m_ToneMappingMethod));
-		glViewport(0, 0, scrSize.x, scrSize.y);
+		GLState::BindFramebuffer(GL_FRAMEBUFFER, outputFBO);
+		m_Shaders->m_ShaderToneMapping->Bind();
+		GLState::Viewport(m_OutputOffset.x, m_OutputOffset.y, scrSize.x, scrSize.y);
 		RenderFullscreenQuad();
 	}
 
-	void PostProcessor::ApplyDoF(RenderTexturePtr tex, unsigned int depthTextureId, unsigned int outputFBO)
+	void PostProcessor::ApplyDoF(unsigned int inputTexture, unsigned int depthTextureId, unsigned int fusedStages)
 	{
-		tex->Bind(0);
-		glBindFramebuffer(GL_FRAMEBUFFER, outputFBO);
-		
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, depthTextureId);
+		BindTextureId(0, inputTexture);
+		BindTextureId(1, depthTextureId);
 
-		auto scrSize = m_Camera->m_ScreenSize;
+		m_Shaders->m_FusedShaders[FusedDoF][fusedStages]->Bind();
+		RenderFullscreenQuad();
+	}
+
+	void PostProcessor::ApplyDoFCoC(unsigned int depthTextureId)
+	{
+		BindTextureId(0, depthTextureId);
 
-		m_DoFShader->Bind();
-		m_DoFShader->SetParameteri("ColorTexture", 0);
-		m_DoFShader->SetParameteri("DepthTexture", 1);
-		m_DoFShader->SetParameteri("showFocus", DoFShowFocus());
-		m_DoFShader->SetParameteri("vignetting", DoFVignetting());
-		m_DoFShader->SetParameteri("autofocus", DoFAutofocus());
-		m_DoFShader->SetParameterf("fringe", DoFAberation());// = 0.7
-		m_DoFShader->SetParameterf("focalDepth", DoFFocalDistance());
-		m_DoFShader->SetParameterf("focalLength", m_Camera->FocalLength());
-		m_DoFShader->SetParameterf("fstop", m_Camera->Aperture());
-		m_DoFShader->SetParameterf("maxblur", DoFMaxBlur());
-		m_DoFShader->SetParameterf("CoC", m_Camera->SensorType().CoC);
-		m_DoFShader->SetParameterVec2("ScreenSize", (glm::vec2)scrSize);
-		m_DoFShader->SetParameterVec2("CameraClips", glm::vec2(m_Camera->GetClipNear(), m_Camera->GetClipFar()));
-		glViewport(0, 0, scrSize.x, scrSize.y);
+		m_Shaders->m_ShaderDoFCoC->Bind();
 		RenderFullscreenQuad();
 	}
 
-	void PostProcessor::DeleteFBOs()
+	void PostProcessor::ApplyDepthPyramid(unsigned int depthTextureId, unsigned int pyramidTexture, glm::ivec2 size, int levels)
 	{
-		m_DownSampleFBO.reset();
-		m_SceneFBOs[0].reset();
-		m_SceneFBOs[1].reset();
+		m_Shaders->m_ShaderDepthPyramid->Bind();
 
-		for (int i = 0; i < 5; i++)
+		//level 0 from the depth texture, every further level from the one above
+		for (int level = 0; level < levels; level++)
 		{
-			m_BloomhorFBOs[i].reset();
-			m_BloomvertFBOs[i].reset();
+			glm::ivec2 levelSize = glm::max(size >> level, glm::ivec2(1));
+			BindTextureId(0, level == 0 ? depthTextureId : pyramidTexture);
+			BindImageTexture(pyramidTexture, level, RenderTexture::RGBA32F);
+			m_Shaders->m_ShaderDepthPyramid->SetParameteri(m_Shaders->m_DepthPyramidSourceLevel, level - 1);
+			glDispatchCompute((levelSize.x + 7) / 8, (levelSize.y + 7) / 8, 1);
+			glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
 		}
-		
-		m_LenseFlareFBO.reset();
+		GLState::BindImageTexture(0, 0, 0, false, 0, GL_WRITE_ONLY, GL_RGBA32F);
+	}
+
+	void PostProcessor::ApplyAutofocus(unsigned int pyramidTexture, int levels)
+	{
+		BindTextureId(0, pyramidTexture);
+		GLState::BindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, m_FocusBuffer);
+
+		AutofocusBlock autofocus = {};
+		autofocus.Region = m_DoFAutofocusRegion;
+		autofocus.Levels = levels;
+		autofocus.Mode = static_cast<int>(m_DoFAutofocusMode);
+		autofocus.FocusSpeed = m_DoFFocusSpeed;
+		autofocus.DeltaTime = m_Camera->DeltaTime();
+		PushUniformBlock(PC_AUTOFOCUS_BLOCK_BINDING, autofocus);
+
+		m_Shaders->m_ShaderAutofocus->Bind();
+		glDispatchCompute(1, 1, 1);
+
+		//the DoF passes read the result as uniform block
+		glMemoryBarrier(GL_UNIFORM_BARRIER_BIT);
+	}
+
+	void PostProcessor::ApplyDoFTileClassify(unsigned int cocTexture, unsigned int tileTexture, glm::ivec2 tileCount)
+	{
+		//no blurred tiles yet, the gather is dispatched with (count, 1, 1) workgroups
+		unsigned int dispatchArgs[4] = { 0, 1, 1, 0 };
+		GLState::BindBuffer(GL_SHADER_STORAGE_BUFFER, m_DoFTileBuffer);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(dispatchArgs), dispatchArgs);
+		GLState::BindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, m_DoFTileBuffer);
+
+		BindTextureId(0, cocTexture);
+		BindImageTexture(tileTexture, 0, RenderTexture::RG16F);
+
+		m_Shaders->m_ShaderDoFTileClassify->Bind();
+		glDispatchCompute(tileCount.x, tileCount.y, glm::max(m_Layers, 1));
+
+		glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+		GLState::BindImageTexture(0, 0, 0, false, 0, GL_WRITE_ONLY, GL_RG16F);
+	}
+
+	void PostProcessor::ApplyDoFGather(unsigned int inputTexture, unsigned int cocTexture, unsigned int gatherTexture)
+	{
+		BindTextureId(0, inputTexture);
+		BindTextureId(1, cocTexture);
+		BindImageTexture(gatherTexture, 0, GetDoFGatherFormat());
+		GLState::BindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, m_DoFTileBuffer);
+
+		GetDoFGatherShader()->Bind();
+
+		//one workgroup per blurred tile, the count was written by the classification
+		GLState::BindBuffer(GL_DISPATCH_INDIRECT_BUFFER, m_DoFTileBuffer);
+		glDispatchComputeIndirect(0);
+		GLState::BindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+		GLState::BindImageTexture(0, 0, 0, false, 0, GL_WRITE_ONLY, GL_RGBA32F);
+	}
+
+	void PostProcessor::ApplyDoFComposite(unsigned int inputTexture, unsigned int cocTexture, unsigned int tileTexture, unsigned int gatherTexture, unsigned int fusedStages, bool toOutput)
+	{
+		BindTextureId(0, inputTexture);
+		BindTextureId(1, cocTexture);
+		BindTextureId(2, tileTexture);
+		BindTextureId(3, gatherTexture);
+
+		//the composite addresses its inputs with gl_FragCoord, which includes the output offset if it renders to the output
+		const ShaderPtr &shader = m_Shaders->m_FusedShaders[FusedDoFComposite][fusedStages];
+		shader->Bind();
+		shader->SetParameterIVec2("outputOffset", toOutput ? m_OutputOffset : glm::ivec2(0));
+		RenderFullscreenQuad();
+	}
+
+	void PostProcessor::ApplyTAA(unsigned int inputTexture, unsigned int depthTexture, unsigned int historyTexture)
+	{
+		BindTextureId(0, inputTexture);
+		BindTextureId(1, depthTexture);
+		BindTextureId(2, historyTexture);
+		BindTextureId(3, m_MotionVectors);
+
+		m_Shaders->m_ShaderTAA->Bind();
+		RenderFullscreenQuad();
+	}
+
+	void PostProcessor::ApplyMotionBlurVelocity(unsigned int depthTexture)
+	{
+		BindTextureId(0, depthTexture);
+		BindTextureId(1, m_MotionVectors);
+
+		m_Shaders->m_ShaderMotionBlurVelocity->Bind();
+		RenderFullscreenQuad();
+	}
+
+	void PostProcessor::ApplyMotionBlurTileMax(unsigned int velocityTexture)
+	{
+		BindTextureId(0, velocityTexture);
+
+		m_Shaders->m_ShaderMotionBlurTileMax->Bind();
+		RenderFullscreenQuad();
+	}
+
+	void PostProcessor::ApplyMotionBlurNeighborMax(unsigned int tileMaxTexture)
+	{
+		BindTextureId(0, tileMaxTexture);
+
+		m_Shaders->m_ShaderMotionBlurNeighborMax->Bind();
+		RenderFullscreenQuad();
+	}
+
+	void PostProcessor::ApplyMotionBlurGather(unsigned int inputTexture, unsigned int depthTexture, unsigned int velocityTexture, unsigned int neighborMaxTexture)
+	{
+		BindTextureId(0, inputTexture);
+		BindTextureId(1, depthTexture);
+		BindTextureId(2, velocityTexture);
+		BindTextureId(3, neighborMaxTexture);
+
+		m_Shaders->m_ShaderMotionBlurGather->Bind();
+		RenderFullscreenQuad();
+	}
+
+	void PostProcessor::DeleteFBOs()
+	{
+		m_DownSampleFBO.reset();
 	}
 
 	void PostProcessor::RenderFlares()
@@ -0,0 +1,486 @@
+/*
+	PhysiCam - Physically based camera
+	Copyright (C) 2015 Frank Khnke
+
+	This file is part of PhysiCam.
+
+	This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License 
+	as published by the Free Software Foundation; either 
+	version 3 of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ *	@file PostProcessingContext.cpp
+ */
+
+#include <physicam/PostProcessingContext.h>
+#include <physicam/PostProcessing.h>
+#include <physicam/Vertex.h>
+#include <physicam/Face.h>
+#include <physicam/ShaderCode.h>
+#include <physicam/physicam_gl.h>
+#include <physicam/GLState.h>
+
+#include <GL/glew.h>
+
+#include <algorithm>
+
+namespace PhysiCam
+{
+	//blocks a shader does not declare are skipped
+	static void BindUniformBlocks(const ShaderPtr& shader)
+	{
+		if (!shader)
+			return;
+
+		shader->SetUniformBlockBinding("ExposureBlock", PC_EXPOSURE_BLOCK_BINDING);
+		shader->SetUniformBlockBinding("BloomKernelBlock", PC_BLOOM_KERNEL_BLOCK_BINDING);
+		shader->SetUniformBlockBinding("FocusBlock", PC_FOCUS_BLOCK_BINDING);
+		shader->SetUniformBlockBinding("ExposureSettingsBlock", PC_EXPOSURE_SETTINGS_BLOCK_BINDING);
+		shader->SetUniformBlockBinding("ToneMappingBlock", PC_TONEMAPPING_BLOCK_BINDING);
+		shader->SetUniformBlockBinding("LensBlock", PC_LENS_BLOCK_BINDING);
+		shader->SetUniformBlockBinding("BloomBlock", PC_BLOOM_BLOCK_BINDING);
+		shader->SetUniformBlockBinding("DoFBlock", PC_DOF_BLOCK_BINDING);
+		shader->SetUniformBlockBinding("MeteringBlock", PC_METERING_BLOCK_BINDING);
+		shader->SetUniformBlockBinding("AutofocusBlock", PC_AUTOFOCUS_BLOCK_BINDING);
+		shader->SetUniformBlockBinding("ReprojectionBlock", PC_REPROJECTION_BLOCK_BINDING);
+		shader->SetUniformBlockBinding("TAABlock", PC_TAA_BLOCK_BINDING);
+		shader->SetUniformBlockBinding("MotionBlurBlock", PC_MOTION_BLUR_BLOCK_BINDING);
+	}
+
+	//assigns consecutive texture units to the samplers, images always use unit 0
+	static void SetTextureUnits(const ShaderPtr& shader, std::initializer_list<const char*> samplers, const char* image = nullptr)
+	{
+		if (!shader)
+			return;
+
+		shader->Bind();
+		int unit = 0;
+		for (const char* sampler : samplers)
+			shader->SetParameteri(sampler, unit++);
+		if (image)
+			shader->SetParameteri(image, 0);
+	}
+
+	//inserts code right behind the #version line of a shader
+	static std::string AddShaderDefines(const std::string& src, const std::string& defines)
+	{
+		size_t versionEnd = src.find('\n', src.find("#version"));
+		return src.substr(0, versionEnd + 1) + defines + src.substr(versionEnd + 1);
+	}
+
+	//layer of the fragment (written by LayeredGeomSrc) or of the invocation, compute shaders run one z slice per layer
+	static const char* LayeredFragmentDefines = "#define PC_LAYERED\n#define PC_LAYER vLayer\nflat in int vLayer;\n";
+	static const char* LayeredComputeDefines = "#define PC_LAYERED\n#define PC_LAYER int(gl_GlobalInvocationID.z)\n";
+
+	PostProcessingContext::PostProcessingContext(bool layered) : m_HasPassFusion(false), m_ShadersReady(false), m_QuadVBO(0),
+		m_IndexBuffer(0), m_VertexBuffer(0), m_Layered(layered)
+	{
+		for (int i = 0; i < PC_PRECISION_PROFILE_COUNT; i++)
+			m_PrecisionShadersCreated[i] = false;
+	}
+
+	PostProcessingContext::~PostProcessingContext()
+	{
+		DeleteQuadMesh();
+		m_RenderTargetPool.Clear();
+	}
+
+	PostProcessingContextPtr PostProcessingContext::Create()
+	{
+		PostProcessingContextPtr context = PostProcessingContextPtr(new PostProcessingContext);
+		context->InitQuadMesh();
+		context->InitShaders();
+		return context;
+	}
+
+	void PostProcessingContext::RenderFullscreenQuad(int layers)
+	{
+		GLState::BindVertexArray(m_QuadVBO);
+		if (layers > 0)
+			glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, layers);
+		else
+			glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+	}
+
+	PostProcessingContext* PostProcessingContext::GetLayeredContext()
+	{
+		if (m_Layered)
+			return this;
+
+		//submitted like the 2D shaders, the first layered frame waits for them
+		if (!m_LayeredContext)
+		{
+			m_LayeredContext = PostProcessingContextPtr(new PostProcessingContext(true));
+			m_LayeredContext->InitShaders();
+		}
+		return m_LayeredContext.get();
+	}
+
+	void PostProcessingContext::InitQuadMesh()
+	{
+		VertexList vertices;
+		FaceList faces;
+
+		Vertex v(glm::vec3(-1, -1, 0), glm::vec3(0, 0, 1), glm::vec2(0, 0)); vertices.push_back(v);
+		v = Vertex(glm::vec3(1, -1, 0), glm::vec3(0, 0, 1), glm::vec2(1, 0)); vertices.push_back(v);
+		v = Vertex(glm::vec3(1, 1, 0), glm::vec3(0, 0, 1), glm::vec2(1, 1)); vertices.push_back(v);
+		v = Vertex(glm::vec3(-1, 1, 0), glm::vec3(0, 0, 1), glm::vec2(0, 1)); vertices.push_back(v);
+		faces.push_back(Face(0, 1, 3));
+		faces.push_back(Face(1, 2, 3));
+
+		//generate vertex buffer object
+		glGenVertexArrays(1, &m_QuadVBO);
+		GLState::BindVertexArray(m_QuadVBO);
+		
+		// buffer for indices
+		glGenBuffers(1, &m_IndexBuffer);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_IndexBuffer);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(Face) * faces.size(), &faces[0], GL_STATIC_DRAW);
+
+		//buffer for vertices
+		glGenBuffers(1, &m_VertexBuffer);
+		glBindBuffer(GL_ARRAY_BUFFER, m_VertexBuffer);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * vertices.size(), &vertices[0], GL_STATIC_DRAW);
+
+		//setup data locations
+
+		// Positions (location = 0)
+		glEnableVertexAttribArray(PC_MODEL_VERTEX_LOCATION);
+		glVertexAttribPointer(PC_MODEL_VERTEX_LOCATION, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), 0);
+
+		//Normals (location = 1)
+		glEnableVertexAttribArray(PC_MODEL_NORMAL_LOCATION);
+		glVertexAttribPointer(PC_MODEL_NORMAL_LOCATION, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)sizeof(glm::vec3));
+
+		//texcoords (location = 2)
+		glEnableVertexAttribArray(PC_MODEL_TEXCOORD_LOCATION);
+		glVertexAttribPointer(PC_MODEL_TEXCOORD_LOCATION, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(sizeof(glm::vec3) * 2));
+
+		//vertexColor (location = 3)
+		glEnableVertexAttribArray(PC_MODEL_VERTEX_COLOR_LOCATION);
+		glVertexAttribPointer(PC_MODEL_VERTEX_COLOR_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(sizeof(glm::vec3) * 2 + sizeof(glm::vec2)));
+
+		// unbind buffers
+		GLState::BindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+
+	void PostProcessingContext::DeleteQuadMesh()
+	{
+		GLState::BindVertexArray(0);
+		glDeleteVertexArrays(1, &m_QuadVBO);
+		glDeleteBuffers(1, &m_IndexBuffer);
+		glDeleteBuffers(1, &m_VertexBuffer);
+	}
+
+	void PostProcessingContext::InitShaders()
+	{
+		//everything is submitted deferred, the driver can compile in parallel while the host loads its assets
+		m_ShaderBlitScreen = CreateShader(BlitScreenSrc, true);
+		m_ShaderDownsample = CreateShader(DownsampleScreenSrc, true);
+		m_ShaderLensDistortion = CreateShader(LensDistortionSrc, true);
+		m_ShaderBrightPass = CreateShader(BrightPassSrc, true);
+		m_ShaderIncrementalGaussBlur = CreateShader(IncrGaussBlurSrc, true);
+		m_ShaderLinearGaussBlur = CreateShader(LinearGaussBlurSrc, true);
+		m_ShaderDualKawaseDown = CreateShader(DualKawaseDownSrc, true);
+		m_ShaderDualKawaseUp = CreateShader(DualKawaseUpSrc, true);
+		m_ShaderBloomCompose = CreateShader(BloomComposeSrc, true);
+		m_ShaderLenseFlare = CreateShader(LenseFlareSrc, true);
+		m_ShaderLenseBloomCompose = CreateShader(BloomLenseComposeSrc, true);
+		m_ShaderToneMapping = CreateShader(ToneMapperSrc, true);
+		m_DoFShader = CreateShader(DoFSrc, true);
+		m_ShaderDoFCoC = CreateShader(DoFCoCSrc, true);
+		m_ShaderDoFComposite = CreateShader(DoFCompositeSrc, true);
+		m_ShaderTAA = CreateShader(TAASrc, true);
+		m_ShaderMotionBlurVelocity = CreateShader(MotionBlurVelocitySrc, true);
+		m_ShaderMotionBlurTileMax = CreateShader(MotionBlurTileMaxSrc, true);
+		m_ShaderMotionBlurNeighborMax = CreateShader(MotionBlurNeighborMaxSrc, true);
+		m_ShaderMotionBlurGather = CreateShader(MotionBlurGatherSrc, true);
+
+		if (GL::HasComputeShader)
+		{
+			m_ShaderLuminanceHistogram = CreateComputeShader(LuminanceHistogramSrc, true);
+			m_ShaderLuminanceAverage = CreateComputeShader(LuminanceAverageSrc, true);
+			m_ShaderDepthPyramid = CreateComputeShader(DepthPyramidSrc, true);
+			m_ShaderAutofocus = CreateComputeShader(DoFAutofocusSrc, true);
+			m_ShaderDoFTileClassify = CreateComputeShader(DoFTileClassifySrc, true);
+		}
+		InitFusedShaders();
+
+		ShaderPtr *shaders[] = { &m_ShaderBlitScreen, &m_ShaderDownsample, &m_ShaderLensDistortion, &m_ShaderBrightPass,
+			&m_ShaderIncrementalGaussBlur, &m_ShaderLinearGaussBlur, &m_ShaderDualKawaseDown, &m_ShaderDualKawaseUp,
+			&m_ShaderBloomCompose, &m_ShaderLenseFlare, &m_ShaderLenseBloomCompose, &m_ShaderToneMapping, &m_DoFShader,
+			&m_ShaderDoFCoC, &m_ShaderDoFComposite, &m_ShaderLuminanceHistogram, &m_ShaderLuminanceAverage,
+			&m_ShaderDepthPyramid, &m_ShaderAutofocus, &m_ShaderDoFTileClassify, &m_ShaderTAA, &m_ShaderMotionBlurVelocity,
+			&m_ShaderMotionBlurTileMax, &m_ShaderMotionBlurNeighborMax, &m_ShaderMotionBlurGather };
+		m_PendingShaders.assign(shaders, shaders + sizeof(shaders) / sizeof(shaders[0]));
+
+		//the default profile of every PostProcessor
+		InitPrecisionShaders(PrecisionProfile::Full32);
+	}
+
+	void PostProcessingContext::InitPrecisionShaders(PrecisionProfile profile)
+	{
+		int index = static_cast<int>(profile);
+		if (m_PrecisionShadersCreated[index] || !GL::HasComputeShader)
+			return;
+		m_PrecisionShadersCreated[index] = true;
+
+		//the image format qualifier has to match the format of the blur targets, the gather stores linear depth in alpha
+		const char *imageFormats[] = { "rgba32f", "rgba16f", "r11f_g11f_b10f" };
+		std::string bloomDefines = std::string("#define IMAGE_FORMAT ") + imageFormats[index] + "\n";
+		std::string gatherDefines = std::string("#define IMAGE_FORMAT ") + (profile == PrecisionProfile::Full32 ? "rgba32f" : "rgba16f") + "\n";
+		m_ShaderBloomBlurCompute[index] = CreateComputeShader(AddShaderDefines(BloomBlurComputeSrc, bloomDefines), !m_ShadersReady);
+		m_ShaderDoFGather[index] = CreateComputeShader(AddShaderDefines(DoFGatherComputeSrc, gatherDefines), !m_ShadersReady);
+
+		if (!m_ShadersReady)
+		{
+			m_PendingShaders.push_back(&m_ShaderBloomBlurCompute[index]);
+			m_PendingShaders.push_back(&m_ShaderDoFGather[index]);
+		}
+		else
+			InitShaderConstants();
+	}
+
+	ShaderPtr PostProcessingContext::CreateShader(const std::string& fs, bool deferred)
+	{
+		if (!m_Layered)
+			return Shader::Create(ScreenAlignedVertSrc, fs, deferred);
+		return Shader::Create(LayeredVertSrc, LayeredGeomSrc, AddShaderDefines(fs, LayeredFragmentDefines), deferred);
+	}
+
+	ShaderPtr PostProcessingContext::CreateComputeShader(const std::string& cs, bool deferred)
+	{
+		return Shader::CreateCompute(m_Layered ? AddShaderDefines(cs, LayeredComputeDefines) : cs, deferred);
+	}
+
+	bool PostProcessingContext::IsReady()
+	{
+		if (m_ShadersReady)
+			return true;
+
+		for (ShaderPtr *shader : m_PendingShaders)
+		{
+			if (*shader && !(*shader)->IsCompleted())
+				return false;
+		}
+		for (auto &pass : m_FusedShaders)
+		{
+			for (auto &shader : pass)
+			{
+				if (shader && !shader->IsCompleted())
+					return false;
+			}
+		}
+
+		//everything is linked, checking the status does not block anymore
+		WaitUntilReady();
+		return true;
+	}
+
+	void PostProcessingContext::WaitUntilReady()
+	{
+		if (m_ShadersReady)
+			return;
+
+		//before the unfused shaders are reset, index 0 of the fused table shares them
+		FinishFusedShaders();
+
+		//dropping a failed shader makes the Has* queries select the fallback
+		for (ShaderPtr *shader : m_PendingShaders)
+		{
+			if (*shader && !(*shader)->Finish())
+				shader->reset();
+		}
+		m_PendingShaders.clear();
+		m_ShadersReady = true;
+
+		if (!m_ShaderLuminanceAverage)
+			m_ShaderLuminanceHistogram.reset(); //fall back to mipmap metering
+
+		InitShaderConstants();
+	}
+
+	void PostProcessingContext::InitFusedShaders()
+	{
+		const std::string *passSources[FusedPassCount] = { &LensDistortionSrc, &BloomLenseComposeSrc, &DoFSrc, &DoFCompositeSrc };
+		m_FusedShaders[FusedLensDistortion][0] = m_ShaderLensDistortion;
+		m_FusedShaders[FusedLenseBloomCompose][0] = m_ShaderLenseBloomCompose;
+		m_FusedShaders[FusedDoF][0] = m_DoFShader;
+		m_FusedShaders[FusedDoFComposite][0] = m_ShaderDoFComposite;
+
+		//only the combinations Render asks for: exposure always follows the lense distortion, tonemapping ends the chain
+		const int combinations[][2] = {
+			{ FusedLensDistortion, FusedExposure },
+			{ FusedLensDistortion, FusedExposure | FusedToneMapping },
+			{ FusedLenseBloomCompose, FusedToneMapping },
+			{ FusedDoF, FusedToneMapping },
+			{ FusedDoFComposite, FusedToneMapping }
+		};
+
+		for (auto &c : combinations)
+			m_FusedShaders[c[0]][c[1]] = CreateShader(GenerateFusedShader(*passSources[c[0]], c[1]), true);
+	}
+
+	void PostProcessingContext::FinishFusedShaders()
+	{
+		m_HasPassFusion = true;
+		for (int pass = 0; pass < FusedPassCount; pass++)
+		{
+			for (unsigned int stages = 1; stages < FusedStageCombinations; stages++)
+			{
+				ShaderPtr &shader = m_FusedShaders[pass][stages];
+				if (!shader)
+					continue;
+				if (!shader->Finish())
+					m_HasPassFusion = false;
+			}
+		}
+
+		if (!m_HasPassFusion)
+			std::cerr << "Failed to compile fused postprocessing shader, pass fusion is disabled" << std::endl;
+	}
+
+	void PostProcessingContext::InitShaderConstants()
+	{
+		ShaderPtr shaders[] = { m_ShaderBlitScreen, m_ShaderDownsample, m_ShaderBrightPass, m_ShaderIncrementalGaussBlur,
+			m_ShaderLinearGaussBlur, m_ShaderDualKawaseDown, m_ShaderDualKawaseUp, m_ShaderBloomCompose, m_ShaderLenseFlare,
+			m_ShaderToneMapping, m_ShaderDoFCoC, m_ShaderLuminanceHistogram, m_ShaderLuminanceAverage, m_ShaderDepthPyramid,
+			m_ShaderAutofocus, m_ShaderDoFTileClassify, m_ShaderTAA, m_ShaderMotionBlurVelocity, m_ShaderMotionBlurTileMax,
+			m_ShaderMotionBlurNeighborMax, m_ShaderMotionBlurGather };
+		for (auto &shader : shaders)
+			BindUniformBlocks(shader);
+
+		SetTextureUnits(m_ShaderBlitScreen, { "tex" });
+		SetTextureUnits(m_ShaderDownsample, { "tex" });
+		SetTextureUnits(m_ShaderBrightPass, { "tex" });
+		SetTextureUnits(m_ShaderIncrementalGaussBlur, { "tex" });
+		SetTextureUnits(m_ShaderLinearGaussBlur, { "tex" });
+		SetTextureUnits(m_ShaderDualKawaseDown, { "tex" });
+		SetTextureUnits(m_ShaderDualKawaseUp, { "tex", "chain" });
+		SetTextureUnits(m_ShaderLenseFlare, { "tex" });
+		SetTextureUnits(m_ShaderToneMapping, { "hdrColor" });
+		SetTextureUnits(m_ShaderDoFCoC, { "DepthTexture" });
+		SetTextureUnits(m_ShaderLuminanceHistogram, { "tex" });
+		SetTextureUnits(m_ShaderDepthPyramid, { "depthTex" }, "outputImage");
+		SetTextureUnits(m_ShaderAutofocus, { "pyramid" });
+		SetTextureUnits(m_ShaderDoFTileClassify, { "CoCTexture" }, "tileImage");
+		SetTextureUnits(m_ShaderTAA, { "tex", "depth", "history", "motionVectors" });
+		SetTextureUnits(m_ShaderMotionBlurVelocity, { "depth", "motionVectors" });
+		SetTextureUnits(m_ShaderMotionBlurTileMax, { "velocityTexture" });
+		SetTextureUnits(m_ShaderMotionBlurNeighborMax, { "tileMaxTexture" });
+		SetTextureUnits(m_ShaderMotionBlurGather, { "tex", "depth", "velocityTexture", "neighborMaxTexture" });
+		if (m_ShaderBloomCompose)
+		{
+			int texLocations[] = { 0, 1, 2, 3, 4 };
+			m_ShaderBloomCompose->Bind();
+			m_ShaderBloomCompose->SetParameteriv("tex", 5, texLocations);
+		}
+
+		for (int i = 0; i < PC_PRECISION_PROFILE_COUNT; i++)
+		{
+			BindUniformBlocks(m_ShaderBloomBlurCompute[i]);
+			BindUniformBlocks(m_ShaderDoFGather[i]);
+			SetTextureUnits(m_ShaderBloomBlurCompute[i], { "tex" }, "outputImage");
+			SetTextureUnits(m_ShaderDoFGather[i], { "ColorTexture", "CoCTexture" }, "outputImage");
+
+			m_ComputeBlurUniforms[i] = { -1, -1, -1, -1 };
+			if (m_ShaderBloomBlurCompute[i])
+			{
+				m_ComputeBlurUniforms[i].Radius = m_ShaderBloomBlurCompute[i]->GetUniformLocation("radius");
+				m_ComputeBlurUniforms[i].Resolution = m_ShaderBloomBlurCompute[i]->GetUniformLocation("resolution");
+				m_ComputeBlurUniforms[i].Direction = m_ShaderBloomBlurCompute[i]->GetUniformLocation("vertical");
+			}
+		}
+
+		//the unfused pass shaders are index 0 of the fused table
+		for (int pass = 0; pass < FusedPassCount; pass++)
+		{
+			for (auto &shader : m_FusedShaders[pass])
+			{
+				if (!shader || !shader->Finish())
+					continue;
+
+				BindUniformBlocks(shader);
+				if (pass == FusedLensDistortion)
+					SetTextureUnits(shader, { "tex", "depth" });
+				else if (pass == FusedLenseBloomCompose)
+					SetTextureUnits(shader, { "bloomPass", "lenseFlare", "baseTex", "dirtTexture" });
+				else if (pass == FusedDoF)
+					SetTextureUnits(shader, { "ColorTexture", "DepthTexture" });
+				else
+					SetTextureUnits(shader, { "ColorTexture", "CoCTexture", "TileTexture", "GatherTexture" });
+			}
+		}
+		GLState::UseProgram(0);
+
+		m_IncrementalBlurUniforms = { -1, -1, -1, -1 };
+		m_LinearBlurUniforms = { -1, -1, -1, -1 };
+		if (m_ShaderIncrementalGaussBlur)
+		{
+			m_IncrementalBlurUniforms.Radius = m_ShaderIncrementalGaussBlur->GetUniformLocation("radius");
+			m_IncrementalBlurUniforms.Resolution = m_ShaderIncrementalGaussBlur->GetUniformLocation("resolution");
+			m_IncrementalBlurUniforms.Direction = m_ShaderIncrementalGaussBlur->GetUniformLocation("uBlurDirection");
+		}
+		if (m_ShaderLinearGaussBlur)
+		{
+			m_LinearBlurUniforms.Level = m_ShaderLinearGaussBlur->GetUniformLocation("level");
+			m_LinearBlurUniforms.Resolution = m_ShaderLinearGaussBlur->GetUniformLocation("resolution");
+			m_LinearBlurUniforms.Direction = m_ShaderLinearGaussBlur->GetUniformLocation("uBlurDirection");
+		}
+		m_DualKawaseUniforms.HalfPixel[0] = m_ShaderDualKawaseDown ? m_ShaderDualKawaseDown->GetUniformLocation("halfPixel") : -1;
+		if (m_ShaderDualKawaseUp)
+		{
+			m_DualKawaseUniforms.HalfPixel[1] = m_ShaderDualKawaseUp->GetUniformLocation("halfPixel");
+			m_DualKawaseUniforms.LevelWeight = m_ShaderDualKawaseUp->GetUniformLocation("levelWeight");
+			m_DualKawaseUniforms.HasChain = m_ShaderDualKawaseUp->GetUniformLocation("hasChain");
+		}
+		m_DepthPyramidSourceLevel = m_ShaderDepthPyramid ? m_ShaderDepthPyramid->GetUniformLocation("sourceLevel") : -1;
+	}
+
+	std::string PostProcessingContext::GenerateFusedShader(const std::string& passSrc, unsigned int stages)
+	{
+		//the pass writes its result through PC_FUSED_OUTPUT, route it through the stages appended behind the pass
+		std::string src = AddShaderDefines(passSrc, "#define PC_FUSED_OUTPUT(c) FusedOutput(c)\nvec4 FusedOutput(vec4 fused);\n");
+
+		if (stages & FusedExposure)
+			src += ExposureStageSrc;
+		if (stages & FusedToneMapping)
+			src += ToneMappingStageSrc;
+
+		src += "vec4 FusedOutput(vec4 fused)\n{\n";
+		if (stages & FusedExposure)
+			src += "\tfused.rgb = ExposureStage(fused.rgb);\n";
+		if (stages & FusedToneMapping)
+			src += "\tfused.rgb = ToneMappingStage(fused.rgb);\n";
+		src += "\treturn fused;\n}\n";
+		return src;
+	}
+
+	void PostProcessingContext::EndFrame(const PostProcessor* pp)
+	{
+		if (std::find(m_RenderedPostProcessors.begin(), m_RenderedPostProcessors.end(), pp) != m_RenderedPostProcessors.end())
+		{
+			m_RenderTargetPool.EndFrame();
+			m_RenderedPostProcessors.clear();
+		}
+		m_RenderedPostProcessors.push_back(pp);
+	}
+
+	void PostProcessingContext::RemovePostProcessor(const PostProcessor* pp)
+	{
+		m_RenderedPostProcessors.erase(std::remove(m_RenderedPostProcessors.begin(), m_RenderedPostProcessors.end(), pp),
+			m_RenderedPostProcessors.end());
+	}
+}
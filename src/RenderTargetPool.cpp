@@ -0,0 +1,252 @@
+/*
+	PhysiCam - Physically based camera
+	Copyright (C) 2015 Frank Khnke
+
+	This file is part of PhysiCam.
+
+	This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License 
+	as published by the Free Software Foundation; either 
+	version 3 of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ *	@file RenderTargetPool.cpp
+ */
+
+#include <physicam/RenderTargetPool.h>
+
+#include <GL/glew.h>
+
+namespace PhysiCam
+{
+
+	RenderTargetPool::RenderTargetPool() : m_Frame(0), m_FreeBudget(PC_RENDER_TARGET_POOL_FREE_BUDGET)
+	{
+	}
+
+	RenderTargetPool::~RenderTargetPool()
+	{
+		Clear();
+	}
+
+	uint64_t RenderTargetPool::GetBucketKey(const RenderTargetDesc& desc)
+	{
+		return ((uint64_t)(desc.Layers & 0xFF) << 56) | ((uint64_t)(desc.Format & 0xFFFF) << 40) | ((uint64_t)(desc.MipLevels & 0xFF) << 32) |
+			((uint64_t)(desc.Size.x & 0xFFFF) << 16) | (uint64_t)(desc.Size.y & 0xFFFF);
+	}
+
+	RenderTexturePtr RenderTargetPool::Acquire(const RenderTargetDesc& desc)
+	{
+		uint64_t key = GetBucketKey(desc);
+		std::vector<Entry> &bucket = m_Buckets[key];
+		for (auto &e : bucket)
+		{
+			if (!e.InUse)
+			{
+				e.InUse = true;
+				e.LastUsedFrame = m_Frame;
+				return e.Texture;
+			}
+		}
+
+		Entry e;
+		e.Desc = desc;
+		if (desc.Layers > 0)
+			e.Texture = RenderTexture::CreateArray(desc.Size.x, desc.Size.y, desc.Layers, desc.Format, desc.MipLevels > 1);
+		else
+			e.Texture = RenderTexture::Create(desc.Size.x, desc.Size.y, RenderTexture::TEXTURE_2D, desc.Format, false, desc.MipLevels > 1);
+		e.InUse = true;
+		e.LastUsedFrame = m_Frame;
+		bucket.push_back(e);
+		m_TextureBuckets[e.Texture->GetTextureId()] = key;
+		return e.Texture;
+	}
+
+	void RenderTargetPool::Release(const RenderTexturePtr& texture)
+	{
+		if (!texture)
+			return;
+
+		auto it = m_TextureBuckets.find(texture->GetTextureId());
+		if (it == m_TextureBuckets.end())
+			return;
+
+		for (auto &e : m_Buckets[it->second])
+		{
+			if (e.Texture == texture)
+			{
+				e.InUse = false;
+				e.LastUsedFrame = m_Frame;
+				return;
+			}
+		}
+	}
+
+	FramebufferPtr RenderTargetPool::GetFramebuffer(const RenderTexturePtr* targets, int count)
+	{
+		unsigned int ids[PC_MAX_RENDER_TARGETS] = { 0 };
+		glm::ivec2 size(0);
+		for (int i = 0; i < count && i < PC_MAX_RENDER_TARGETS; i++)
+		{
+			if (targets[i])
+			{
+				ids[i] = targets[i]->GetTextureId();
+				size = targets[i]->GetSize();
+			}
+		}
+
+		for (auto &fb : m_Framebuffers)
+		{
+			if (memcmp(fb.TextureIds, ids, sizeof(ids)) == 0)
+				return fb.Framebuffer;
+		}
+
+		FramebufferEntry entry;
+		memcpy(entry.TextureIds, ids, sizeof(ids));
+		entry.Framebuffer = Framebuffer::Create(size.x, size.y);
+		for (int i = 0; i < count && i < PC_MAX_RENDER_TARGETS; i++)
+		{
+			if (targets[i])
+				entry.Framebuffer->BindTexture(targets[i], (Framebuffer::AttachmentType)(Framebuffer::COLOR0 + i));
+		}
+		m_Framebuffers.push_back(entry);
+		return entry.Framebuffer;
+	}
+
+	void RenderTargetPool::EndFrame()
+	{
+		size_t freeBytes = 0;
+		for (auto &b : m_Buckets)
+		{
+			std::vector<Entry> &bucket = b.second;
+			for (size_t i = 0; i < bucket.size();)
+			{
+				Entry &e = bucket[i];
+				if (!e.InUse && m_Frame - e.LastUsedFrame > PC_RENDER_TARGET_POOL_LIFETIME)
+				{
+					DeleteEntry(bucket, i);
+					continue;
+				}
+
+				if (!e.InUse)
+					freeBytes += GetBytes(e.Desc);
+				i++;
+			}
+		}
+
+		//dragging a window leaves a set of targets per intermediate size behind, the oldest of them go first
+		while (freeBytes > m_FreeBudget)
+		{
+			std::vector<Entry> *oldestBucket = nullptr;
+			size_t oldest = 0;
+			for (auto &b : m_Buckets)
+			{
+				for (size_t i = 0; i < b.second.size(); i++)
+				{
+					const Entry &e = b.second[i];
+					if (!e.InUse && (!oldestBucket || e.LastUsedFrame < (*oldestBucket)[oldest].LastUsedFrame))
+					{
+						oldestBucket = &b.second;
+						oldest = i;
+					}
+				}
+			}
+			if (!oldestBucket)
+				break;
+
+			freeBytes -= GetBytes((*oldestBucket)[oldest].Desc);
+			DeleteEntry(*oldestBucket, oldest);
+		}
+
+		for (auto it = m_Buckets.begin(); it != m_Buckets.end();)
+		{
+			if (it->second.empty())
+				it = m_Buckets.erase(it);
+			else
+				++it;
+		}
+		m_Frame++;
+	}
+
+	void RenderTargetPool::DeleteEntry(std::vector<Entry>& bucket, size_t index)
+	{
+		unsigned int textureId = bucket[index].Texture->GetTextureId();
+		DeleteFramebuffersUsing(textureId);
+		m_TextureBuckets.erase(textureId);
+		bucket.erase(bucket.begin() + index);
+	}
+
+	void RenderTargetPool::Clear()
+	{
+		m_Framebuffers.clear();
+		m_Buckets.clear();
+		m_TextureBuckets.clear();
+	}
+
+	void RenderTargetPool::DeleteFramebuffersUsing(unsigned int textureId)
+	{
+		//texture ids get recycled by the driver, so a cached framebuffer must never outlive its textures
+		for (size_t i = 0; i < m_Framebuffers.size();)
+		{
+			bool uses = false;
+			for (int j = 0; j < PC_MAX_RENDER_TARGETS; j++)
+				uses |= m_Framebuffers[i].TextureIds[j] == textureId;
+
+			if (uses)
+				m_Framebuffers.erase(m_Framebuffers.begin() + i);
+			else
+				i++;
+		}
+	}
+
+	size_t RenderTargetPool::GetAllocatedBytes() const
+	{
+		size_t bytes = 0;
+		for (auto &b : m_Buckets)
+			bytes += GetBytes(b.second.size() ? b.second[0].Desc : RenderTargetDesc()) * b.second.size();
+		return bytes;
+	}
+
+	size_t RenderTargetPool::GetBytes(const RenderTargetDesc& desc)
+	{
+		size_t levelBytes = (size_t)desc.Size.x * desc.Size.y * glm::max(desc.Layers, 1) * GetBytesPerPixel(desc.Format);
+		return desc.MipLevels > 1 ? levelBytes * 4 / 3 : levelBytes;
+	}
+
+	size_t RenderTargetPool::GetBytesPerPixel(RenderTexture::Format format)
+	{
+		//three channel formats are counted with the padding most drivers add
+		switch (format)
+		{
+		case RenderTexture::RGBA32F:
+		case RenderTexture::RGB32F:
+			return 16;
+		case RenderTexture::RGBA16F:
+		case RenderTexture::RGB16F:
+		case RenderTexture::RG32F:
+			return 8;
+		case RenderTexture::R32F:
+		case RenderTexture::RG16F:
+		case RenderTexture::R11F_G11F_B10F:
+		case RenderTexture::RGBA8:
+		case RenderTexture::RGB8:
+			return 4;
+		case RenderTexture::R16F:
+		case RenderTexture::RG8:
+			return 2;
+		case RenderTexture::R8:
+			return 1;
+		default:
+			return 16;
+		}
+	}
+}
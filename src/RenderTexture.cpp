@@ -25,11 +25,13 @@
 
 #include <physicam/RenderTexture.h>
 #include <physicam/physicam_gl.h>
+#include <physicam/GLState.h>
 
 #include <gl/glew.h>
 
 namespace PhysiCam
 {
+	std::unordered_map<unsigned int, RenderTexture::FormatInfo> RenderTexture::s_FormatTable;
 
 
 	RenderTexturePtr RenderTexture::Create(int width, int height, RenderTexture::Type type, RenderTexture::Format textureFormat, bool compressed /*= false*/, bool genMipMaps /*= false*/)
@@ -42,13 +44,28 @@ namespace PhysiCam
 		return tex;
 	}
 
+	RenderTexturePtr RenderTexture::CreateArray(int width, int height, int layers, RenderTexture::Format textureFormat, bool genMipMaps /*= false*/)
+	{
+		RenderTexturePtr tex = RenderTexturePtr(new RenderTexture());
+		tex->m_Size = glm::ivec2(width, height);
+		tex->m_Layers = glm::max(layers, 1);
+		tex->m_Target = GL_TEXTURE_2D_ARRAY;
+		tex->m_Type = TEXTURE_2D_ARRAY;
+		tex->m_Format = textureFormat;
+		tex->GenerateTexture(textureFormat, genMipMaps);
+		return tex;
+	}
+
 	RenderTexture::RenderTexture()
 	{
 		m_TextureId = 0;
+		m_Layers = 0;
+		m_Target = GL_TEXTURE_2D;
 	}
 
 	RenderTexture::~RenderTexture()
 	{
+		GLState::TextureDeleted(m_TextureId);
 		glDeleteTextures(1, &m_TextureId);
 	}
 
@@ -60,11 +77,9 @@ namespace PhysiCam
 		}
 		else //No direct state access available, use slower method
 		{
-			GLuint boundTexture = 0;
-			glGetIntegerv(GL_TEXTURE_BINDING_2D, (GLint*)&boundTexture); //get currently bound texture
-			glBindTexture(GL_TEXTURE_2D, m_TextureId); //bind to this texture, so we can change state
-			glTexParameteri(GL_TEXTURE_2D, pName, param); //change state for this texture
-			if (boundTexture != m_TextureId) glBindTexture(GL_TEXTURE_2D, boundTexture); //rebind to old texture again
+			GLuint boundTexture = GLState::BindTextureForUpdate(m_TextureId, IsArray()); //bind to this texture, so we can change state
+			glTexParameteri(m_Target, pName, param); //change state for this texture
+			if (boundTexture != m_TextureId) glBindTexture(m_Target, boundTexture); //rebind to old texture again, only needed untracked
 		}
 	}
 
@@ -76,11 +91,9 @@ namespace PhysiCam
 		}
 		else //No direct state access available, use slower method
 		{
-			GLuint boundTexture = 0;
-			glGetIntegerv(GL_TEXTURE_BINDING_2D, (GLint*)&boundTexture); //get currently bound texture
-			glBindTexture(GL_TEXTURE_2D, m_TextureId); //bind to this texture, so we can change state
-			glTexParameteriv(GL_TEXTURE_2D, pName, param); //change state for this texture
-			if (boundTexture != m_TextureId) glBindTexture(GL_TEXTURE_2D, boundTexture); //rebind to old texture again
+			GLuint boundTexture = GLState::BindTextureForUpdate(m_TextureId, IsArray()); //bind to this texture, so we can change state
+			glTexParameteriv(m_Target, pName, param); //change state for this texture
+			if (boundTexture != m_TextureId) glBindTexture(m_Target, boundTexture); //rebind to old texture again, only needed untracked
 		}
 	}
 
@@ -92,11 +105,9 @@ namespace PhysiCam
 		}
 		else //No direct state access available, use slower method
 		{
-			GLuint boundTexture = 0;
-			glGetIntegerv(GL_TEXTURE_BINDING_2D, (GLint*)&boundTexture); //get currently bound texture
-			glBindTexture(GL_TEXTURE_2D, m_TextureId); //bind to this texture, so we can change state
-			glTexParameterf(GL_TEXTURE_2D, pName, param); //change state for this texture
-			if (boundTexture != m_TextureId) glBindTexture(GL_TEXTURE_2D, boundTexture); //rebind to old texture again
+			GLuint boundTexture = GLState::BindTextureForUpdate(m_TextureId, IsArray()); //bind to this texture, so we can change state
+			glTexParameterf(m_Target, pName, param); //change state for this texture
+			if (boundTexture != m_TextureId) glBindTexture(m_Target, boundTexture); //rebind to old texture again, only needed untracked
 		}
 	}
 
@@ -108,18 +119,15 @@ namespace PhysiCam
 		}
 		else //No direct state access available, use slower method
 		{
-			GLuint boundTexture = 0;
-			glGetIntegerv(GL_TEXTURE_BINDING_2D, (GLint*)&boundTexture); //get currently bound texture
-			glBindTexture(GL_TEXTURE_2D, m_TextureId); //bind to this texture, so we can change state
-			glTexParameterfv(GL_TEXTURE_2D, pName, param); //change state for this texture
-			if (boundTexture != m_TextureId) glBindTexture(GL_TEXTURE_2D, boundTexture); //rebind to old texture again
+			GLuint boundTexture = GLState::BindTextureForUpdate(m_TextureId, IsArray()); //bind to this texture, so we can change state
+			glTexParameterfv(m_Target, pName, param); //change state for this texture
+			if (boundTexture != m_TextureId) glBindTexture(m_Target, boundTexture); //rebind to old texture again, only needed untracked
 		}
 	}
 
 	void RenderTexture::Bind(uint32_t slot /*= 0*/)
 	{
-		glActiveTexture(GL_TEXTURE0 + slot);
-		glBindTexture(GL_TEXTURE_2D, m_TextureId);
+		GLState::BindTexture(slot, m_TextureId, IsArray());
 	}
 
 	void RenderTexture::GetInternalFormat(unsigned int textureType, unsigned int targetFormat, int* internalFormat, int *type)
@@ -141,6 +149,56 @@ namespace PhysiCam
 		}
 	}
 
+	void RenderTexture::InitFormatTable()
+	{
+		const unsigned int formats[] = { R3_G3_B2, RGB4, RGB5, RGB8, RGB10, RGB12, RGB16, RGBA2, RGBA4, RGB5_A1, RGBA8, RGB10_A2,
+			RGBA12, RGBA16, R8, R16, RG8, RG16, R16F, R32F, RG16F, RG32F, R8I, R8UI, R16I, R16UI, R32I, R32UI, RG8I, RG8UI,
+			RG16I, RG16UI, RG32I, RG32UI, RGBA32UI, RGB32UI, RGBA16UI, RGB16UI, RGBA8UI, RGB8UI, RGBA32I, RGB32I, RGBA16I,
+			RGB16I, RGBA8I, RGB8I, RGB16F, RGB32F, RGBA16F, RGBA32F, R11F_G11F_B10F, R8_SNORM, RG8_SNORM, RGB8_SNORM,
+			RGBA8_SNORM, R16_SNORM, RG16_SNORM, RGB16_SNORM, RGBA16_SNORM, RGB10_A2UI };
+
+		s_FormatTable.clear();
+		for (unsigned int format : formats)
+		{
+			FormatInfo info;
+			GetInternalFormat(GL_TEXTURE_2D, format, &info.InternalFormat, &info.Type);
+			s_FormatTable[format] = info;
+		}
+	}
+
+	void RenderTexture::LookupFormat(unsigned int targetFormat, int* internalFormat, int *type)
+	{
+		auto it = s_FormatTable.find(targetFormat);
+		if (it == s_FormatTable.end())
+		{
+			GetInternalFormat(GL_TEXTURE_2D, targetFormat, internalFormat, type);
+			return;
+		}
+
+		*internalFormat = it->second.InternalFormat;
+		*type = it->second.Type;
+	}
+
+	unsigned int RenderTexture::GetSizedFormat(unsigned int targetFormat)
+	{
+		switch (targetFormat)
+		{
+		case DEPTH:
+			return GL_DEPTH_COMPONENT24;
+		case DEPTH_STENCIL:
+			return GL_DEPTH24_STENCIL8;
+		case RG:
+		case RG_INTEGER:
+		case COMPRESSED_RED:
+		case COMPRESSED_RG:
+		case COMPRESSED_RGB:
+		case COMPRESSED_RGBA:
+			return 0;
+		default:
+			return targetFormat;
+		}
+	}
+
 	int RenderTexture::GetInternalFormatLegacy(unsigned int targetFormat)
 	{
 		GLint internalFormat;
@@ -225,7 +283,7 @@ namespace PhysiCam
 		{
 			if (GL::HasAnisotropicFiltering)
 			{
-				glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, anisotropy);
+				SetParameterf(GL_TEXTURE_MAX_ANISOTROPY_EXT, anisotropy);
 			}
 			else
 			{
@@ -243,16 +301,6 @@ namespace PhysiCam
 
 	void RenderTexture::GenerateTexture(RenderTexture::Format textureFormat, bool genMipMaps)
 	{
-
-		glGenTextures(1, &m_TextureId);
-		glBindTexture(GL_TEXTURE_2D, m_TextureId);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, genMipMaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, 0x812F);
-		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, 0x812F);
-
 		RenderTexture::Format texIntFrmt = textureFormat;
 		if (textureFormat == RenderTexture::DEPTH || textureFormat ==  RenderTexture::DEPTH_STENCIL)
 		{
@@ -262,11 +310,55 @@ namespace PhysiCam
 			m_Type = GL_UNSIGNED_BYTE;
 		}
 		else
-			GetInternalFormat(GL_TEXTURE_2D, textureFormat, (int*)&texIntFrmt, &m_Type);
-		glTexImage2D(GL_TEXTURE_2D, 0, m_Format, m_Size.x, m_Size.y, 0, texIntFrmt, m_Type, 0);
-		if (genMipMaps)
+			LookupFormat(textureFormat, (int*)&texIntFrmt, &m_Type);
+
+		unsigned int sizedFormat = GL::HasTextureStorage ? GetSizedFormat(textureFormat) : 0;
+		int levels = genMipMaps ? GetMaxMipLevel() + 1 : 1;
+		int minFilter = genMipMaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR;
+
+		if (sizedFormat && GL::HasDirectStateAccess)
 		{
-			glGenerateMipmap(GL_TEXTURE_2D);
+			//immutable storage with the exact mip chain, nothing is bound
+			glCreateTextures(m_Target, 1, &m_TextureId);
+			glTextureParameteri(m_TextureId, GL_TEXTURE_MIN_FILTER, minFilter);
+			glTextureParameteri(m_TextureId, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTextureParameteri(m_TextureId, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTextureParameteri(m_TextureId, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			if (IsArray())
+				glTextureStorage3D(m_TextureId, levels, sizedFormat, m_Size.x, m_Size.y, m_Layers);
+			else
+				glTextureStorage2D(m_TextureId, levels, sizedFormat, m_Size.x, m_Size.y);
+		}
+		else
+		{
+			glGenTextures(1, &m_TextureId);
+			GLState::BindTextureForUpdate(m_TextureId, IsArray());
+
+			glTexParameteri(m_Target, GL_TEXTURE_MIN_FILTER, minFilter);
+			glTexParameteri(m_Target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+			glTexParameterf(m_Target, GL_TEXTURE_WRAP_S, 0x812F);
+			glTexParameterf(m_Target, GL_TEXTURE_WRAP_T, 0x812F);
+
+			if (sizedFormat && IsArray())
+			{
+				glTexStorage3D(m_Target, levels, sizedFormat, m_Size.x, m_Size.y, m_Layers);
+			}
+			else if (sizedFormat)
+			{
+				glTexStorage2D(GL_TEXTURE_2D, levels, sizedFormat, m_Size.x, m_Size.y);
+			}
+			else
+			{
+				if (IsArray())
+					glTexImage3D(m_Target, 0, textureFormat, m_Size.x, m_Size.y, m_Layers, 0, texIntFrmt, m_Type, 0);
+				else
+					glTexImage2D(GL_TEXTURE_2D, 0, textureFormat, m_Size.x, m_Size.y, 0, texIntFrmt, m_Type, 0);
+				if (genMipMaps)
+				{
+					glGenerateMipmap(m_Target);
+				}
+			}
 		}
 
 		m_Format = (RenderTexture::Format)texIntFrmt;
@@ -275,11 +367,24 @@ namespace PhysiCam
 
 	bool RenderTexture::AttachToFramebuffer(unsigned int FramebufferId, unsigned int attachementPoint)
 	{
-		glBindFramebuffer(GL_FRAMEBUFFER, FramebufferId);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, attachementPoint, GL_TEXTURE_2D, m_TextureId, 0);
+		GLenum FBOstatus;
+		if (GL::HasDirectStateAccess)
+		{
+			glNamedFramebufferTexture(FramebufferId, attachementPoint, m_TextureId, 0);
+			FBOstatus = glCheckNamedFramebufferStatus(FramebufferId, GL_FRAMEBUFFER);
+		}
+		else
+		{
+			GLState::BindFramebuffer(GL_FRAMEBUFFER, FramebufferId);
+			if (IsArray())
+				glFramebufferTexture(GL_FRAMEBUFFER, attachementPoint, m_TextureId, 0);
+			else
+				glFramebufferTexture2D(GL_FRAMEBUFFER, attachementPoint, GL_TEXTURE_2D, m_TextureId, 0);
+
+			// check FBO status
+			FBOstatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+		}
 
-		// check FBO status
-		GLenum FBOstatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
 		if (FBOstatus != GL_FRAMEBUFFER_COMPLETE)
 		{
 			std::cerr << "GLError: GL_FRAMEBUFFER_COMPLETE failed, CANNOT use FBO" << std::endl;
@@ -291,8 +396,20 @@ namespace PhysiCam
 	void RenderTexture::GenerateMipMaps()
 	{
 		//glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, m_TextureId);
-		glGenerateMipmap(GL_TEXTURE_2D);
+		GLState::BindTextureForUpdate(m_TextureId, IsArray());
+		glGenerateMipmap(m_Target);
+	}
+
+	int RenderTexture::GetMaxMipLevel()
+	{
+		int size = glm::max(m_Size.x, m_Size.y);
+		int level = 0;
+		while (size > 1)
+		{
+			size >>= 1;
+			level++;
+		}
+		return level;
 	}
 
 }
\ No newline at end of file
@@ -23,28 +23,66 @@
  */
 
 #include <physicam/shader.h>
+#include <physicam/physicam_gl.h>
+#include <physicam/GLState.h>
 #include <fstream>
 #include <streambuf>
 #include <iostream>
+#include <vector>
+#include <cstdint>
+#include <cstdio>
 
 #include <GL/glew.h>
 
+//"PCPB", first word of a program cache file, followed by the binary format and the binary
+#define PC_PROGRAM_CACHE_MAGIC 0x42504350
+
 namespace PhysiCam
 {
+	std::string Shader::s_ProgramCacheDirectory;
+
+	//64 bit FNV-1a, the terminating zero is hashed as well so concatenated strings do not collide
+	static uint64_t HashString(uint64_t hash, const char* str)
+	{
+		do
+		{
+			hash ^= (unsigned char)*str;
+			hash *= 1099511628211ULL;
+		} while (*str++);
+		return hash;
+	}
 	PhysiCam::Shader::~Shader()
 	{
-		glDetachShader(m_ShaderObject, m_VSObject);
-		glDetachShader(m_ShaderObject, m_FSObject);
+		if (m_VSObject) glDetachShader(m_ShaderObject, m_VSObject);
+		if (m_GSObject) glDetachShader(m_ShaderObject, m_GSObject);
+		if (m_FSObject) glDetachShader(m_ShaderObject, m_FSObject);
+		if (m_CSObject) glDetachShader(m_ShaderObject, m_CSObject);
 
 		glDeleteShader(m_FSObject);
 		glDeleteShader(m_VSObject);
+		glDeleteShader(m_GSObject);
+		glDeleteShader(m_CSObject);
 		glDeleteProgram(m_ShaderObject);
 	}
 
-	ShaderPtr PhysiCam::Shader::Create(const std::string& vs, const std::string& fs)
+	ShaderPtr PhysiCam::Shader::Create(const std::string& vs, const std::string& fs, bool deferred /*= false*/)
+	{
+		return Create(vs, "", fs, deferred);
+	}
+
+	ShaderPtr Shader::Create(const std::string& vs, const std::string& gs, const std::string& fs, bool deferred /*= false*/)
 	{
-		
 		ShaderPtr shader = ShaderPtr(new Shader());
+		//without a geometry shader the hash is the same as before, existing cache entries stay valid
+		shader->m_CachePath = GetProgramCachePath(vs + gs, fs);
+		if (!shader->m_CachePath.empty())
+		{
+			shader->m_ShaderObject = LoadProgramBinary(shader->m_CachePath);
+			shader->m_Linked = shader->m_ShaderObject != 0;
+			if (shader->m_Linked)
+				return shader;
+		}
+
 		shader->m_VSObject = glCreateShader(GL_VERTEX_SHADER);
 		shader->m_FSObject = glCreateShader(GL_FRAGMENT_SHADER);
 
@@ -54,32 +92,89 @@ namespace PhysiCam
 		glShaderSource(shader->m_VSObject, 1, filesVS, 0);
 		glShaderSource(shader->m_FSObject, 1, filesFS, 0);
 
+		//no status queries until everything is submitted, each of them would wait for the compiler
 		glCompileShader(shader->m_VSObject);
-		if (!ValidateShader(shader->m_VSObject))
-		{
-			shader.reset();
-			return shader;
-		}
 		glCompileShader(shader->m_FSObject);
-		if (!ValidateShader(shader->m_FSObject))
+		if (!gs.empty())
 		{
-			shader.reset();
-			return shader;
+			GLchar const* filesGS[]{gs.c_str()};
+			shader->m_GSObject = glCreateShader(GL_GEOMETRY_SHADER);
+			glShaderSource(shader->m_GSObject, 1, filesGS, 0);
+			glCompileShader(shader->m_GSObject);
 		}
 		shader->m_ShaderObject = glCreateProgram();
 		glAttachShader(shader->m_ShaderObject, shader->m_FSObject);
 		glAttachShader(shader->m_ShaderObject, shader->m_VSObject);
+		if (shader->m_GSObject)
+			glAttachShader(shader->m_ShaderObject, shader->m_GSObject);
+		if (!shader->m_CachePath.empty())
+			glProgramParameteri(shader->m_ShaderObject, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 
 
 		glLinkProgram(shader->m_ShaderObject);
-		if (!ValidateProgram(shader->m_ShaderObject))
-		{
+		shader->m_Pending = true;
+		if (!deferred && !shader->Finish())
 			shader.reset();
+
+		return shader;
+	}
+
+	ShaderPtr Shader::CreateCompute(const std::string& cs, bool deferred /*= false*/)
+	{
+		ShaderPtr shader = ShaderPtr(new Shader());
+		shader->m_CachePath = GetProgramCachePath(cs, "");
+		if (!shader->m_CachePath.empty())
+		{
+			shader->m_ShaderObject = LoadProgramBinary(shader->m_CachePath);
+			shader->m_Linked = shader->m_ShaderObject != 0;
+			if (shader->m_Linked)
+				return shader;
 		}
 
+		shader->m_CSObject = glCreateShader(GL_COMPUTE_SHADER);
+
+		GLchar const* filesCS[]{cs.c_str()};
+		glShaderSource(shader->m_CSObject, 1, filesCS, 0);
+
+		glCompileShader(shader->m_CSObject);
+		shader->m_ShaderObject = glCreateProgram();
+		glAttachShader(shader->m_ShaderObject, shader->m_CSObject);
+		if (!shader->m_CachePath.empty())
+			glProgramParameteri(shader->m_ShaderObject, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+		glLinkProgram(shader->m_ShaderObject);
+		shader->m_Pending = true;
+		if (!deferred && !shader->Finish())
+			shader.reset();
+
 		return shader;
 	}
 
+	bool Shader::IsCompleted()
+	{
+		if (!m_Pending || !GL::HasParallelShaderCompile)
+			return true;
+
+		GLint completed = GL_FALSE;
+		glGetProgramiv(m_ShaderObject, GL_COMPLETION_STATUS_ARB, &completed);
+		return completed == GL_TRUE;
+	}
+
+	bool Shader::Finish()
+	{
+		if (!m_Pending)
+			return m_Linked;
+
+		m_Pending = false;
+		m_Linked = (!m_VSObject || ValidateShader(m_VSObject)) && (!m_GSObject || ValidateShader(m_GSObject)) &&
+			(!m_FSObject || ValidateShader(m_FSObject)) && (!m_CSObject || ValidateShader(m_CSObject)) &&
+			ValidateProgram(m_ShaderObject);
+
+		if (m_Linked && !m_CachePath.empty())
+			SaveProgramBinary(m_ShaderObject, m_CachePath);
+		return m_Linked;
+	}
+
 	ShaderPtr PhysiCam::Shader::Load(const std::string& vertexShaderPath, const std::string& fragmentShaderPath)
 	{
 		std::cout << "Creating shader from file '" << vertexShaderPath << "' and '" << fragmentShaderPath << "'" << std::endl;
@@ -112,7 +207,9 @@ namespace PhysiCam
 
 	void PhysiCam::Shader::Bind()
 	{
-		glUseProgram(m_ShaderObject);
+		if (m_Pending)
+			Finish();
+		GLState::UseProgram(m_ShaderObject);
 	}
 
 	void PhysiCam::Shader::Reload()
@@ -120,51 +217,86 @@ namespace PhysiCam
 
 	}
 
-	void PhysiCam::Shader::SetParameterf(std::string name, float val)
+	void PhysiCam::Shader::SetParameterf(const std::string& name, float val)
 	{
 		glUniform1f(GetAttributeLocation(name), val);
 	}
 
-	void PhysiCam::Shader::SetParameteri(std::string name, int val)
+	void PhysiCam::Shader::SetParameteri(const std::string& name, int val)
 	{
 		glUniform1i(GetAttributeLocation(name), val);
 	}
 
-	void Shader::SetParameterfv(std::string name, int count, float* val)
+	void Shader::SetParameterfv(const std::string& name, int count, float* val)
 	{
 		glUniform1fv(GetAttributeLocation(name), count, val);
 	}
 
-	void Shader::SetParameteriv(std::string name, int count, int *val)
+	void Shader::SetParameteriv(const std::string& name, int count, int *val)
 	{
 		glUniform1iv(GetAttributeLocation(name), count, val);
 	}
 
-	void PhysiCam::Shader::SetParameterVec2(std::string name,glm::vec2 val)
+	void PhysiCam::Shader::SetParameterVec2(const std::string& name,glm::vec2 val)
 	{
 		glUniform2f(GetAttributeLocation(name), val.x, val.y);
 	}
 
-	void PhysiCam::Shader::SetParameterVec3(std::string name, glm::vec3 val)
+	void Shader::SetParameterIVec2(const std::string& name, glm::ivec2 val)
+	{
+		glUniform2i(GetAttributeLocation(name), val.x, val.y);
+	}
+
+	void PhysiCam::Shader::SetParameterVec3(const std::string& name, glm::vec3 val)
 	{
 		glUniform3f(GetAttributeLocation(name), val.x, val.y, val.z);
 	}
 
-	void PhysiCam::Shader::SetParameterVec4(std::string name, glm::vec4 val)
+	void PhysiCam::Shader::SetParameterVec4(const std::string& name, glm::vec4 val)
 	{
 		glUniform4f(GetAttributeLocation(name), val.x, val.y, val.z, val.w);
 	}
 
-	void PhysiCam::Shader::SetParameterMat3(std::string name, glm::mat3 val)
+	void PhysiCam::Shader::SetParameterMat3(const std::string& name, glm::mat3 val)
 	{
 		glUniformMatrix3fv(GetAttributeLocation(name), 1, GL_FALSE, glm::value_ptr(val));
 	}
 
-	void PhysiCam::Shader::SetParameterMat4(std::string name, glm::mat4 val)
+	void PhysiCam::Shader::SetParameterMat4(const std::string& name, glm::mat4 val)
 	{
 		glUniformMatrix4fv(GetAttributeLocation(name), 1, GL_FALSE, glm::value_ptr(val));
 	}
 
+	int Shader::GetUniformLocation(const char* name)
+	{
+		return glGetUniformLocation(m_ShaderObject, name);
+	}
+
+	void Shader::SetParameterf(int location, float val)
+	{
+		glUniform1f(location, val);
+	}
+
+	void Shader::SetParameteri(int location, int val)
+	{
+		glUniform1i(location, val);
+	}
+
+	void Shader::SetParameterVec2(int location, glm::vec2 val)
+	{
+		glUniform2f(location, val.x, val.y);
+	}
+
+	void Shader::SetParameterIVec2(int location, glm::ivec2 val)
+	{
+		glUniform2i(location, val.x, val.y);
+	}
+
+	void Shader::SetParameterVec4(int location, glm::vec4 val)
+	{
+		glUniform4f(location, val.x, val.y, val.z, val.w);
+	}
+
 	void PhysiCam::Shader::BindAttributeLocation(unsigned int id, const std::string &name)
 	{
 		glBindAttribLocation(m_ShaderObject, id, name.c_str());
@@ -183,7 +315,7 @@ namespace PhysiCam
 	}
 
 
-	PhysiCam::Shader::Shader()
+	PhysiCam::Shader::Shader() : m_ShaderObject(0), m_VSObject(0), m_GSObject(0), m_FSObject(0), m_CSObject(0), m_Pending(false), m_Linked(false)
 	{}
 
 	bool Shader::ValidateShader(unsigned int shader, const char* file /*= 0*/)
@@ -220,34 +352,112 @@ namespace PhysiCam
 		GLint loc = glGetUniformLocation(program, "ShadowTexture");
 		if (loc != -1)
 		{
-			glUseProgram(program);
+			GLState::UseProgram(program);
 			glUniform1i(loc, 7);
-			glUseProgram(0);
+			GLState::UseProgram(0);
 		}
 
-		glValidateProgram(program);
+		//glValidateProgram checks the program against the current state, which is meaningless at creation
+		//and expensive. only the link status is checked
 		GLint status;
-		glGetProgramiv(program, GL_VALIDATE_STATUS, &status);
+		glGetProgramiv(program, GL_LINK_STATUS, &status);
 		if (status == GL_FALSE)
 		{
-			std::cerr << "Error validating shader " << program << std::endl;
+			std::cerr << "Error linking shader " << program << std::endl;
 
 			glGetProgramInfoLog(program, BUFFER_SIZE, &length, buffer);
 			if (length > 0)
 			{
 				std::cerr << "Program " << program << " link error: " << buffer << std::endl;
 			}
-			//return false;
+			return false;
 		}
 
 
 		return true;
 	}
 
+	std::string Shader::GetProgramCachePath(const std::string& vs, const std::string& fs)
+	{
+		if (s_ProgramCacheDirectory.empty() || !GL::HasProgramBinary)
+			return "";
+
+		//variant defines are part of the sources, binaries are only valid for the driver that created them
+		uint64_t hash = 14695981039346656037ULL;
+		hash = HashString(hash, vs.c_str());
+		hash = HashString(hash, fs.c_str());
+		hash = HashString(hash, (const char*)glGetString(GL_VENDOR));
+		hash = HashString(hash, (const char*)glGetString(GL_RENDERER));
+		hash = HashString(hash, (const char*)glGetString(GL_VERSION));
+
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)hash);
+		return s_ProgramCacheDirectory + "/" + name;
+	}
+
+	unsigned int Shader::LoadProgramBinary(const std::string& path)
+	{
+		std::ifstream file(path, std::ios::in | std::ios::binary);
+		if (!file.is_open())
+			return 0;
+
+		unsigned int header[2] = { 0, 0 };
+		file.read((char*)header, sizeof(header));
+		if (!file || header[0] != PC_PROGRAM_CACHE_MAGIC)
+			return 0;
+
+		std::vector<char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		if (binary.empty())
+			return 0;
+
+		GLuint program = glCreateProgram();
+		glProgramBinary(program, header[1], &binary[0], (GLsizei)binary.size());
+
+		//rejected after driver updates or for truncated files, the caller compiles and overwrites the entry
+		GLint status = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &status);
+		if (status != GL_TRUE)
+		{
+			glDeleteProgram(program);
+			return 0;
+		}
+		return program;
+	}
+
+	void Shader::SaveProgramBinary(unsigned int program, const std::string& path)
+	{
+		GLint length = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0)
+			return;
+
+		std::vector<char> binary(length);
+		GLenum format = 0;
+		glGetProgramBinary(program, length, 0, &format, &binary[0]);
+
+		std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			std::cerr << "Unable to write program cache file '" << path << "'" << std::endl;
+			return;
+		}
+
+		unsigned int header[2] = { PC_PROGRAM_CACHE_MAGIC, format };
+		file.write((const char*)header, sizeof(header));
+		file.write(&binary[0], binary.size());
+	}
+
 	void Shader::BindFragdataLocation(unsigned int colorId, const std::string &name)
 	{
 		glBindFragDataLocation(m_ShaderObject, colorId, name.c_str());
 	}
 
+	void Shader::SetUniformBlockBinding(const std::string &name, unsigned int binding)
+	{
+		GLuint index = glGetUniformBlockIndex(m_ShaderObject, name.c_str());
+		if (index != GL_INVALID_INDEX)
+			glUniformBlockBinding(m_ShaderObject, index, binding);
+	}
+
 }
 
@@ -45,19 +45,233 @@ namespace PhysiCam
 	};
 	)";
 
+	//layered rendering: the fullscreen quad is drawn once per layer (instanced), the geometry shader routes instance i to layer i
+	const static std::string LayeredVertSrc = R"(
+	
+	#version 400
+	layout(location = 0) in vec3 vertexPosition;
+	layout(location = 2) in vec2 vertexUV;
+
+	out vec2 vertexTexCoord;
+	flat out int vertexLayer;
+
+	void main(void)
+	{
+		vertexTexCoord = vertexUV;
+		vertexLayer = gl_InstanceID;
+		gl_Position = vec4(vertexPosition, 1);
+	};
+	)";
+
+	const static std::string LayeredGeomSrc = R"(
+	
+	#version 400
+	layout(triangles) in;
+	layout(triangle_strip, max_vertices = 3) out;
+
+	in vec2 vertexTexCoord[];
+	flat in int vertexLayer[];
+
+	out vec2 texCoord;
+	flat out int vLayer;
+
+	void main(void)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			texCoord = vertexTexCoord[i];
+			vLayer = vertexLayer[i];
+			gl_Layer = vertexLayer[i];
+			gl_Position = gl_in[i].gl_Position;
+			EmitVertex();
+		}
+		EndPrimitive();
+	};
+	)";
+
+	/*
+	* Layered variants of the effect shaders (stereo and multi-view cameras) are compiled with PC_LAYERED and PC_LAYER,
+	* the layer of the fragment or invocation. The samplers and images become arrays and the sampling functions are
+	* redirected to that layer, so the effect code is the same for both. Samplers that stay 2D are declared and
+	* sampled in front of this block.
+	*/
+	const static std::string LayerBlockSrc = R"(
+		#ifdef PC_LAYERED
+		#define PC_SAMPLER2D sampler2DArray
+		#define PC_IMAGE2D image2DArray
+		#define texture(s, uv) texture(s, vec3(uv, PC_LAYER))
+		#define texture2D(s, uv) texture(s, uv)
+		#define textureLod(s, uv, lod) textureLod(s, vec3(uv, PC_LAYER), lod)
+		#define texelFetch(s, p, lod) texelFetch(s, ivec3(p, PC_LAYER), lod)
+		#define textureSize(s, lod) textureSize(s, lod).xy
+		#define imageStore(i, p, data) imageStore(i, ivec3(p, PC_LAYER), data)
+		#define imageSize(i) imageSize(i).xy
+		#define PC_VIEW PC_LAYER
+		#else
+		#define PC_SAMPLER2D sampler2D
+		#define PC_IMAGE2D image2D
+		#define PC_VIEW 0
+		#endif
+	)";
+
+	/*
+	* Per frame parameter blocks, written once per frame into the uniform ring buffer.
+	* The layouts have to match the structs in PostProcessing.cpp.
+	*/
+	const static std::string ExposureSettingsBlockSrc = R"(
+		layout(std140) uniform ExposureSettingsBlock
+		{
+			float exposure;
+			bool useExposureBuffer;
+		};
+	)";
+
+	const static std::string ToneMappingBlockSrc = R"(
+		layout(std140) uniform ToneMappingBlock
+		{
+			vec2 outputSize;
+			float timer;
+			float grainamount;
+			int tonemappingMethod;
+		};
+	)";
+
+	const static std::string LensBlockSrc = R"(
+		layout(std140) uniform LensBlock
+		{
+			vec3 ChromaticDistortionVector;
+			float k;
+			vec2 screenSize;
+			float HaloWidth;
+		};
+	)";
+
+	const static std::string BloomBlockSrc = R"(
+		layout(std140) uniform BloomBlock
+		{
+			float strengths[5];
+			float threshold;
+			float LenseFlareThreshold;
+			float intensity;
+			float strength;
+			int hasDirtTexture;
+		};
+	)";
+
+	const static std::string DoFBlockSrc = R"(
+		layout(std140) uniform DoFBlock
+		{
+			vec2 ScreenSize;
+			vec2 CameraClips;
+			float focalDepth;  //focal distance value in meters, but you may use autofocus option below
+			float focalLength; //focal length in mm
+			float fstop; //f-stop value
+			float CoC; //circle of confusion size in mm (35mm film = 0.03mm)
+			float fringe; //bokeh chromatic aberration/fringing
+			float maxblur; //clamp value of max blur (0.0 = no blur,1.0 default)
+			bool autofocus;
+			bool vignetting;
+			bool showFocus; //show debug focus point and focal range (red = focal point, green = focal range)
+			bool useFocusBuffer; //focus distance of the gpu autofocus, see DoFAutofocusSrc
+			float gatherScale; //resolution of the tiled DoF gather relative to the screen
+			float noiseSeed; //changes every frame while TAA accumulates the samples, 0 otherwise
+			int ringSamples; //samples on the first ring of the per pixel DoF
+		};
+	)";
+
+	const static std::string ReprojectionBlockSrc = R"(
+		#define MAX_VIEWS 4
+		layout(std140) uniform ReprojectionBlock
+		{
+			mat4 Reprojection[MAX_VIEWS]; //clip space of this frame to the previous one, per view and without jitter
+			bool useMotionVectors;
+		};
+	)";
+
+	const static std::string TAABlockSrc = R"(
+		layout(std140) uniform TAABlock
+		{
+			float feedback; //weight of the history
+			bool historyValid;
+		};
+	)";
+
+	const static std::string MotionBlurBlockSrc = R"(
+		layout(std140) uniform MotionBlurBlock
+		{
+			vec2 cameraClips;
+			float velocityScale; //shutter time relative to the frame time
+			float maxRadius; //in pixels, at most the tile size
+			int sampleCount;
+		};
+	)";
+
+	const static std::string MeteringBlockSrc = R"(
+		layout(std140) uniform MeteringBlock
+		{
+			vec2 logLuminanceRange; //x = min log2 luminance, y = max log2 luminance
+			vec2 meteringPoint;
+			vec2 percentiles; //fraction of the weighted samples clipped at the dark and the bright end
+			vec2 apertureRange; //camera limits used by the program auto mode
+			vec2 isoRange;
+			vec2 shutterRange; //x = fastest, y = slowest
+			ivec2 gridSize;
+			int meteringMode;
+			float spotRadius;
+			float aspect;
+			float highlightBias; //EV the metered value is placed above middle grey
+			float deltaTime;
+			float adaptionSpeed;
+			float exposureCompensation;
+			float focalLength;
+		};
+	)";
+
+	const static std::string AutofocusBlockSrc = R"(
+		layout(std140) uniform AutofocusBlock
+		{
+			vec4 region;		//lower left and upper right corner in texture coordinates
+			int levels;
+			int mode;			//0 = single point, 1 = zone, 2 = rectangle
+			float focusSpeed;	//1/s, 0 = instant
+			float deltaTime;	//s
+		};
+	)";
+
+	/*
+	* Point-wise stages. They only depend on the color of the current pixel, so they are
+	* used by their own passes and get appended to other passes when pass fusion is enabled.
+	*/
+	const static std::string ExposureStageSrc = ExposureSettingsBlockSrc + R"(
+
+		//written by the auto exposure compute pass (see LuminanceAverageSrc)
+		layout(std140) uniform ExposureBlock
+		{
+			vec4 Luminance;
+			vec4 Settings;
+		};
+
+		vec3 ExposureStage(vec3 hdr)
+		{
+			float e = useExposureBuffer ? Luminance.w : exposure;
+			return hdr * e;
+		}
+
+	)";
+
 	const static std::string BlitScreenSrc = R"(
 
 		#version 400
-		uniform sampler2D tex;
-		uniform float exp;
+	)" + LayerBlockSrc + R"(
+		uniform PC_SAMPLER2D tex;
 
 		in vec2 texCoord;
 
 		out vec4 colorOut;
-		
+	)" + ExposureStageSrc + R"(
 		void main(void)
 		{
-			colorOut = vec4(texture(tex,texCoord).xyz  * exp, 1);
+			colorOut = vec4(ExposureStage(texture(tex,texCoord).xyz), 1);
 		};
 
 	)";
@@ -72,15 +286,19 @@ namespace PhysiCam
 		*/
 
 		#version 400
-		uniform sampler2D tex;
-		uniform sampler2D depth;
-		uniform float k = 0.3;
+	)" + LayerBlockSrc + R"(
+		#ifndef PC_FUSED_OUTPUT
+		#define PC_FUSED_OUTPUT(c) (c)
+		#endif
+
+		uniform PC_SAMPLER2D tex;
+		uniform PC_SAMPLER2D depth;
 		//uniform float kcube = 0.5;
 		uniform float scale = 0.9;
 		uniform float dispersion = 0.01;
 		uniform float blurAmount = 0.5; //k = 0.2, kcube = 0.3, scale = 0.9, dispersion = 0.01
 		uniform bool blurEnabled = false;
-		uniform vec2 screenSize;
+	)" + LensBlockSrc + R"(
 
 		in vec2 texCoord;
 
@@ -121,7 +339,7 @@ namespace PhysiCam
 			inputDistort.g = texture(tex,gCoords).g;
 			inputDistort.b = texture(tex,bCoords).b;
 			
-			colorOut = vec4(inputDistort.r,inputDistort.g,inputDistort.b,1.0);
+			colorOut = PC_FUSED_OUTPUT(vec4(inputDistort.r,inputDistort.g,inputDistort.b,1.0));
 			depthOut = vec4(texture(depth, rCoords).r);
 		};
 
@@ -130,7 +348,8 @@ namespace PhysiCam
 	const static std::string DownsampleScreenSrc = R"(
 
 		#version 400
-		uniform sampler2D tex;
+	)" + LayerBlockSrc + R"(
+		uniform PC_SAMPLER2D tex;
 		in vec2 texCoord;
 
 		out vec4 colorOut;
@@ -142,110 +361,200 @@ namespace PhysiCam
 
 	)";
 
-	const static std::string BrightPassSrc = R"(
-		
-		#version 400
+	const static std::string LuminanceHistogramSrc = R"(
 
-		uniform sampler2D tex;
-		uniform float threshold;
-		uniform float LenseFlareThreshold;
-		uniform float exp;
+		#version 430
+	)" + LayerBlockSrc + R"(
+		#define HISTOGRAM_BINS 256
+		#define WEIGHT_SCALE 256.0
 
-		in vec2 texCoord;
-	
-		layout(location = 0) out vec4 BrightColor;
-		layout(location = 1) out vec4 LenseFlareBrightColor;
+		//one invocation per grid cell, 16x16 = HISTOGRAM_BINS invocations per workgroup
+		layout(local_size_x = 16, local_size_y = 16) in;
+
+		layout(std430, binding = 0) buffer HistogramBuffer
+		{
+			uint bins[HISTOGRAM_BINS];
+		};
+
+		uniform PC_SAMPLER2D tex;
+	)" + MeteringBlockSrc + R"(
+
+		shared uint localBins[HISTOGRAM_BINS];
+
+		float meteringWeight(vec2 uv)
+		{
+			vec2 d = (uv - meteringPoint) * vec2(aspect, 1.0);
+			float r = length(d);
+			switch(meteringMode)
+			{
+				case 1: //center weighted, gaussian falloff around the metering point
+					return exp(-r * r * 8.0);
+				case 2: //spot, only the circle around the metering point
+					return r < spotRadius ? 1.0 : 0.0;
+				default: //matrix and highlight protect, whole frame with a slight center bias
+					return 1.0 - 0.5 * smoothstep(0.0, 0.7, r);
+			}
+		}
+
+		uint luminanceBin(float lum)
+		{
+			//bin 0 is reserved for black pixels
+			if (lum < 0.00001)
+				return 0;
+
+			float t = clamp((log2(lum) - logLuminanceRange.x) / (logLuminanceRange.y - logLuminanceRange.x), 0.0, 1.0);
+			return uint(t * float(HISTOGRAM_BINS - 2) + 1.0);
+		}
 
 		void main(void)
 		{
-			vec4 color = vec4(texture(tex,texCoord).xyz,1);
-			float luminance = (0.2126f*color.x + 0.7152f*color.y + 0.0722f*color.z);
+			localBins[gl_LocalInvocationIndex] = 0;
+			barrier();
 
-			if(luminance > threshold)
-				BrightColor = color;
-			else
-				BrightColor = vec4(0,0,0,1);
+			ivec2 cell = ivec2(gl_GlobalInvocationID.xy);
+			if (all(lessThan(cell, gridSize)))
+			{
+				vec2 uv = (vec2(cell) + 0.5) / vec2(gridSize);
+				vec3 col = textureLod(tex, uv, 0.0).rgb;
+
+				//relative luminance: https://en.wikipedia.org/wiki/Relative_luminance
+				float lum = dot(col, vec3(0.2126, 0.7152, 0.0722));
+				uint weight = uint(meteringWeight(uv) * WEIGHT_SCALE + 0.5);
+				if (weight > 0)
+					atomicAdd(localBins[luminanceBin(lum)], weight);
+			}
+			barrier();
 
-			if(luminance > LenseFlareThreshold)
-				LenseFlareBrightColor = color  / (LenseFlareThreshold-1);
-			else
-				LenseFlareBrightColor = vec4(0,0,0,1);
+			//merge the workgroup histogram into the global one, one bin per invocation
+			uint count = localBins[gl_LocalInvocationIndex];
+			if (count > 0)
+				atomicAdd(bins[gl_LocalInvocationIndex], count);
 		};
 
 	)";
 
-	const static std::string BlurHorizontalSrc = R"(
-		
-		#version 400
+	const static std::string LuminanceAverageSrc = R"(
 
-		uniform sampler2D tex;
-		uniform float radius;
-		uniform float resolution;
+		#version 430
+		#define HISTOGRAM_BINS 256
 
-		in vec2 texCoord;
+		layout(local_size_x = HISTOGRAM_BINS) in;
 
-		out vec4 colorOut;
+		layout(std430, binding = 0) buffer HistogramBuffer
+		{
+			uint bins[HISTOGRAM_BINS];
+		};
+
+		//same layout as the std140 ExposureBlock used by the fragment shaders
+		layout(std430, binding = 1) buffer ExposureBuffer
+		{
+			vec4 Luminance; //x = metered luminance, y = adapted luminance, z = target EV, w = exposure
+			vec4 Settings;	//x = aperture, y = shutter speed, z = iso
+		};
+
+	)" + MeteringBlockSrc + R"(
+
+		shared float weights[HISTOGRAM_BINS];
+
+		float binLogLuminance(int i)
+		{
+			if (i == 0)
+				return logLuminanceRange.x;
+			float t = (float(i) - 0.5) / float(HISTOGRAM_BINS - 2);
+			return logLuminanceRange.x + t * (logLuminanceRange.y - logLuminanceRange.x);
+		}
+
+		float computeEV(float aperture, float shutterSpeed, float iso)
+		{
+			return log2((aperture * aperture * 100.0) / (shutterSpeed * iso));
+		}
 
 		void main(void)
 		{
-			//our original texcoord for this fragment
-		    vec2 tc = texCoord;
+			uint idx = gl_LocalInvocationIndex;
+			weights[idx] = float(bins[idx]);
+			bins[idx] = 0; //clear for the next frame
+			barrier();
+
+			if (idx != 0)
+				return;
+
+			float total = 0.0;
+			for (int i = 0; i < HISTOGRAM_BINS; i++)
+				total += weights[i];
+
+			if (total <= 0.0) //nothing metered (i.e. spot outside of the screen), keep the last result
+				return;
+
+			//average of the log luminance between the low and high percentile
+			float lowCut = total * percentiles.x;
+			float highCut = total * percentiles.y;
+			float cumulative = 0.0;
+			float logSum = 0.0;
+			float weightSum = 0.0;
+			for (int i = 0; i < HISTOGRAM_BINS; i++)
+			{
+				float w = clamp(cumulative + weights[i], lowCut, highCut) - clamp(cumulative, lowCut, highCut);
+				logSum += w * binLogLuminance(i);
+				weightSum += w;
+				cumulative += weights[i];
+			}
+			float lum = exp2(logSum / max(weightSum, 0.0001));
 
-			//the amount to blur, i.e. how far off center to sample from
-			float blur = radius/resolution; 
+			//eye adaption, same as the lerp of the cpu path
+			float prev = Luminance.y;
+			float adapted = prev > 0.0 ? mix(prev, lum, clamp(adaptionSpeed * deltaTime, 0.0, 1.0)) : lum;
 
-			vec4 sum = vec4(0.0);
+			// light metering equation, K = 12.5 is the light meter calibration constant
+			float targetEV = log2(adapted * 100.0 / 12.5) - highlightBias + exposureCompensation;
 
-			//apply blurring, using a 9-tap filter with predefined gaussian weights
-			sum += texture2D(tex, vec2(tc.x - 4.0*blur, tc.y)) * 0.0162162162;
-			sum += texture2D(tex, vec2(tc.x - 3.0*blur, tc.y)) * 0.0540540541;
-			sum += texture2D(tex, vec2(tc.x - 2.0*blur, tc.y)) * 0.1216216216;
-			sum += texture2D(tex, vec2(tc.x - 1.0*blur, tc.y)) * 0.1945945946;
-			sum += texture2D(tex, vec2(tc.x, tc.y)) * 0.2270270270;
-			sum += texture2D(tex, vec2(tc.x + 1.0*blur, tc.y)) * 0.1945945946;
-			sum += texture2D(tex, vec2(tc.x + 2.0*blur, tc.y)) * 0.1216216216;
-			sum += texture2D(tex, vec2(tc.x + 3.0*blur, tc.y)) * 0.0540540541;
-			sum += texture2D(tex, vec2(tc.x + 4.0*blur, tc.y)) * 0.0162162162;
+			//program auto, same as Camera::ApplyProgramAuto
+			float aperture = 4.0;
+			float shutter = 1.0 / focalLength;
+			float iso = clamp((aperture * aperture * 100.0) / (shutter * exp2(targetEV)), isoRange.x, isoRange.y);
 
-			colorOut = vec4(sum.xyz,1);
+			float evDiff = targetEV - computeEV(aperture, shutter, iso);
+			aperture = clamp(aperture * pow(sqrt(2.0), evDiff * 0.5), apertureRange.x, apertureRange.y);
+
+			evDiff = targetEV - computeEV(aperture, shutter, iso);
+			shutter = clamp(shutter * exp2(-evDiff), shutterRange.x, shutterRange.y);
+
+			//standard output based exposure with middle grey 0.18
+			float exposure = 0.18 / ((1000.0 / 65.0) * aperture * aperture / (iso * shutter));
+
+			Luminance = vec4(lum, adapted, targetEV, exposure);
+			Settings = vec4(aperture, shutter, iso, 0.0);
 		};
 
 	)";
 
-	const static std::string BlurVerticalSrc = R"(
+	const static std::string BrightPassSrc = R"(
 		
 		#version 400
+	)" + LayerBlockSrc + R"(
 
-		uniform sampler2D tex;
-		uniform float radius;
-		uniform float resolution;
+		uniform PC_SAMPLER2D tex;
+	)" + BloomBlockSrc + R"(
 
 		in vec2 texCoord;
-
-		out vec4 colorOut;
+	
+		layout(location = 0) out vec4 BrightColor;
+		layout(location = 1) out vec4 LenseFlareBrightColor;
 
 		void main(void)
 		{
-			//our original texcoord for this fragment
-		    vec2 tc = texCoord;
-
-			//the amount to blur, i.e. how far off center to sample from
-			float blur = radius/resolution; 
-
-			vec4 sum = vec4(0.0);
+			vec4 color = vec4(texture(tex,texCoord).xyz,1);
+			float luminance = (0.2126f*color.x + 0.7152f*color.y + 0.0722f*color.z);
 
-			//apply blurring, using a 9-tap filter with predefined gaussian weights
-			sum += texture2D(tex, vec2(tc.x, tc.y - 4.0*blur)) * 0.0162162162;
-			sum += texture2D(tex, vec2(tc.x, tc.y - 3.0*blur)) * 0.0540540541;
-			sum += texture2D(tex, vec2(tc.x, tc.y - 2.0*blur)) * 0.1216216216;
-			sum += texture2D(tex, vec2(tc.x, tc.y - 1.0*blur)) * 0.1945945946;
-			sum += texture2D(tex, vec2(tc.x, tc.y)) * 0.2270270270;
-			sum += texture2D(tex, vec2(tc.x, tc.y + 1.0*blur)) * 0.1945945946;
-			sum += texture2D(tex, vec2(tc.x, tc.y + 2.0*blur)) * 0.1216216216;
-			sum += texture2D(tex, vec2(tc.x, tc.y + 3.0*blur)) * 0.0540540541;
-			sum += texture2D(tex, vec2(tc.x, tc.y + 4.0*blur)) * 0.0162162162;
+			if(luminance > threshold)
+				BrightColor = color;
+			else
+				BrightColor = vec4(0,0,0,1);
 
-			colorOut = vec4(sum.xyz,1);
+			if(luminance > LenseFlareThreshold)
+				LenseFlareBrightColor = color  / (LenseFlareThreshold-1);
+			else
+				LenseFlareBrightColor = vec4(0,0,0,1);
 		};
 
 	)";
@@ -253,9 +562,10 @@ namespace PhysiCam
 	const static std::string IncrGaussBlurSrc = R"(
 		
 		#version 400
+	)" + LayerBlockSrc + R"(
 		#define MAX_BLUR_RADIUS 4096
 
-		uniform sampler2D tex;
+		uniform PC_SAMPLER2D tex;
 		uniform float radius;
 		uniform vec2 uBlurDirection;	// (1,0)/(0,1) for x/y pass
 		uniform vec2 resolution;
@@ -268,7 +578,7 @@ namespace PhysiCam
 		/*	Incremental, forward-differencing Gaussian elimination based on:
 			http://http.developer.nvidia.com/GPUGems3/gpugems3_ch40.html */
 		vec4 incrementalGauss1D(
-			in sampler2D srcTex, 
+			in PC_SAMPLER2D srcTex, 
 			in vec2 srcTexelSize, 
 			in vec2 origin,
 			in float radius,
@@ -312,13 +622,177 @@ namespace PhysiCam
 
 	)";
 
+	const static std::string LinearGaussBlurSrc = R"(
+		
+		#version 400
+	)" + LayerBlockSrc + R"(
+		#define MAX_TAPS 33
+		#define LEVELS 5
+
+		uniform PC_SAMPLER2D tex;
+		uniform vec2 uBlurDirection;	// (1,0)/(0,1) for x/y pass
+		uniform vec2 resolution;
+		uniform int level;
+
+		//per bloom level: x = offset in texels, y = weight. the first tap is the center
+		layout(std140) uniform BloomKernelBlock
+		{
+			vec4 taps[LEVELS * MAX_TAPS];
+			ivec4 tapCounts[LEVELS];
+		};
+
+		in vec2 texCoord;
+
+		out vec4 colorOut;
+
+		void main(void)
+		{
+			vec2 texelStep = uBlurDirection / resolution;
+			int base = level * MAX_TAPS;
+
+			//every tap lands between two texels of the incremental gaussian, the bilinear filter weights them
+			vec4 result = texture(tex, texCoord) * taps[base].y;
+			for (int i = 1; i < tapCounts[level].x; ++i)
+			{
+				vec2 offset = taps[base + i].x * texelStep;
+				result += texture(tex, texCoord - offset) * taps[base + i].y;
+				result += texture(tex, texCoord + offset) * taps[base + i].y;
+			}
+
+			colorOut = result;
+		};
+
+	)";
+
+	//dual filter, see Bjorge "Bandwidth-Efficient Rendering" (Siggraph 2015)
+	const static std::string DualKawaseDownSrc = R"(
+		
+		#version 400
+	)" + LayerBlockSrc + R"(
+
+		uniform PC_SAMPLER2D tex;
+		uniform vec2 halfPixel;	//of the output
+
+		in vec2 texCoord;
+
+		out vec4 colorOut;
+
+		void main(void)
+		{
+			vec4 sum = texture(tex, texCoord) * 4.0;
+			sum += texture(tex, texCoord - halfPixel);
+			sum += texture(tex, texCoord + halfPixel);
+			sum += texture(tex, texCoord + vec2(halfPixel.x, -halfPixel.y));
+			sum += texture(tex, texCoord - vec2(halfPixel.x, -halfPixel.y));
+			colorOut = sum / 8.0;
+		};
+
+	)";
+
+	const static std::string DualKawaseUpSrc = R"(
+		
+		#version 400
+	)" + LayerBlockSrc + R"(
+
+		uniform PC_SAMPLER2D tex;	//downsampled level
+		uniform PC_SAMPLER2D chain;	//upsample chain at the same level
+		uniform vec2 halfPixel;	//of the output, scaled by the tap offset
+		uniform float levelWeight;
+		uniform int hasChain;
+
+		in vec2 texCoord;
+
+		out vec4 colorOut;
+
+		//the weight and the chain are the same for all pixels, a texture is only fetched if it contributes
+		vec4 tap(vec2 uv)
+		{
+			vec4 sum = vec4(0.0);
+			if (levelWeight > 0.0)
+				sum = texture(tex, uv) * levelWeight;
+			if (hasChain != 0)
+				sum += texture(chain, uv);
+			return sum;
+		}
+
+		void main(void)
+		{
+			vec4 sum = tap(texCoord + vec2(-halfPixel.x * 2.0, 0.0));
+			sum += tap(texCoord + vec2(-halfPixel.x, halfPixel.y)) * 2.0;
+			sum += tap(texCoord + vec2(0.0, halfPixel.y * 2.0));
+			sum += tap(texCoord + vec2(halfPixel.x, halfPixel.y)) * 2.0;
+			sum += tap(texCoord + vec2(halfPixel.x * 2.0, 0.0));
+			sum += tap(texCoord + vec2(halfPixel.x, -halfPixel.y)) * 2.0;
+			sum += tap(texCoord + vec2(0.0, -halfPixel.y * 2.0));
+			sum += tap(texCoord + vec2(-halfPixel.x, -halfPixel.y)) * 2.0;
+			colorOut = sum / 12.0;
+		};
+
+	)";
+
+	const static std::string BloomBlurComputeSrc = R"(
+
+		#version 430
+	)" + LayerBlockSrc + R"(
+		#define TILE_SIZE 256
+		#define MAX_APRON 64
+		#ifndef IMAGE_FORMAT
+		#define IMAGE_FORMAT rgba32f
+		#endif
+
+		//one segment of TILE_SIZE pixels of a row (or column) per workgroup, every tap is read from shared memory
+		layout(local_size_x = TILE_SIZE) in;
+
+		uniform PC_SAMPLER2D tex;
+		layout(IMAGE_FORMAT) uniform writeonly PC_IMAGE2D outputImage;
+		uniform ivec2 resolution; //of the output image
+		uniform float radius;
+		uniform bool vertical;
+
+		shared vec4 cache[TILE_SIZE + 2 * MAX_APRON];
+		shared float weights[MAX_APRON + 1];
+
+		void main(void)
+		{
+			//same taps and weights as the incremental gaussian of IncrGaussBlurSrc
+			int nSamples = clamp(int(radius), 1, 2 * (MAX_APRON + 1)) / 2;
+			int apron = max(nSamples - 1, 0);
+			float sigma = radius / 8.0;
+
+			int lid = int(gl_LocalInvocationID.x);
+			ivec2 dir = vertical ? ivec2(0, 1) : ivec2(1, 0);
+			ivec2 start = vertical ? ivec2(gl_WorkGroupID.y, gl_WorkGroupID.x * TILE_SIZE) : ivec2(gl_WorkGroupID.x * TILE_SIZE, gl_WorkGroupID.y);
+
+			//load tile and apron once, sampled at the output pixel centers like the fragment pass
+			for (int i = lid; i < TILE_SIZE + 2 * apron; i += TILE_SIZE)
+			{
+				vec2 p = vec2(start + dir * (i - apron)) + 0.5;
+				cache[i] = textureLod(tex, p / vec2(resolution), 0.0);
+			}
+			if (lid <= apron)
+				weights[lid] = nSamples == 0 ? 1.0 : exp(-0.5 * float(lid * lid) / (sigma * sigma)) / (sqrt(6.2831853071795) * sigma);
+			barrier();
+
+			ivec2 pixel = start + dir * lid;
+			if (any(greaterThanEqual(pixel, resolution)))
+				return;
+
+			vec4 result = cache[lid + apron] * weights[0];
+			for (int i = 1; i < nSamples; ++i)
+				result += (cache[lid + apron - i] + cache[lid + apron + i]) * weights[i];
+
+			imageStore(outputImage, pixel, result);
+		}
+
+	)";
+
 	const static std::string BloomComposeSrc = R"(
 		
 		#version 400
+	)" + LayerBlockSrc + R"(
 
-		uniform sampler2D tex[5];
-		uniform float strengths[5];
-		uniform float intensity;
+		uniform PC_SAMPLER2D tex[5];
+	)" + BloomBlockSrc + R"(
 
 		in vec2 texCoord;
 
@@ -341,14 +815,21 @@ namespace PhysiCam
 	const static std::string BloomLenseComposeSrc = R"(
 		
 		#version 400
+		#ifndef PC_FUSED_OUTPUT
+		#define PC_FUSED_OUTPUT(c) (c)
+		#endif
 
-		uniform sampler2D bloomPass;
-		uniform sampler2D lenseFlare;
-		uniform sampler2D baseTex;
+		//the dirt texture is 2D for all views
 		uniform sampler2D dirtTexture;
-
-		uniform int hasDirtTexture;
-		uniform float strength;
+		vec4 dirt(vec2 uv)
+		{
+			return texture(dirtTexture, uv);
+		}
+	)" + LayerBlockSrc + R"(
+		uniform PC_SAMPLER2D bloomPass;
+		uniform PC_SAMPLER2D lenseFlare;
+		uniform PC_SAMPLER2D baseTex;
+	)" + BloomBlockSrc + R"(
 
 		in vec2 texCoord;
 
@@ -362,12 +843,12 @@ namespace PhysiCam
 
 			if(hasDirtTexture > 0)
 			{
-				vec4 dirt = texture(dirtTexture, texCoord);
-				bloom *= dirt;
-				lense *= dirt;
+				vec4 dirtColor = dirt(texCoord);
+				bloom *= dirtColor;
+				lense *= dirtColor;
 			}
 			
-			colorOut = vec4(bloom.xyz+lense.xyz+base.xyz,1);
+			colorOut = PC_FUSED_OUTPUT(vec4(bloom.xyz+lense.xyz+base.xyz,1));
 		};
 
 	)";
@@ -376,11 +857,10 @@ namespace PhysiCam
 	const static std::string LenseFlareSrc = R"(
 		
 		#version 400
+	)" + LayerBlockSrc + R"(
 
-		uniform sampler2D tex;
-		uniform vec2 screenSize;
-		uniform float HaloWidth;
-		uniform vec3 ChromaticDistortionVector;
+		uniform PC_SAMPLER2D tex;
+	)" + LensBlockSrc + R"(
 
 		in vec2 texCoord;
 
@@ -391,7 +871,7 @@ namespace PhysiCam
 		const float uDistortion = 1.0;
 		
 		// chromatic distortion:
-		vec4 textureDistorted(in sampler2D tex, in vec2 texcoord,
+		vec4 textureDistorted(in PC_SAMPLER2D tex, in vec2 texcoord,
 							  in vec2 direction, in vec3 distortion)
 		{
 		  return vec4(texture(tex, texcoord + direction * distortion.r).r,
@@ -438,20 +918,10 @@ namespace PhysiCam
 
 	)";
 
-	const static std::string ToneMapperSrc = R"(
-		
-		#version 400
+	const static std::string ToneMappingStageSrc = ToneMappingBlockSrc + R"(
 
-		uniform sampler2D hdrColor;
-		uniform int tonemappingMethod;
 		uniform bool tonemappingEnabled = true;
 		uniform bool noiseEnabled = true;
-		uniform float timer;
-		uniform float grainamount;
-		uniform vec2 screenSize;
-
-		in vec2 texCoord;
-		out lowp vec4 colorOut;
 
 		float A = 0.15;
 		float B = 0.50;
@@ -557,7 +1027,7 @@ namespace PhysiCam
 		//2d coordinate orientation thing
 		vec2 coordRot(in vec2 tc, in float angle)
 		{
-			float aspect = screenSize.x/screenSize.y;
+			float aspect = outputSize.x/outputSize.y;
 			float rotX = ((tc.x*2.0-1.0)*aspect*cos(angle)) - ((tc.y*2.0-1.0)*sin(angle));
 			float rotY = ((tc.y*2.0-1.0)*cos(angle)) + ((tc.x*2.0-1.0)*aspect*sin(angle));
 			rotX = ((rotX/aspect)*0.5+0.5);
@@ -569,13 +1039,13 @@ namespace PhysiCam
 		{
 			const vec3 rotOffset = vec3(1.425,3.892,5.835); //rotation offset values	
 			vec2 rotCoordsR = coordRot(texCoord, timer + rotOffset.x);
-			vec3 noise = vec3(pnoise3D(vec3(rotCoordsR*vec2(screenSize.x/grainsize,screenSize.y/grainsize),0.0)));
+			vec3 noise = vec3(pnoise3D(vec3(rotCoordsR*vec2(outputSize.x/grainsize,outputSize.y/grainsize),0.0)));
 
 			//colored noise
 			//vec2 rotCoordsG = coordRot(texCoord, timer + rotOffset.y);
 			//vec2 rotCoordsB = coordRot(texCoord, timer + rotOffset.z);
-			//noise.g = mix(noise.r,pnoise3D(vec3(rotCoordsG*vec2(screenSize.x/grainsize,screenSize.y/grainsize),1.0)),coloramount);
-			//noise.b = mix(noise.r,pnoise3D(vec3(rotCoordsB*vec2(screenSize.x/grainsize,screenSize.y/grainsize),2.0)),coloramount);
+			//noise.g = mix(noise.r,pnoise3D(vec3(rotCoordsG*vec2(outputSize.x/grainsize,outputSize.y/grainsize),1.0)),coloramount);
+			//noise.b = mix(noise.r,pnoise3D(vec3(rotCoordsB*vec2(outputSize.x/grainsize,outputSize.y/grainsize),2.0)),coloramount);
 
 			//noisiness response curve based on scene luminance
 			const vec3 lumcoeff = vec3(0.299,0.587,0.114);
@@ -588,61 +1058,73 @@ namespace PhysiCam
 			return noise;
 		}
 
-		void main(void)
+		vec3 ToneMappingStage(vec3 col)
 		{
-			vec3 color = texture(hdrColor, texCoord).xyz;
 			if(tonemappingEnabled)
 			{
 				switch(tonemappingMethod)
 				{
 					case 0:
-						color = Reinhard(color);
+						col = Reinhard(col);
 						break;
 					case 1:
-						color = Filmic(color);
+						col = Filmic(col);
 						break;
 					case 2:
 						{
 							float ExposureBias = 2.0f;
-							color = Uncharted2Tonemap(ExposureBias*color);
+							col = Uncharted2Tonemap(ExposureBias*col);
 							vec3 whiteScale = vec3(1.0f)/Uncharted2Tonemap(vec3(W));
-							color = color * whiteScale;
-							color = pow(color, vec3(1/2.2));
+							col = col * whiteScale;
+							col = pow(col, vec3(1/2.2));
 						}
 						break;
 				}
 			}
 			if(noiseEnabled)
 			{
-				color += Noise(color)*grainamount;
+				col += Noise(col)*grainamount;
 			}
 
-			colorOut = vec4(color,1);
-		};
+			return col;
+		}
 
+	)";
+
+	const static std::string ToneMapperSrc = R"(
+		
+		#version 400
+	)" + LayerBlockSrc + R"(
+
+		uniform PC_SAMPLER2D hdrColor;
+
+		in vec2 texCoord;
+		out lowp vec4 colorOut;
+	)" + ToneMappingStageSrc + R"(
+		void main(void)
+		{
+			colorOut = vec4(ToneMappingStage(texture(hdrColor, texCoord).xyz),1);
+		};
 
-		)";
+
+		)";
 
 	const static std::string DoFSrc = R"(
 
 				#version 400
+	)" + LayerBlockSrc + R"(
 		#define PI  3.14159265
-
-				uniform sampler2D ColorTexture;
-		uniform sampler2D DepthTexture;
-		uniform vec2 ScreenSize;
-				
-		uniform bool autofocus;
-		uniform float focalDepth;  //focal distance value in meters, but you may use autofocus option below
-		uniform float focalLength; //focal length in mm
-		uniform float fstop; //f-stop value
-		uniform float fringe; //bokeh chromatic aberration/fringing
-		uniform bool vignetting;
-		uniform float maxblur; //clamp value of max blur (0.0 = no blur,1.0 default)
-		uniform bool showFocus; //show debug focus point and focal range (red = focal point, green = focal range)
-		uniform float CoC; //circle of confusion size in mm (35mm film = 0.03mm)
-
-		uniform vec2 CameraClips;		
+		#ifndef PC_FUSED_OUTPUT
+		#define PC_FUSED_OUTPUT(c) (c)
+		#endif
+
+				uniform PC_SAMPLER2D ColorTexture;
+		uniform PC_SAMPLER2D DepthTexture;
+	)" + DoFBlockSrc + R"(
+		layout(std140) uniform FocusBlock
+		{
+			vec4 Focus;
+		};
 
 		in vec2 texCoord;
 
@@ -656,7 +1138,7 @@ namespace PhysiCam
 
 		//user variables ----
 
-		int samples = 6; //samples on the first ring
+		int samples = ringSamples; //samples on the first ring
 		int rings = 3; //ring count
 
 		
@@ -815,7 +1297,9 @@ namespace PhysiCam
 
 			//focal plane calculation
 			float fDepth = focalDepth;
-			if (autofocus)
+			if (useFocusBuffer)
+				fDepth = Focus.x;
+			else if (autofocus)
 			{
 				fDepth = linearize(texture2D(DepthTexture,focus).x);
 			}
@@ -830,7 +1314,9 @@ namespace PhysiCam
 			float blur = abs(a-b)*c;
 			blur = clamp(blur,0.0,1.0);
 
-			vec2 noise = rand(texCoord)*namount*blur;
+			vec2 noise = rand(texCoord + noiseSeed)*namount*blur;
+			//with TAA the rings are rotated every frame, so the history fills the gaps between their samples
+			float ringOffset = noiseSeed > 0.0 ? rand(texCoord + noiseSeed).x*0.5+0.5 : 0.0;
 
 			// getting blur x and y step factor
 			float w = (1.0/width)*blur*maxblur+noise.x;
@@ -852,8 +1338,8 @@ namespace PhysiCam
 					for (int j = 0 ; j < ringsamples ; j += 1)   
 					{
 						float step = PI*2.0 / float(ringsamples);
-						float pw = (cos(float(j)*step)*float(i));
-						float ph = (sin(float(j)*step)*float(i));
+						float pw = (cos((float(j)+ringOffset)*step)*float(i));
+						float ph = (sin((float(j)+ringOffset)*step)*float(i));
 						float p = 1.0;
 						if (pentagon)
 						{ 
@@ -874,7 +1360,748 @@ namespace PhysiCam
 			{
 				col *= vignette();
 			}
-			colorOut = vec4(col,1);
+			colorOut = PC_FUSED_OUTPUT(vec4(col,1));
+		};
+
+	)";
+
+	//min, max and average linear depth, level 0 covers 4x4 pixels of the depth texture, every further level 2x2 texels
+	const static std::string DepthPyramidSrc = R"(
+
+		#version 430
+	)" + LayerBlockSrc + R"(
+
+		layout(local_size_x = 8, local_size_y = 8) in;
+
+		uniform PC_SAMPLER2D depthTex;	//raw depth for level 0, the pyramid itself for the other levels
+		uniform int sourceLevel;	//-1 to build level 0
+	)" + DoFBlockSrc + R"(
+		layout(rgba32f) uniform writeonly PC_IMAGE2D outputImage;
+
+		float linearize(float depth)
+		{
+			return -CameraClips.y * CameraClips.x / (depth * (CameraClips.y - CameraClips.x) - CameraClips.y);
+		}
+
+		void main(void)
+		{
+			ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+			ivec2 size = imageSize(outputImage);
+			if (any(greaterThanEqual(p, size)))
+				return;
+
+			//the last row and column also cover the remainder of odd source sizes
+			int scale = sourceLevel < 0 ? 4 : 2;
+			ivec2 srcSize = textureSize(depthTex, max(sourceLevel, 0));
+			ivec2 first = p * scale;
+			ivec2 end = min(first + scale, srcSize);
+			if (p.x == size.x - 1)
+				end.x = srcSize.x;
+			if (p.y == size.y - 1)
+				end.y = srcSize.y;
+
+			vec3 d = vec3(1e30, 0.0, 0.0);
+			float n = 0.0;
+			for (int y = first.y; y < end.y; y++)
+			{
+				for (int x = first.x; x < end.x; x++)
+				{
+					vec3 s;
+					if (sourceLevel < 0)
+						s = vec3(linearize(texelFetch(depthTex, ivec2(x, y), 0).x));
+					else
+						s = texelFetch(depthTex, ivec2(x, y), sourceLevel).xyz;
+					d = vec3(min(d.x, s.x), max(d.y, s.y), d.z + s.z);
+					n += 1.0;
+				}
+			}
+
+			imageStore(outputImage, p, vec4(d.xy, d.z / max(n, 1.0), 0.0));
+		};
+
+	)";
+
+	//picks the focus distance from the depth pyramid and pulls the focus towards it
+	const static std::string DoFAutofocusSrc = R"(
+
+		#version 430
+	)" + LayerBlockSrc + R"(
+		#define GRID 8
+
+		layout(local_size_x = GRID, local_size_y = GRID) in;
+
+		layout(std430, binding = 0) buffer FocusBuffer
+		{
+			vec4 Focus; //x = focus distance in meters used by the DoF, y = target distance, z = 1 once initialized
+		};
+
+		uniform PC_SAMPLER2D pyramid;	//x = min, y = max, z = average linear depth
+	)" + AutofocusBlockSrc + R"(
+
+		shared float cellDepth[GRID * GRID];
+		shared float cellWeight[GRID * GRID];
+
+		void main(void)
+		{
+			uint lid = gl_LocalInvocationIndex;
+			vec2 regionSize = max(region.zw - region.xy, vec2(0.0));
+
+			//a single point reads the finest level (4x4 pixel average), regions the level they cover about GRIDxGRID texels of
+			ivec2 baseSize = textureSize(pyramid, 0);
+			float texels = max(regionSize.x * float(baseSize.x), regionSize.y * float(baseSize.y));
+			int level = mode == 0 ? 0 : clamp(int(ceil(log2(max(texels / float(GRID), 1.0)))), 0, levels - 1);
+			ivec2 size = textureSize(pyramid, level);
+
+			vec2 uv = mode == 0 ? (region.xy + region.zw) * 0.5 : region.xy + (vec2(gl_LocalInvocationID.xy) + 0.5) / float(GRID) * regionSize;
+			vec3 d = texelFetch(pyramid, clamp(ivec2(uv * vec2(size)), ivec2(0), size - 1), level).xyz;
+
+			//cells spanning a depth edge get a low weight, the focus should not land between subject and background
+			cellDepth[lid] = d.z;
+			cellWeight[lid] = 1.0 / (1.0 + 4.0 * (d.y - d.x) / max(d.z, 0.0001));
+			barrier();
+
+			if (lid != 0)
+				return;
+
+			float target = cellDepth[0];
+			if (mode == 1)
+			{
+				//zone: closest flat cell, the closest cell at all if every cell has an edge
+				float closest = 1e30;
+				float closestFlat = 1e30;
+				for (int i = 0; i < GRID * GRID; i++)
+				{
+					closest = min(closest, cellDepth[i]);
+					if (cellWeight[i] > 0.5)
+						closestFlat = min(closestFlat, cellDepth[i]);
+				}
+				target = closestFlat < 1e30 ? closestFlat : closest;
+			}
+			else if (mode == 2)
+			{
+				//rectangle (e.g. a face box): weighted average depth
+				float sum = 0.0;
+				float weights = 0.0;
+				for (int i = 0; i < GRID * GRID; i++)
+				{
+					sum += cellDepth[i] * cellWeight[i];
+					weights += cellWeight[i];
+				}
+				target = sum / max(weights, 0.0001);
+			}
+
+			//pull the focus in diopters, like a focus ring moves, the first frame snaps to the target
+			float current = Focus.z > 0.0 ? 1.0 / Focus.x : 1.0 / target;
+			float t = focusSpeed > 0.0 ? 1.0 - exp(-focusSpeed * deltaTime) : 1.0;
+			current = mix(current, 1.0 / target, t);
+			Focus = vec4(1.0 / current, target, 1.0, 0.0);
+		};
+
+	)";
+
+	//tiled DoF: circle of confusion and linear depth once per pixel, same lens model as DoFSrc
+	const static std::string DoFCoCSrc = R"(
+
+		#version 400
+	)" + LayerBlockSrc + R"(
+
+		uniform PC_SAMPLER2D DepthTexture;
+	)" + DoFBlockSrc + R"(
+		layout(std140) uniform FocusBlock
+		{
+			vec4 Focus;
+		};
+
+		in vec2 texCoord;
+
+		out vec4 colorOut;
+
+		vec2 focus = vec2(0.5,0.5); // autofocus point on screen
+
+		float linearize(float depth)
+		{
+			return -CameraClips.y * CameraClips.x / (depth * (CameraClips.y - CameraClips.x) - CameraClips.y);
+		}
+
+		void main(void)
+		{
+			float depth = linearize(texture(DepthTexture, texCoord).x);
+
+			float fDepth = focalDepth;
+			if (useFocusBuffer)
+				fDepth = Focus.x;
+			else if (autofocus)
+				fDepth = linearize(texture(DepthTexture, focus).x);
+
+			float f = focalLength; //focal length in mm
+			float d = fDepth*1000.0; //focal plane in mm
+			float o = depth*1000.0; //depth in mm
+
+			float a = (o*f)/(o-f); 
+			float b = (d*f)/(d-f); 
+			float c = (d-f)/(d*fstop*CoC); 
+			float blur = clamp(abs(a-b)*c, 0.0, 1.0);
+
+			//x = blur, y = linear depth in meters
+			colorOut = vec4(blur, depth, 0.0, 1.0);
+		};
+
+	)";
+
+	//min/max blur per tile, tiles with visible blur are appended to the list the gather is dispatched from
+	const static std::string DoFTileClassifySrc = R"(
+
+		#version 430
+	)" + LayerBlockSrc + R"(
+		#define TILE_SIZE 16
+		#define IN_FOCUS 0.05
+
+		layout(local_size_x = TILE_SIZE, local_size_y = TILE_SIZE) in;
+
+		layout(std430, binding = 0) buffer DoFTileList
+		{
+			//indirect dispatch arguments, reset to (0, 1, 1) every frame
+			uint dispatchX;
+			uint dispatchY;
+			uint dispatchZ;
+			uint padding;
+			uvec2 tiles[]; //x, y | layer << 16
+		};
+
+		uniform PC_SAMPLER2D CoCTexture;
+		layout(rg16f) uniform writeonly PC_IMAGE2D tileImage;
+
+		shared float minBlur[TILE_SIZE * TILE_SIZE];
+		shared float maxBlur[TILE_SIZE * TILE_SIZE];
+
+		void main(void)
+		{
+			ivec2 size = textureSize(CoCTexture, 0);
+			ivec2 pixel = min(ivec2(gl_GlobalInvocationID.xy), size - 1);
+			float blur = texelFetch(CoCTexture, pixel, 0).x;
+
+			uint lid = gl_LocalInvocationIndex;
+			minBlur[lid] = blur;
+			maxBlur[lid] = blur;
+			barrier();
+
+			for (uint stride = TILE_SIZE * TILE_SIZE / 2; stride > 0; stride >>= 1)
+			{
+				if (lid < stride)
+				{
+					minBlur[lid] = min(minBlur[lid], minBlur[lid + stride]);
+					maxBlur[lid] = max(maxBlur[lid], maxBlur[lid + stride]);
+				}
+				barrier();
+			}
+
+			if (lid == 0)
+			{
+				imageStore(tileImage, ivec2(gl_WorkGroupID.xy), vec4(minBlur[0], maxBlur[0], 0.0, 0.0));
+				if (maxBlur[0] >= IN_FOCUS)
+					tiles[atomicAdd(dispatchX, 1u)] = uvec2(gl_WorkGroupID.x, gl_WorkGroupID.y | (gl_WorkGroupID.z << 16));
+			}
+		};
+
+	)";
+
+	//ring gather of DoFSrc for the tiled DoF, needs ColorTexture and the DoF block.
+	//Same settings and dither as DoFSrc, the disabled pentagon shape is left out
+	const static std::string DoFRingSrc = R"(
+
+		#define PI  3.14159265
+		const int samples = 6; //samples on the first ring
+		const int rings = 3; //ring count
+		const float threshold = 1.0; //highlight threshold;
+		const float gain = 1.8; //highlight gain;
+		const float bias = 0.5; //bokeh edge bias
+		const float namount = 0.0001; //dither amount
+		const vec3 lumcoeff = vec3(0.299,0.587,0.114);
+
+		vec2 rand(vec2 coord) //noise for dithering
+		{
+			float noiseX = clamp(fract(sin(dot(coord ,vec2(12.9898,78.233))) * 43758.5453),0.0,1.0)*2.0-1.0;
+			float noiseY = clamp(fract(sin(dot(coord ,vec2(12.9898,78.233)*2.0)) * 43758.5453),0.0,1.0)*2.0-1.0;
+			return vec2(noiseX,noiseY);
+		}
+
+		vec3 color(vec2 coords, float blur, vec2 texel) //processing the sample
+		{
+			vec3 col = vec3(0.0);
+			col.r = textureLod(ColorTexture,coords + vec2(0.0,1.0)*texel*fringe*blur, 0.0).r;
+			col.g = textureLod(ColorTexture,coords + vec2(-0.866,-0.5)*texel*fringe*blur, 0.0).g;
+			col.b = textureLod(ColorTexture,coords + vec2(0.866,-0.5)*texel*fringe*blur, 0.0).b;
+
+			float lum = dot(col.rgb, lumcoeff);
+			float thresh = max((lum-threshold)*gain, 0.0);
+			return col+mix(vec3(0.0),col,thresh*blur);
+		}
+
+		vec3 ringGather(vec2 uv, float blur, vec2 texel)
+		{
+			vec2 noise = rand(uv + noiseSeed)*namount*blur;
+			float w = texel.x*blur*maxblur+noise.x;
+			float h = texel.y*blur*maxblur+noise.y;
+
+			vec3 col = textureLod(ColorTexture, uv, 0.0).rgb;
+			float s = 1.0;
+			for (int i = 1; i <= rings; i += 1)
+			{
+				int ringsamples = i * samples;
+				float ringStep = PI*2.0 / float(ringsamples);
+				float ringWeight = mix(1.0,(float(i))/(float(rings)),bias);
+				for (int j = 0 ; j < ringsamples ; j += 1)
+				{
+					float pw = (cos(float(j)*ringStep)*float(i));
+					float ph = (sin(float(j)*ringStep)*float(i));
+					col += color(uv + vec2(pw*w,ph*h),blur,texel)*ringWeight;
+					s += ringWeight;
+				}
+			}
+			return col / s;
+		}
+
+	)";
+
+	//ring gather of DoFSrc at half resolution, one workgroup per blurred tile
+	const static std::string DoFGatherComputeSrc = R"(
+
+		#version 430
+	)" + LayerBlockSrc + R"(
+		#define TILE_SIZE 16
+		//layout qualifiers take literals only before GLSL 4.40
+		#define GROUP_SIZE 8
+		#ifndef IMAGE_FORMAT
+		#define IMAGE_FORMAT rgba32f
+		#endif
+
+		layout(local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE) in;
+
+		layout(std430, binding = 0) readonly buffer DoFTileList
+		{
+			uint dispatchX;
+			uint dispatchY;
+			uint dispatchZ;
+			uint padding;
+			uvec2 tiles[];
+		};
+
+		uniform PC_SAMPLER2D ColorTexture;
+		uniform PC_SAMPLER2D CoCTexture;
+		layout(IMAGE_FORMAT) uniform writeonly PC_IMAGE2D outputImage;
+	)" + DoFBlockSrc + R"(
+
+		//the list holds the blurred tiles of all layers, each workgroup reads the layer of its tile
+		int tileLayer;
+		#ifdef PC_LAYERED
+		#undef PC_LAYER
+		#define PC_LAYER tileLayer
+		#endif
+	)" + DoFRingSrc + R"(
+
+		void main(void)
+		{
+			//a gather pixel belongs to the tile its center falls into, at most TILE_SIZE / 2 per axis for gatherScale <= 0.5
+			uvec2 entry = tiles[gl_WorkGroupID.x];
+			ivec2 tile = ivec2(entry.x, entry.y & 0xFFFFu);
+			tileLayer = int(entry.y >> 16);
+			ivec2 first = ivec2(ceil(vec2(tile * TILE_SIZE) * gatherScale - 0.5));
+			ivec2 pixel = first + ivec2(gl_LocalInvocationID.xy);
+			vec2 center = (vec2(pixel) + 0.5) / gatherScale;
+			if (any(greaterThanEqual(pixel, imageSize(outputImage))) || any(notEqual(ivec2(center) / TILE_SIZE, tile)))
+				return;
+
+			vec2 texel = 1.0 / ScreenSize;
+			vec2 uv = center * texel;
+			vec2 cocDepth = textureLod(CoCTexture, uv, 0.0).xy;
+
+			//linear depth is kept for the depth aware upsample
+			imageStore(outputImage, pixel, vec4(ringGather(uv, cocDepth.x, texel), cocDepth.y));
+		};
+
+	)";
+
+	//full resolution composite of the tiled DoF, in focus tiles copy the input
+	const static std::string DoFCompositeSrc = R"(
+
+		#version 400
+	)" + LayerBlockSrc + R"(
+		#define TILE_SIZE 16
+		#define IN_FOCUS 0.05
+		//ratio between the upsample taps (per channel) above which a highlight pixel is gathered at full resolution
+		#define HIGHLIGHT_CONTRAST 4.0
+		#ifndef PC_FUSED_OUTPUT
+		#define PC_FUSED_OUTPUT(c) (c)
+		#endif
+
+		uniform PC_SAMPLER2D ColorTexture;
+		uniform PC_SAMPLER2D CoCTexture;		//x = blur, y = linear depth
+		uniform PC_SAMPLER2D TileTexture;		//min/max blur per tile
+		uniform PC_SAMPLER2D GatherTexture;	//half resolution gather, only valid in blurred tiles
+		uniform ivec2 outputOffset;		//viewport origin when rendering straight to the output framebuffer
+	)" + DoFBlockSrc + DoFRingSrc + R"(
+
+		in vec2 texCoord;
+
+		out vec4 colorOut;
+
+		float vignout = 1.3; //vignetting outer border
+		float vignin = 0.0; //vignetting inner border
+		float vignfade = 22.0; //f-stops till vignete fades
+
+		vec3 debugFocus(vec3 col, float blur, float depth)
+		{
+			float edge = 0.002*depth; //distance based edge smoothing
+			float m = clamp(smoothstep(0.0,edge,blur),0.0,1.0);
+			float e = clamp(smoothstep(1.0-edge,1.0,blur),0.0,1.0);
+	
+			col = mix(col,vec3(1.0,0.5,0.0),(1.0-m)*0.6);
+			col = mix(col,vec3(0.0,0.5,1.0),((1.0-e)-(1.0-m))*0.2);
+			return col;
+		}
+
+		float vignette()
+		{
+			float dist = distance(texCoord, vec2(0.5,0.5));
+			dist = smoothstep(vignout+(fstop/vignfade), vignin+(fstop/vignfade), dist);
+			return clamp(dist,0.0,1.0);
+		}
+
+		//gathered color of a gather pixel, pixels of in focus tiles were skipped and use the input
+		vec4 gathered(ivec2 halfPixel)
+		{
+			ivec2 pixel = min(ivec2((vec2(halfPixel) + 0.5) / gatherScale), ivec2(ScreenSize) - 1);
+			if (texelFetch(TileTexture, pixel / TILE_SIZE, 0).y >= IN_FOCUS)
+				return texelFetch(GatherTexture, halfPixel, 0);
+			return vec4(texelFetch(ColorTexture, pixel, 0).rgb, texelFetch(CoCTexture, pixel, 0).y);
+		}
+
+		void main(void)
+		{
+			ivec2 pixel = ivec2(gl_FragCoord.xy) - outputOffset;
+			vec2 cocDepth = texelFetch(CoCTexture, pixel, 0).xy;
+			vec3 col = texelFetch(ColorTexture, pixel, 0).rgb;
+
+			//uniform per tile, so whole waves take the same branch
+			vec2 tile = texelFetch(TileTexture, pixel / TILE_SIZE, 0).xy;
+			if (tile.y >= IN_FOCUS)
+			{
+				//bilinear upsample, taps across a depth discontinuity are rejected
+				ivec2 halfSize = textureSize(GatherTexture, 0);
+				vec2 halfPos = (vec2(pixel) + 0.5) * gatherScale - 0.5;
+				ivec2 base = ivec2(floor(halfPos));
+				vec2 f = halfPos - vec2(base);
+				vec4 weights = vec4((1.0-f.x)*(1.0-f.y), f.x*(1.0-f.y), (1.0-f.x)*f.y, f.x*f.y);
+				ivec2 offsets[4] = ivec2[](ivec2(0,0), ivec2(1,0), ivec2(0,1), ivec2(1,1));
+
+				vec4 sum = vec4(0.0);
+				vec3 low = vec3(1e20);
+				vec3 high = vec3(0.0);
+				for (int i = 0; i < 4; i++)
+				{
+					vec4 tap = gathered(clamp(base + offsets[i], ivec2(0), halfSize - 1));
+					float w = weights[i] / (0.001 + abs(tap.a - cocDepth.y) / cocDepth.y);
+					if (w > 0.0001)
+					{
+						low = min(low, tap.rgb);
+						high = max(high, tap.rgb);
+					}
+					//bright taps would spread the highlights into their dark neighbours
+					w /= 1.0 + dot(tap.rgb, lumcoeff);
+					sum += vec4(tap.rgb * w, w);
+				}
+				vec3 blurred = sum.rgb / max(sum.a, 0.00001);
+
+				//the edges and color fringes of bokeh highlights are finer than the half resolution, they are gathered per pixel
+				if (any(greaterThan(high, max(vec3(threshold), HIGHLIGHT_CONTRAST * low))))
+					blurred = ringGather((vec2(pixel) + 0.5) / ScreenSize, cocDepth.x, 1.0 / ScreenSize);
+
+				//small blurs keep the full resolution detail, fully blurred tiles skip the blend
+				float blend = tile.x >= 0.25 ? 1.0 : smoothstep(IN_FOCUS, 0.25, cocDepth.x);
+				col = mix(col, blurred, blend);
+			}
+
+			if (showFocus)
+			{
+				col = debugFocus(col, cocDepth.x, cocDepth.y);
+			}
+			if (vignetting)
+			{
+				col *= vignette();
+			}
+			colorOut = PC_FUSED_OUTPUT(vec4(col,1));
+		};
+
+	)";
+
+	/*
+	* Screen space motion since the previous frame, shared by TAA and motion blur. The depth and the result
+	* are in the lens distorted image, the reprojection happens in the undistorted scene.
+	*/
+	const static std::string MotionSrc = LensBlockSrc + ReprojectionBlockSrc + R"(
+
+		uniform PC_SAMPLER2D motionVectors;	//optional, current minus previous position in uv of the undistorted scene
+
+		//mapping of the lens distortion pass (green channel), see LensDistortionSrc
+		const float lensScale = 0.9;
+		const float lensEta = 1.006;
+
+		//current minus previous texture coordinate of a pixel with the given (non linear) depth
+		vec2 motion(vec2 coord, float depth)
+		{
+			float r2 = dot(coord - 0.5, coord - 0.5);
+			float lens = (1.0 + r2 * k) * lensEta * lensScale;
+			vec2 sceneCoord = lens * (coord - 0.5) + 0.5;
+			vec2 sceneMotion;
+			if (useMotionVectors)
+				sceneMotion = texture(motionVectors, sceneCoord).xy;
+			else
+			{
+				vec4 previous = Reprojection[PC_VIEW] * vec4(sceneCoord * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+				sceneMotion = sceneCoord - (previous.xy / previous.w * 0.5 + 0.5);
+			}
+			return sceneMotion / lens;
+		}
+
+	)";
+
+	/*
+	* Temporal anti-aliasing, blends the frame with the reprojected history of the previous frames.
+	* Runs on the exposed HDR color after DoF, so the noise of the effects before it converges as well.
+	*/
+	const static std::string TAASrc = R"(
+
+		#version 400
+	)" + LayerBlockSrc + R"(
+		uniform PC_SAMPLER2D tex;
+		uniform PC_SAMPLER2D depth;			//lens distorted depth, aligned with tex
+		uniform PC_SAMPLER2D history;
+	)" + TAABlockSrc + MotionSrc + R"(
+
+		in vec2 texCoord;
+
+		out vec4 colorOut;
+
+		vec3 RGBToYCoCg(vec3 c)
+		{
+			return vec3(0.25*c.r + 0.5*c.g + 0.25*c.b, 0.5*c.r - 0.5*c.b, -0.25*c.r + 0.5*c.g - 0.25*c.b);
+		}
+
+		vec3 YCoCgToRGB(vec3 c)
+		{
+			return vec3(c.x + c.y - c.z, c.x + c.z, c.x - c.y - c.z);
+		}
+
+		void main(void)
+		{
+			vec2 texel = 1.0 / vec2(textureSize(tex, 0));
+			vec3 current = texture(tex, texCoord).rgb;
+
+			//bounding box of the 3x3 neighbourhood, the motion is taken from its closest pixel so edges move with the foreground
+			vec3 minColor = vec3(1e20);
+			vec3 maxColor = vec3(-1e20);
+			float closestDepth = 1.0;
+			vec2 closest = texCoord;
+			for (int y = -1; y <= 1; y++)
+			{
+				for (int x = -1; x <= 1; x++)
+				{
+					vec2 uv = texCoord + vec2(x, y) * texel;
+					vec3 c = RGBToYCoCg(texture(tex, uv).rgb);
+					minColor = min(minColor, c);
+					maxColor = max(maxColor, c);
+
+					float d = texture(depth, uv).r;
+					if (d < closestDepth)
+					{
+						closestDepth = d;
+						closest = uv;
+					}
+				}
+			}
+
+			vec2 historyCoord = texCoord - motion(closest, closestDepth);
+
+			//history outside the screen or from before a reset is dropped
+			bool inside = all(greaterThanEqual(historyCoord, vec2(0.0))) && all(lessThanEqual(historyCoord, vec2(1.0)));
+			float weight = historyValid && inside ? feedback : 0.0;
+
+			vec3 previousColor = RGBToYCoCg(texture(history, historyCoord).rgb);
+			previousColor = YCoCgToRGB(clamp(previousColor, minColor, maxColor));
+
+			//weighted by the inverse luminance, so single bright samples do not flicker
+			float currentWeight = (1.0 - weight) / (1.0 + dot(current, vec3(0.2126, 0.7152, 0.0722)));
+			float previousWeight = weight / (1.0 + dot(previousColor, vec3(0.2126, 0.7152, 0.0722)));
+			colorOut = vec4((current * currentWeight + previousColor * previousWeight) / max(currentWeight + previousWeight, 0.00001), 1.0);
+		};
+
+	)";
+
+	/*
+	* Camera motion blur, after "A Reconstruction Filter for Plausible Motion Blur" (McGuire et al. 2012).
+	* The velocity is scaled by the shutter time, its maximum is taken per tile and over the neighbouring tiles,
+	* then the gather samples along the dominant velocity. Tiles without motion only copy the input.
+	*/
+	const static std::string MotionBlurVelocitySrc = R"(
+
+		#version 400
+	)" + LayerBlockSrc + R"(
+		uniform PC_SAMPLER2D depth;
+	)" + MotionBlurBlockSrc + MotionSrc + R"(
+
+		in vec2 texCoord;
+
+		out vec4 colorOut;
+
+		void main(void)
+		{
+			//half the distance the pixel covers while the shutter is open
+			vec2 velocity = motion(texCoord, texture(depth, texCoord).r) * screenSize * 0.5 * velocityScale;
+			float len = length(velocity);
+			if (len > maxRadius)
+				velocity *= maxRadius / len;
+			colorOut = vec4(velocity, 0.0, 1.0);
+		};
+
+	)";
+
+	const static std::string MotionBlurTileMaxSrc = R"(
+
+		#version 400
+	)" + LayerBlockSrc + R"(
+		#define TILE_SIZE 16
+
+		uniform PC_SAMPLER2D velocityTexture;
+
+		out vec4 colorOut;
+
+		void main(void)
+		{
+			ivec2 size = textureSize(velocityTexture, 0);
+			ivec2 origin = ivec2(gl_FragCoord.xy) * TILE_SIZE;
+			vec2 maxVelocity = vec2(0.0);
+			for (int y = 0; y < TILE_SIZE; y++)
+			{
+				for (int x = 0; x < TILE_SIZE; x++)
+				{
+					vec2 v = texelFetch(velocityTexture, min(origin + ivec2(x, y), size - 1), 0).xy;
+					if (dot(v, v) > dot(maxVelocity, maxVelocity))
+						maxVelocity = v;
+				}
+			}
+			colorOut = vec4(maxVelocity, 0.0, 1.0);
+		};
+
+	)";
+
+	const static std::string MotionBlurNeighborMaxSrc = R"(
+
+		#version 400
+	)" + LayerBlockSrc + R"(
+		uniform PC_SAMPLER2D tileMaxTexture;
+
+		out vec4 colorOut;
+
+		void main(void)
+		{
+			//a pixel can be covered by the blur of the tiles around its own
+			ivec2 size = textureSize(tileMaxTexture, 0);
+			ivec2 tile = ivec2(gl_FragCoord.xy);
+			vec2 maxVelocity = vec2(0.0);
+			for (int y = -1; y <= 1; y++)
+			{
+				for (int x = -1; x <= 1; x++)
+				{
+					vec2 v = texelFetch(tileMaxTexture, clamp(tile + ivec2(x, y), ivec2(0), size - 1), 0).xy;
+					if (dot(v, v) > dot(maxVelocity, maxVelocity))
+						maxVelocity = v;
+				}
+			}
+			colorOut = vec4(maxVelocity, 0.0, 1.0);
+		};
+
+	)";
+
+	const static std::string MotionBlurGatherSrc = R"(
+
+		#version 400
+	)" + LayerBlockSrc + R"(
+		#define TILE_SIZE 16
+		#define SOFT_Z_EXTENT 0.1 //depth difference in scene units over which a sample goes from in front to behind
+
+		uniform PC_SAMPLER2D tex;
+		uniform PC_SAMPLER2D depth;
+		uniform PC_SAMPLER2D velocityTexture;
+		uniform PC_SAMPLER2D neighborMaxTexture;
+	)" + MotionBlurBlockSrc + R"(
+
+		in vec2 texCoord;
+
+		out vec4 colorOut;
+
+		float linearize(float d)
+		{
+			return -cameraClips.y * cameraClips.x / (d * (cameraClips.y - cameraClips.x) - cameraClips.y);
+		}
+
+		//1 if depth a is in front of depth b
+		float softDepthCompare(float a, float b)
+		{
+			return clamp(1.0 - (a - b) / SOFT_Z_EXTENT, 0.0, 1.0);
+		}
+
+		float cone(float dist, float velocityLength)
+		{
+			return clamp(1.0 - dist / velocityLength, 0.0, 1.0);
+		}
+
+		float cylinder(float dist, float velocityLength)
+		{
+			return 1.0 - smoothstep(0.95 * velocityLength, 1.05 * velocityLength, dist);
+		}
+
+		void main(void)
+		{
+			ivec2 pixel = ivec2(gl_FragCoord.xy);
+			vec3 color = texelFetch(tex, pixel, 0).rgb;
+
+			//uniform per tile, so whole waves skip the gather where nothing moves
+			vec2 maxVelocity = texelFetch(neighborMaxTexture, pixel / TILE_SIZE, 0).xy;
+			float maxLength = length(maxVelocity);
+			if (maxLength < 0.5)
+			{
+				colorOut = vec4(color, 1.0);
+				return;
+			}
+
+			vec2 velocityX = texelFetch(velocityTexture, pixel, 0).xy;
+			float lengthX = max(length(velocityX), 0.5);
+			float depthX = linearize(texelFetch(depth, pixel, 0).r);
+
+			//the center counts as if its own blur spread it over its velocity
+			float weight = 1.0 / lengthX;
+			vec3 sum = color * weight;
+
+			//the sample positions are dithered per pixel, which hides the banding of few samples
+			float jitter = fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715)))) - 0.5;
+			ivec2 size = textureSize(tex, 0);
+			for (int i = 0; i < sampleCount; i++)
+			{
+				float t = mix(-1.0, 1.0, (float(i) + jitter + 1.0) / float(sampleCount + 1));
+				ivec2 samplePixel = clamp(ivec2(vec2(pixel) + 0.5 + maxVelocity * t), ivec2(0), size - 1);
+				float dist = maxLength * abs(t);
+
+				float lengthY = max(length(texelFetch(velocityTexture, samplePixel, 0).xy), 0.5);
+				float depthY = linearize(texelFetch(depth, samplePixel, 0).r);
+
+				//a sample in front blurs over the center with its own velocity, one behind is covered by the blur of the center
+				float front = softDepthCompare(depthY, depthX);
+				float back = softDepthCompare(depthX, depthY);
+				float a = front * cone(dist, lengthY) + back * cone(dist, lengthX) + cylinder(dist, lengthY) * cylinder(dist, lengthX) * 2.0;
+				weight += a;
+				sum += texelFetch(tex, samplePixel, 0).rgb * a;
+			}
+			colorOut = vec4(sum / weight, 1.0);
 		};
 
 	)";
@@ -0,0 +1,114 @@
+/*
+	PhysiCam - Physically based camera
+	Copyright (C) 2015 Frank Khnke
+
+	This file is part of PhysiCam.
+
+	This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License 
+	as published by the Free Software Foundation; either 
+	version 3 of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ *	@file ThreadPool.cpp
+ */
+
+#include <physicam/ThreadPool.h>
+
+#include <algorithm>
+
+namespace PhysiCam
+{
+
+	ThreadPool::ThreadPool(unsigned int threadCount /*= 0*/) : m_Stop(false), m_Generation(0), m_Working(0), m_Func(nullptr),
+		m_Count(0), m_GrainSize(1), m_Next(0)
+	{
+		if (threadCount == 0)
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+		for (unsigned int i = 1; i < threadCount; i++)
+			m_Workers.push_back(std::thread(&ThreadPool::WorkerLoop, this));
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Stop = true;
+		}
+		m_WakeCondition.notify_all();
+
+		for (auto &worker : m_Workers)
+			worker.join();
+	}
+
+	void ThreadPool::ParallelFor(int count, int grainSize, const std::function<void(int, int)>& func)
+	{
+		if (count <= 0)
+			return;
+
+		grainSize = std::max(1, grainSize);
+		if (m_Workers.empty() || count <= grainSize)
+		{
+			func(0, count);
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Func = &func;
+			m_Count = count;
+			m_GrainSize = grainSize;
+			m_Next = 0;
+			m_Working = (unsigned int)m_Workers.size();
+			m_Generation++;
+		}
+		m_WakeCondition.notify_all();
+
+		RunRanges();
+
+		//every worker has to be done with func before it goes out of scope
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_DoneCondition.wait(lock, [this] { return m_Working == 0; });
+		m_Func = nullptr;
+	}
+
+	void ThreadPool::WorkerLoop()
+	{
+		unsigned int generation = 0;
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_WakeCondition.wait(lock, [&] { return m_Stop || m_Generation != generation; });
+				if (m_Stop)
+					return;
+				generation = m_Generation;
+			}
+
+			RunRanges();
+
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			if (--m_Working == 0)
+				m_DoneCondition.notify_one();
+		}
+	}
+
+	void ThreadPool::RunRanges()
+	{
+		//ranges are handed out in order, so neighbouring rows tend to stay on the same thread
+		int begin;
+		while ((begin = m_Next.fetch_add(m_GrainSize)) < m_Count)
+			(*m_Func)(begin, std::min(begin + m_GrainSize, m_Count));
+	}
+
+}
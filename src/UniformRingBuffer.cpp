@@ -0,0 +1,150 @@
+/*
+	PhysiCam - Physically based camera
+	Copyright (C) 2015 Frank Khnke
+
+	This file is part of PhysiCam.
+
+	This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License 
+	as published by the Free Software Foundation; either 
+	version 3 of the License, or (at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ *	@file UniformRingBuffer.cpp
+ */
+
+#include <physicam/UniformRingBuffer.h>
+#include <physicam/physicam_gl.h>
+#include <physicam/GLState.h>
+
+#include <GL/glew.h>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+
+namespace PhysiCam
+{
+
+	UniformRingBuffer::UniformRingBuffer() : m_Buffer(0), m_Mapped(nullptr), m_FrameSize(0), m_Alignment(256), m_Offset(0), m_Frame(0)
+	{
+		for (int i = 0; i < PC_UNIFORM_RING_FRAMES; i++)
+			m_Fences[i] = nullptr;
+	}
+
+	UniformRingBuffer::~UniformRingBuffer()
+	{
+		Delete();
+	}
+
+	void UniformRingBuffer::Init(int blockCount, size_t maxBlockSize)
+	{
+		Delete();
+
+		GLint alignment = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		m_Alignment = alignment > 0 ? alignment : 256;
+		m_FrameSize = blockCount * ((maxBlockSize + m_Alignment - 1) / m_Alignment * m_Alignment);
+		m_Offset = 0;
+		m_Frame = 0;
+
+		GLsizeiptr size = m_FrameSize * PC_UNIFORM_RING_FRAMES;
+		glGenBuffers(1, &m_Buffer);
+		GLState::BindBuffer(GL_UNIFORM_BUFFER, m_Buffer);
+		if (GL::HasBufferStorage)
+		{
+			//coherent, the fences are all the synchronisation needed
+			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(GL_UNIFORM_BUFFER, size, nullptr, flags);
+			m_Mapped = (unsigned char*)glMapBufferRange(GL_UNIFORM_BUFFER, 0, size, flags);
+		}
+		else
+		{
+			glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_STREAM_DRAW);
+		}
+		GLState::BindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
+	void UniformRingBuffer::Delete()
+	{
+		for (int i = 0; i < PC_UNIFORM_RING_FRAMES; i++)
+		{
+			if (m_Fences[i])
+				glDeleteSync((GLsync)m_Fences[i]);
+			m_Fences[i] = nullptr;
+		}
+
+		if (m_Mapped)
+		{
+			GLState::BindBuffer(GL_UNIFORM_BUFFER, m_Buffer);
+			glUnmapBuffer(GL_UNIFORM_BUFFER);
+			GLState::BindBuffer(GL_UNIFORM_BUFFER, 0);
+			m_Mapped = nullptr;
+		}
+		if (m_Buffer)
+		{
+			GLState::BufferDeleted(m_Buffer);
+			glDeleteBuffers(1, &m_Buffer);
+		}
+		m_Buffer = 0;
+	}
+
+	size_t UniformRingBuffer::Push(const void* data, size_t size)
+	{
+		//first push into this slot, wait until the gpu finished the frame which used it before
+		if (m_Offset == 0 && m_Fences[m_Frame])
+		{
+			GLsync fence = (GLsync)m_Fences[m_Frame];
+			if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+				glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+			glDeleteSync(fence);
+			m_Fences[m_Frame] = nullptr;
+		}
+
+		size_t aligned = (size + m_Alignment - 1) / m_Alignment * m_Alignment;
+		if (m_Offset + aligned > m_FrameSize)
+		{
+			//the block count passed to Init is too small, wrapping around would overwrite blocks already bound this frame
+			std::cerr << "UniformRingBuffer: frame slot of " << m_FrameSize << " bytes is full, block dropped" << std::endl;
+			assert(!"UniformRingBuffer: more blocks pushed than passed to Init");
+			return PC_UNIFORM_RING_FULL;
+		}
+
+		size_t offset = m_Frame * m_FrameSize + m_Offset;
+		if (m_Mapped)
+		{
+			memcpy(m_Mapped + offset, data, size);
+		}
+		else
+		{
+			GLState::BindBuffer(GL_UNIFORM_BUFFER, m_Buffer);
+			glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+			GLState::BindBuffer(GL_UNIFORM_BUFFER, 0);
+		}
+		m_Offset += aligned;
+		return offset;
+	}
+
+	void UniformRingBuffer::BindRange(unsigned int binding, size_t offset, size_t size)
+	{
+		GLState::BindBufferRange(GL_UNIFORM_BUFFER, binding, m_Buffer, offset, size);
+	}
+
+	void UniformRingBuffer::EndFrame()
+	{
+		if (m_Offset == 0)
+			return;
+
+		m_Fences[m_Frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		m_Frame = (m_Frame + 1) % PC_UNIFORM_RING_FRAMES;
+		m_Offset = 0;
+	}
+}
@@ -24,6 +24,7 @@
 
 #include <physicam/Camera.h>
 #include <physicam/physicam_gl.h>
+#include <physicam/GLState.h>
 
 #include <GL/glew.h>
 
@@ -31,17 +32,29 @@ namespace PhysiCam
 {
 
 	//constructor, default camera parameters to some useful defaults
-	Camera::Camera(int screenWidth, int screenHeight)
-		: m_Iso(100), m_Aperture(7.5f), m_ShutterSpeed(0.0025f), m_AutoExposure(true),
-		m_FocalLength(36), m_MaxAperture(22.0f), m_MinAperture(1.8f), m_MinIso(100.0f), m_MaxIso(6400.0f),
-		m_MaxShutterSpeed(0.00025f), m_MinShutterSpeed(0.0333f), m_SensorType({24.f, 0.03f}), m_ClipNear(0.5f), m_ClipFar(1000.0f),
-		m_AspectRatio(screenWidth / (float)screenHeight), m_TargetEV(0), m_AverageSceneLuminance(0.0f)
+	Camera::Camera(int screenWidth, int screenHeight, PostProcessingContextPtr context)
+		: m_TargetEV(0), m_AutoExposure(true),
+		m_MeteringMode(MeteringMode::Matrix), m_MeteringPoint(0.5f, 0.5f), m_SpotMeteringRadius(0.05f), m_MeteringPercentiles(0.05f, 0.95f),
+		m_MinIso(100.0f), m_MaxIso(6400.0f), m_Iso(100), m_MaxShutterSpeed(0.00025f), m_MinShutterSpeed(0.0333f), m_ShutterSpeed(0.0025f),
+		m_SensorType({24.f, 0.03f}), m_FocalLength(36), m_MinAperture(1.8f), m_MaxAperture(22.0f), m_Aperture(7.5f),
+		m_ClipNear(0.5f), m_ClipFar(1000.0f), m_AspectRatio(screenWidth / (float)screenHeight), m_AverageSceneLuminance(0.0f),
+		m_ViewCount(1), m_Jitter(0.0f), m_JitterIndex(0), m_PreviousValid(false)
 	{
 		m_ScreenSize = glm::ivec2(screenWidth, screenHeight);
-		m_PostProcessor = new PostProcessor(this);
+		m_PostProcessor = new PostProcessor(this, context);
 
 		m_DeltaTime = 0.0f;
 
+		for (int i = 0; i < PC_MAX_VIEWS; i++)
+		{
+			m_ViewOffset[i] = glm::mat4(1.0f);
+			m_ViewMatrix[i] = glm::mat4(1.0f);
+			m_UnjitteredProjectionMatrix[i] = glm::mat4(1.0f);
+			m_UnjitteredViewProjectionMatrix[i] = glm::mat4(1.0f);
+			m_CustomViewMatrix[i] = false;
+			m_CustomProjectionMatrix[i] = false;
+		}
+
 		//values used from wikipedia
 		m_SensorPresets[SENSOR_4_3] = {17.3f, 0.015f};
 		m_SensorPresets[SENSOR_APS_C] = { 22.5f, 0.015f };
@@ -73,7 +86,12 @@ namespace PhysiCam
 
 	float Camera::GetStandardOutputBasedExposure(float middleGrey /*= 0.18f*/)
 	{
-		float avg = (1000.0f / 65.0f) * pow(m_Aperture,2) / (m_Iso * m_ShutterSpeed);
+		return ComputeStandardOutputExposure(m_Aperture, m_Iso, m_ShutterSpeed, middleGrey);
+	}
+
+	float Camera::ComputeStandardOutputExposure(float aperture, float iso, float shutterSpeed, float middleGrey /*= 0.18f*/)
+	{
+		float avg = (1000.0f / 65.0f) * pow(aperture, 2) / (iso * shutterSpeed);
 		return middleGrey / avg;
 	}
 
@@ -128,13 +146,83 @@ namespace PhysiCam
 		m_DeltaTime = deltaTime;
 		
 		//get view matrix
-		m_ViewMatrix = m_Transform.GetModelMatrix();
+		glm::mat4 view = m_Transform.GetModelMatrix();
 
 		//build projection matrix
-		m_ProjectionMatrix = glm::perspective(ComputeFOV(m_FocalLength), m_AspectRatio, m_ClipNear, m_ClipFar);
+		glm::mat4 projection = glm::perspective(ComputeFOV(m_FocalLength), m_AspectRatio, m_ClipNear, m_ClipFar);
 
-		//precompute view-projection matrix
-		m_ViewProjectionMatrix = m_ProjectionMatrix * m_ViewMatrix;
+		//with TAA every frame is rendered with another sub pixel offset, the postprocessing accumulates them
+		m_Jitter = glm::vec2(0.0f);
+		if (m_PostProcessor->TAAEnabled())
+		{
+			m_JitterIndex = (m_JitterIndex + 1) % PC_TAA_JITTER_SAMPLES;
+			m_Jitter = glm::vec2(Halton(m_JitterIndex + 1, 2), Halton(m_JitterIndex + 1, 3)) - 0.5f;
+		}
+		glm::mat4 jitter = glm::translate(glm::mat4(1.0f), glm::vec3(m_Jitter * 2.0f / glm::vec2(m_ScreenSize), 0.0f));
+
+		glm::mat4 previous[PC_MAX_VIEWS];
+		for (int i = 0; i < m_ViewCount; i++)
+			previous[i] = m_UnjitteredViewProjectionMatrix[i];
+
+		//views without matrices of their own share the lens, only their offset differs
+		for (int i = 0; i < m_ViewCount; i++)
+		{
+			if (!m_CustomViewMatrix[i])
+				m_ViewMatrix[i] = m_ViewOffset[i] * view;
+			if (!m_CustomProjectionMatrix[i])
+				m_UnjitteredProjectionMatrix[i] = projection;
+			m_ProjectionMatrix[i] = jitter * m_UnjitteredProjectionMatrix[i];
+
+			//precompute view-projection matrix
+			m_ViewProjectionMatrix[i] = m_ProjectionMatrix[i] * m_ViewMatrix[i];
+
+			//without a previous frame the camera did not move
+			m_UnjitteredViewProjectionMatrix[i] = m_UnjitteredProjectionMatrix[i] * m_ViewMatrix[i];
+			m_PreviousViewProjectionMatrix[i] = m_PreviousValid ? previous[i] : m_UnjitteredViewProjectionMatrix[i];
+		}
+		m_PreviousValid = true;
+	}
+
+	void Camera::SetViewMatrix(int view, glm::mat4 val)
+	{
+		m_ViewMatrix[view] = val;
+		m_CustomViewMatrix[view] = true;
+	}
+
+	void Camera::ResetViewMatrix(int view)
+	{
+		m_CustomViewMatrix[view] = false;
+	}
+
+	void Camera::SetProjectionMatrix(int view, glm::mat4 val)
+	{
+		m_UnjitteredProjectionMatrix[view] = val;
+		m_ProjectionMatrix[view] = val;
+		m_CustomProjectionMatrix[view] = true;
+	}
+
+	void Camera::ResetProjectionMatrix(int view)
+	{
+		m_CustomProjectionMatrix[view] = false;
+	}
+
+	float Camera::Halton(int index, int base)
+	{
+		float result = 0.0f;
+		float f = 1.0f;
+		for (int i = index; i > 0; i /= base)
+		{
+			f /= base;
+			result += f * (i % base);
+		}
+		return result;
+	}
+
+	void Camera::SetViewCount(int val)
+	{
+		m_ViewCount = glm::clamp(val, 1, PC_MAX_VIEWS);
+		m_PreviousValid = false;
+		m_PostProcessor->SetLayerCount(m_ViewCount > 1 ? m_ViewCount : 0);
 	}
 
 	float Camera::ComputeFOV(float fl)
@@ -172,15 +260,33 @@ namespace PhysiCam
 			return;
 		}
 
-		if (m_AutoExposure)
+		//redundant binds are filtered from here on, the host bindings are put back at the end
+		GLState::Save();
+
+		//the metering path is only known once the shaders are linked
+		m_PostProcessor->WaitUntilReady();
+
+		if (m_AutoExposure && m_PostProcessor->HasGPUMetering())
+		{
+			//metering, eye adaption and program auto run on the gpu and the exposure stays in video memory,
+			//iso, aperture and shutter speed of this camera are copies read back a few frames later
+			m_PostProcessor->MeterExposure(inputFBODesc.ColorTextureId);
+		}
+		else if (m_AutoExposure)
 		{
 			//lerp the luminance value so the image doesnt flicker, also this simulates eye adaption
 			float averageLuminance = m_PostProcessor->GetAverageLuminance(inputFBODesc.ColorTextureId);
-			m_AverageSceneLuminance = glm::lerp(m_AverageSceneLuminance, averageLuminance, 2.0f * DeltaTime());
 
-			float targetEV = ComputeTargetEV(m_AverageSceneLuminance);//multiply by 1000 so we dont need thousands of lumen in framebuffer
-			targetEV += m_TargetEV;
-			ApplyProgramAuto(targetEV);
+			//the first readbacks arrive a few frames late, until then the settings stay as they are
+			//instead of metering a luminance of 0 (log2(0) would open everything up to the maximum exposure)
+			if (m_PostProcessor->HasAverageLuminance())
+			{
+				m_AverageSceneLuminance = glm::lerp(m_AverageSceneLuminance, averageLuminance, 2.0f * DeltaTime());
+
+				float targetEV = ComputeTargetEV(m_AverageSceneLuminance);//multiply by 1000 so we dont need thousands of lumen in framebuffer
+				targetEV += m_TargetEV;
+				ApplyProgramAuto(targetEV);
+			}
 		}
 		else
 		{
@@ -201,6 +307,12 @@ namespace PhysiCam
 
 		m_PostProcessor->Render(exposure, inputFBODesc, outputFramebufferId);
 
+		GLState::Restore();
+	}
+
+	bool Camera::IsReady()
+	{
+		return m_PostProcessor->IsReady();
 	}
 
 	void Camera::SetSensorFromPreset(SensorPreset preset)
@@ -217,6 +329,7 @@ namespace PhysiCam
 		}
 
 		GL::ValidateExtensions();
+		RenderTexture::InitFormatTable();
 		return true;
 	}
 
@@ -32,14 +32,32 @@ namespace PhysiCam
 	bool GL::HasTextureStorage = false;
 	bool GL::HasDirectStateAccess = false;
 	bool GL::HasAnisotropicFiltering = false;
+	bool GL::HasComputeShader = false;
+	bool GL::HasProgramBinary = false;
+	bool GL::HasParallelShaderCompile = false;
+	bool GL::HasBufferStorage = false;
+	bool GL::HasTimerQuery = false;
 
 
 	void GL::ValidateExtensions()
 	{
-		HasDirectStateAccess = ExtensionAvailable("GL_EXT_direct_state_access");
+		//the ARB entry points (glTextureParameteri, glCreateTextures, ...) are used, not the EXT ones
+		HasDirectStateAccess = ExtensionAvailable("GL_ARB_direct_state_access");
 		HasTextureStorage = ExtensionAvailable("GL_ARB_texture_storage");
 		HasInternalFormatQuery = ExtensionAvailable("GL_ARB_internalformat_query2");;
 		HasAnisotropicFiltering = ExtensionAvailable("GL_EXT_texture_filter_anisotropic");
+		HasComputeShader = ExtensionAvailable("GL_ARB_compute_shader") && ExtensionAvailable("GL_ARB_shader_storage_buffer_object");
+
+		//some drivers expose the extension without supporting a single binary format
+		GLint binaryFormats = 0;
+		if (ExtensionAvailable("GL_ARB_get_program_binary"))
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormats);
+		HasProgramBinary = binaryFormats > 0;
+
+		//both define GL_COMPLETION_STATUS with the same value, the thread count is left at the driver default
+		HasParallelShaderCompile = ExtensionAvailable("GL_KHR_parallel_shader_compile") || ExtensionAvailable("GL_ARB_parallel_shader_compile");
+		HasBufferStorage = ExtensionAvailable("GL_ARB_buffer_storage");
+		HasTimerQuery = ExtensionAvailable("GL_ARB_timer_query");
 	}
 
 	bool GL::ExtensionAvailable(const std::string& name)